@@ -17,9 +17,502 @@
 #include "mbed.h"
 #include "MbedCloudClient.h"
 #include "m2m_object_helper.h"
+#include "m2m_object_helper_journal.h"
+#include "m2m_object_helper_pool.h"
+#include "m2m_object_helper_profile.h"
+#include "m2m_object_helper_changes.h"
+#include "m2m_object_helper_links.h"
+#include "m2m_object_helper_builder.h"
+
+#if FILE_VALUE_PREAD
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 #define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
 
+#if STARTUP_PROFILE
+#define profileBegin(name, instance) if (_startupProfile != NULL) { _startupProfile->begin(name, instance); }
+#define profileBeginCall(name) if (_startupProfile != NULL) { _startupProfile->beginCall(name); }
+#define profileEnd() if (_startupProfile != NULL) { _startupProfile->end(); }
+#else
+#define profileBegin(name, instance)
+#define profileBeginCall(name)
+#define profileEnd()
+#endif
+
+// Entries in the lookup cache are read without a lock, see findResource()
+#define loadRelaxed(pointer) __atomic_load_n(pointer, __ATOMIC_RELAXED)
+#define storeRelaxed(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELAXED)
+
+/** The number of bits in each entry of floatPow5InvSplit[].
+ */
+#define FLOAT_POW5_INV_BITCOUNT 59
+
+/** The number of bits in each entry of floatPow5Split[].
+ */
+#define FLOAT_POW5_BITCOUNT 61
+
+/**********************************************************************
+ * STATIC VARIABLES
+ **********************************************************************/
+
+M2MStartupProfile *M2MObjectHelper::_startupProfile = NULL;
+M2MChangeRing *M2MObjectHelper::_changeRing = NULL;
+M2MTimerWheel *M2MObjectHelper::_timerWheel = NULL;
+
+// 5^-q and 5^i as fixed-point 64-bit values, as needed by
+// floatToText(), see https://github.com/ulfjack/ryu.
+static const uint64_t floatPow5InvSplit[31] = {
+    0x0800000000000001ULL, 0x0666666666666667ULL, 0x051EB851EB851EB9ULL,
+    0x04189374BC6A7EFAULL, 0x068DB8BAC710CB2AULL, 0x053E2D6238DA3C22ULL,
+    0x0431BDE82D7B634EULL, 0x06B5FCA6AF2BD216ULL, 0x055E63B88C230E78ULL,
+    0x044B82FA09B5A52DULL, 0x06DF37F675EF6EAEULL, 0x057F5FF85E592558ULL,
+    0x0465E6604B7A8447ULL, 0x0709709A125DA071ULL, 0x05A126E1A84AE6C1ULL,
+    0x0480EBE7B9D58567ULL, 0x0734ACA5F6226F0BULL, 0x05C3BD5191B525A3ULL,
+    0x049C97747490EAE9ULL, 0x0760F253EDB4AB0EULL, 0x05E72843249088D8ULL,
+    0x04B8ED0283A6D3E0ULL, 0x078E480405D7B966ULL, 0x060B6CD004AC9452ULL,
+    0x04D5F0A66A23A9DBULL, 0x07BCB43D769F762BULL, 0x063090312BB2C4EFULL,
+    0x04F3A68DBC8F03F3ULL, 0x07EC3DAF94180651ULL, 0x065697BFA9ACD1DAULL,
+    0x051212FFBAF0A7E2ULL
+};
+
+static const uint64_t floatPow5Split[47] = {
+    0x1000000000000000ULL, 0x1400000000000000ULL, 0x1900000000000000ULL,
+    0x1F40000000000000ULL, 0x1388000000000000ULL, 0x186A000000000000ULL,
+    0x1E84800000000000ULL, 0x1312D00000000000ULL, 0x17D7840000000000ULL,
+    0x1DCD650000000000ULL, 0x12A05F2000000000ULL, 0x174876E800000000ULL,
+    0x1D1A94A200000000ULL, 0x12309CE540000000ULL, 0x16BCC41E90000000ULL,
+    0x1C6BF52634000000ULL, 0x11C37937E0800000ULL, 0x16345785D8A00000ULL,
+    0x1BC16D674EC80000ULL, 0x1158E460913D0000ULL, 0x15AF1D78B58C4000ULL,
+    0x1B1AE4D6E2EF5000ULL, 0x10F0CF064DD59200ULL, 0x152D02C7E14AF680ULL,
+    0x1A784379D99DB420ULL, 0x108B2A2C28029094ULL, 0x14ADF4B7320334B9ULL,
+    0x19D971E4FE8401E7ULL, 0x1027E72F1F128130ULL, 0x1431E0FAE6D7217CULL,
+    0x193E5939A08CE9DBULL, 0x1F8DEF8808B02452ULL, 0x13B8B5B5056E16B3ULL,
+    0x18A6E32246C99C60ULL, 0x1ED09BEAD87C0378ULL, 0x13426172C74D822BULL,
+    0x1812F9CF7920E2B6ULL, 0x1E17B84357691B64ULL, 0x12CED32A16A1B11EULL,
+    0x178287F49C4A1D66ULL, 0x1D6329F1C35CA4BFULL, 0x125DFA371A19E6F7ULL,
+    0x16F578C4E0A060B5ULL, 0x1CB2D6F618C878E3ULL, 0x11EFC659CF7D4B8DULL,
+    0x166BB7F0435C9E71ULL, 0x1C06A5EC5433C60DULL
+};
+
+// The two-digit decimal strings 00 to 99, so that
+// int64ToText() needs one divide per two digits.
+static const char twoDigits[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+/**********************************************************************
+ * STATIC FUNCTIONS
+ **********************************************************************/
+
+#if RESOURCE_HASH
+// Hash a resource name and instance (FNV-1a).
+static uint32_t hashResource(const char *name, int instance)
+{
+    uint32_t hash = 2166136261UL;
+
+    while (*name != 0) {
+        hash = (hash ^ (uint8_t) *name) * 16777619UL;
+        name++;
+    }
+    hash = (hash ^ (uint32_t) instance) * 16777619UL;
+
+    return hash;
+}
+
+// Map a resource hash to a slot in the perfect hash table,
+// given the displacement of its bucket.
+static int hashSlot(uint32_t hash, uint16_t displacement, int numSlots)
+{
+    // Murmur3 finaliser, so that each displacement
+    // gives an unrelated spread across the slots
+    hash += displacement * 0x9E3779B9UL;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BUL;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35UL;
+    hash ^= hash >> 16;
+
+    return (int) (hash % (uint32_t) numSlots);
+}
+#endif
+
+// ceil(log2(5^e)), for 0 <= e <= 3528.
+static int32_t pow5Bits(int32_t e)
+{
+    return (int32_t) (((uint32_t) e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)), for 0 <= e <= 1650.
+static uint32_t log10Pow2(int32_t e)
+{
+    return ((uint32_t) e * 78913) >> 18;
+}
+
+// floor(log10(5^e)), for 0 <= e <= 2620.
+static uint32_t log10Pow5(int32_t e)
+{
+    return ((uint32_t) e * 732923) >> 20;
+}
+
+// True if value is divisible by 5^p.
+static bool multipleOfPowerOf5(uint32_t value, uint32_t p)
+{
+    uint32_t count = 0;
+
+    while ((value % 5) == 0) {
+        value /= 5;
+        count++;
+    }
+
+    return count >= p;
+}
+
+// (m * factor) >> shift, for 32 < shift, without a 128-bit type.
+static uint32_t mulShift32(uint32_t m, uint64_t factor, int32_t shift)
+{
+    uint64_t bits0 = (uint64_t) m * (uint32_t) factor;
+    uint64_t bits1 = (uint64_t) m * (uint32_t) (factor >> 32);
+
+    return (uint32_t) (((bits0 >> 32) + bits1) >> (shift - 32));
+}
+
+// Write an int64_t as decimal, returning the number of characters
+// written (at most 20, plus a NULL terminator).  Where the value fits
+// in 32 bits, which is nearly always, only 32-bit divides are used,
+// since a 64-bit divide is a library call on a Cortex-M.
+static int int64ToText(int64_t value, char *buffer)
+{
+    uint64_t magnitude;
+    uint32_t magnitude32;
+    char digits[20];
+    int numDigits = 0;
+    uint32_t pair;
+    int length = 0;
+
+    if (value < 0) {
+        buffer[length] = '-';
+        length++;
+        magnitude = 0 - (uint64_t) value;
+    } else {
+        magnitude = (uint64_t) value;
+    }
+
+    // Digits come out least significant first, two at a time
+    while (magnitude > UINT32_MAX) {
+        pair = (uint32_t) (magnitude % 100);
+        magnitude /= 100;
+        digits[numDigits] = twoDigits[pair * 2 + 1];
+        digits[numDigits + 1] = twoDigits[pair * 2];
+        numDigits += 2;
+    }
+    magnitude32 = (uint32_t) magnitude;
+    while (magnitude32 >= 100) {
+        pair = magnitude32 % 100;
+        magnitude32 /= 100;
+        digits[numDigits] = twoDigits[pair * 2 + 1];
+        digits[numDigits + 1] = twoDigits[pair * 2];
+        numDigits += 2;
+    }
+    digits[numDigits] = twoDigits[magnitude32 * 2 + 1];
+    numDigits++;
+    if (magnitude32 >= 10) {
+        digits[numDigits] = twoDigits[magnitude32 * 2];
+        numDigits++;
+    }
+
+    while (numDigits > 0) {
+        numDigits--;
+        buffer[length] = digits[numDigits];
+        length++;
+    }
+    buffer[length] = 0;
+
+    return length;
+}
+
+// Read a decimal int64_t from text which need not be NULL
+// terminated; like strtoll(), leading white space is skipped,
+// reading stops at the first non-digit and the value saturates
+// on overflow.  Returns true if there was at least one digit.
+static bool textToInt64(const char *text, unsigned int length, int64_t *value)
+{
+    unsigned int x = 0;
+    bool negative = false;
+    uint64_t magnitude = 0;
+    uint64_t limit;
+    uint32_t magnitude32 = 0;
+    unsigned int numDigits = 0;
+    unsigned int digit;
+
+    while ((x < length) && ((text[x] == ' ') || (text[x] == '\t'))) {
+        x++;
+    }
+    if ((x < length) && ((text[x] == '-') || (text[x] == '+'))) {
+        negative = (text[x] == '-');
+        x++;
+    }
+    limit = negative ? (uint64_t) INT64_MAX + 1 : (uint64_t) INT64_MAX;
+
+    // The first nine digits can't overflow 32 bits
+    while ((x < length) && (numDigits < 9) &&
+           ((digit = (unsigned int) (text[x] - '0')) <= 9)) {
+        magnitude32 = magnitude32 * 10 + digit;
+        numDigits++;
+        x++;
+    }
+    magnitude = magnitude32;
+    while ((x < length) && ((digit = (unsigned int) (text[x] - '0')) <= 9)) {
+        if (magnitude > (limit - digit) / 10) {
+            magnitude = limit;
+        } else {
+            magnitude = magnitude * 10 + digit;
+        }
+        numDigits++;
+        x++;
+    }
+
+    if (negative) {
+        *value = (magnitude == (uint64_t) INT64_MAX + 1) ? INT64_MIN : -(int64_t) magnitude;
+    } else {
+        *value = (int64_t) magnitude;
+    }
+
+    return numDigits > 0;
+}
+
+// Write the shortest decimal string that reads back as exactly the
+// given float, returning the number of characters written (at most
+// 22, plus a NULL terminator).  This is Ryu (Ulf Adams, PLDI 2018):
+// the interval of decimals which round to the float is scaled by a
+// power of ten using the tables above and digits are then removed
+// while both ends of the interval still differ.  Values with a
+// decimal exponent from -7 to 20 are written without an exponent.
+static int floatToText(float value, char *buffer)
+{
+    uint32_t bits;
+    uint32_t ieeeMantissa;
+    uint32_t ieeeExponent;
+    int32_t e2;
+    uint32_t m2;
+    bool acceptBounds;
+    uint32_t mv;
+    uint32_t mp;
+    uint32_t mm;
+    uint32_t mmShift;
+    uint32_t vr;
+    uint32_t vp;
+    uint32_t vm;
+    uint32_t q;
+    int32_t e10;
+    int32_t i;
+    int32_t k;
+    int32_t j;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    uint8_t lastRemovedDigit = 0;
+    int32_t removed = 0;
+    uint32_t output;
+    char digits[10];
+    int numDigits = 0;
+    int point;
+    int length = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    ieeeMantissa = bits & ((1UL << 23) - 1);
+    ieeeExponent = (bits >> 23) & 0xFF;
+
+    if (bits >> 31) {
+        buffer[length] = '-';
+        length++;
+    }
+
+    if (ieeeExponent == 0xFF) {
+        strcpy(buffer + length, (ieeeMantissa != 0) ? "nan" : "inf");
+        return length + 3;
+    }
+    if ((ieeeExponent == 0) && (ieeeMantissa == 0)) {
+        strcpy(buffer + length, "0");
+        return length + 1;
+    }
+
+    // Work out the interval of values which round to this
+    // float, as (mm, mp) * 2^e2, with mv the float itself
+    if (ieeeExponent == 0) {
+        e2 = 1 - 127 - 23 - 2;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t) ieeeExponent - 127 - 23 - 2;
+        m2 = (1UL << 23) | ieeeMantissa;
+    }
+    acceptBounds = ((m2 & 1) == 0);
+    mv = 4 * m2;
+    mp = 4 * m2 + 2;
+    mmShift = ((ieeeMantissa != 0) || (ieeeExponent <= 1)) ? 1 : 0;
+    mm = 4 * m2 - 1 - mmShift;
+
+    // Convert the interval to base 10 as (vm, vp) * 10^e10
+    if (e2 >= 0) {
+        q = log10Pow2(e2);
+        e10 = (int32_t) q;
+        k = FLOAT_POW5_INV_BITCOUNT + pow5Bits(q) - 1;
+        i = -e2 + (int32_t) q + k;
+        vr = mulShift32(mv, floatPow5InvSplit[q], i);
+        vp = mulShift32(mp, floatPow5InvSplit[q], i);
+        vm = mulShift32(mm, floatPow5InvSplit[q], i);
+        if ((q != 0) && ((vp - 1) / 10 <= vm / 10)) {
+            // Need the digit that is about to be lost
+            // to round correctly
+            k = FLOAT_POW5_INV_BITCOUNT + pow5Bits(q - 1) - 1;
+            lastRemovedDigit = (uint8_t) (mulShift32(mv, floatPow5InvSplit[q - 1],
+                                                     -e2 + (int32_t) q - 1 + k) % 10);
+        }
+        if (q <= 9) {
+            // Only one of mp, mv and mm can be a multiple of 5, if any
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = multipleOfPowerOf5(mm, q);
+            } else {
+                vp -= multipleOfPowerOf5(mp, q) ? 1 : 0;
+            }
+        }
+    } else {
+        q = log10Pow5(-e2);
+        e10 = (int32_t) q + e2;
+        i = -e2 - (int32_t) q;
+        k = pow5Bits(i) - FLOAT_POW5_BITCOUNT;
+        j = (int32_t) q - k;
+        vr = mulShift32(mv, floatPow5Split[i], j);
+        vp = mulShift32(mp, floatPow5Split[i], j);
+        vm = mulShift32(mm, floatPow5Split[i], j);
+        if ((q != 0) && ((vp - 1) / 10 <= vm / 10)) {
+            j = (int32_t) q - 1 - (pow5Bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            lastRemovedDigit = (uint8_t) (mulShift32(mv, floatPow5Split[i + 1], j) % 10);
+        }
+        if (q <= 1) {
+            // mv has at least q trailing zero bits
+            vrIsTrailingZeros = true;
+            if (acceptBounds) {
+                vmIsTrailingZeros = (mmShift == 1);
+            } else {
+                vp--;
+            }
+        } else if (q < 31) {
+            vrIsTrailingZeros = ((mv & ((1UL << (q - 1)) - 1)) == 0);
+        }
+    }
+
+    // Remove digits while the ends of the interval still differ
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= (vm % 10 == 0);
+            vrIsTrailingZeros &= (lastRemovedDigit == 0);
+            lastRemovedDigit = (uint8_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= (lastRemovedDigit == 0);
+                lastRemovedDigit = (uint8_t) (vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vrIsTrailingZeros && (lastRemovedDigit == 5) && (vr % 2 == 0)) {
+            // Round even if exactly halfway
+            lastRemovedDigit = 4;
+        }
+        output = vr + (((vr == vm) && (!acceptBounds || !vmIsTrailingZeros)) || (lastRemovedDigit >= 5));
+    } else {
+        while (vp / 10 > vm / 10) {
+            lastRemovedDigit = (uint8_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + ((vr == vm) || (lastRemovedDigit >= 5));
+    }
+    e10 += removed;
+
+    // Print the digits, least significant first
+    while (output > 0) {
+        digits[numDigits] = '0' + (output % 10);
+        output /= 10;
+        numDigits++;
+    }
+    point = numDigits + e10; // Digits before the decimal point
+
+    if ((point > -7) && (point <= 21)) {
+        if (point <= 0) {
+            buffer[length] = '0';
+            buffer[length + 1] = '.';
+            length += 2;
+            for (int x = 0; x < -point; x++) {
+                buffer[length] = '0';
+                length++;
+            }
+        }
+        for (int x = numDigits - 1; x >= 0; x--) {
+            buffer[length] = digits[x];
+            length++;
+            if ((numDigits - x == point) && (x > 0)) {
+                buffer[length] = '.';
+                length++;
+            }
+        }
+        for (int x = numDigits; x < point; x++) {
+            buffer[length] = '0';
+            length++;
+        }
+    } else {
+        buffer[length] = digits[numDigits - 1];
+        length++;
+        if (numDigits > 1) {
+            buffer[length] = '.';
+            length++;
+            for (int x = numDigits - 2; x >= 0; x--) {
+                buffer[length] = digits[x];
+                length++;
+            }
+        }
+        point--;
+        buffer[length] = 'e';
+        buffer[length + 1] = (point < 0) ? '-' : '+';
+        length += 2;
+        if (point < 0) {
+            point = -point;
+        }
+        if (point >= 10) {
+            buffer[length] = '0' + (point / 10);
+            length++;
+        }
+        buffer[length] = '0' + (point % 10);
+        length++;
+    }
+    buffer[length] = 0;
+
+    return length;
+}
+
 /**********************************************************************
  * PUBLIC METHODS
  **********************************************************************/
@@ -29,8 +522,12 @@ M2MObjectHelper::~M2MObjectHelper()
 {
     M2MObjectInstance *objectInstance;
 
+    if ((_links != NULL) && (_objectInstance != NULL)) {
+        _links->remove(this);
+    }
+
     if (_object != NULL) {
-        objectInstance = _object->object_instance(_defObject->instance);
+        objectInstance = _object->object_instance(_instance);
         if (objectInstance != NULL) {
             _object->remove_object_instance(objectInstance->instance_id());
         }
@@ -38,6 +535,18 @@ M2MObjectHelper::~M2MObjectHelper()
             delete _object;
         }
     }
+
+    for (int x = 0; x < MAX_NUM_RESOURCES; x++) {
+        M2MObjectPool::giveBack(_resourceStates[x].stringHeap);
+#if STALE_VALUES
+        if (_wheel != NULL) {
+            _wheel->stop(&(_resourceStates[x].staleTimer));
+        }
+#endif
+    }
+    if (_stringStorageOwned) {
+        M2MObjectPool::giveBack(_stringStorage);
+    }
 }
 
 // Default implementation of updateObservableResources.
@@ -48,80 +557,329 @@ void M2MObjectHelper::updateObservableResources()
 // Create this object.
 bool M2MObjectHelper::makeObject()
 {
-    bool allResourcesCreated = true;
-    M2MObjectInstance *objectInstance;
-    M2MResource *resource;
-    M2MResourceInstance *resourceInstance;
+    return createObject(NULL, NULL);
+}
+
+// Create this object as a clone of a prototype.
+bool M2MObjectHelper::makeObject(const M2MObjectHelper *prototype,
+                                 int instance,
+                                 char *stringStorage)
+{
+    if ((prototype == NULL) || (prototype->_defObject != _defObject) ||
+        (prototype->_object == NULL) || ((_object != NULL) && (_object != prototype->_object))) {
+        printfLog("M2MObjectHelper: prototype is not an object made from the same definition.\n");
+        return false;
+    }
+    _object = prototype->_object;
+    _instance = instance;
+
+    return createObject(prototype, stringStorage);
+}
+
+// Begin making this object, a slice at a time.
+bool M2MObjectHelper::beginMakeObject()
+{
+    return startObject(NULL, NULL);
+}
+
+// Default implementation of objectMade.
+void M2MObjectHelper::objectMade()
+{
+}
+
+// Create the next few resources of this object.
+int M2MObjectHelper::makeObjectSlice(int maxResources, uint32_t maxMicroseconds)
+{
+    uint32_t start = us_ticker_read();
+    int numMade = 0;
+
+    if (_objectInstance == NULL) {
+        return -1;
+    }
+
+    while ((_numResourcesMade < _defObject->numResources) &&
+           ((numMade == 0) ||
+            (((maxResources <= 0) || (numMade < maxResources)) &&
+             ((maxMicroseconds == 0) || (us_ticker_read() - start < maxMicroseconds))))) {
+        profileBegin(_defObject->name, _instance);
+        profileBegin("makeObject", -1);
+        makeResource(_numResourcesMade);
+        profileEnd();
+        profileEnd();
+        _numResourcesMade++;
+        numMade++;
+        if (_numResourcesMade == _defObject->numResources) {
+            printfLog("M2MObjectHelper: object \"%s\", instance %d, made with %d resource(s) failed.\n",
+                      _defObject->name, _instance, _numResourcesFailed);
+            startStaleTimers();
+            objectMade();
+        }
+    }
+
+    return _defObject->numResources - _numResourcesMade;
+}
+
+// Set the start-up profile.
+void M2MObjectHelper::setStartupProfile(M2MStartupProfile *profile)
+{
+    _startupProfile = profile;
+}
+
+// Set the change ring.
+void M2MObjectHelper::setChangeRing(M2MChangeRing *ring)
+{
+    _changeRing = ring;
+}
+
+// Set the timer wheel for spotting stale values.
+void M2MObjectHelper::setTimerWheel(M2MTimerWheel *wheel)
+{
+    _timerWheel = wheel;
+}
+
+// Get the timer wheel.
+M2MTimerWheel *M2MObjectHelper::getTimerWheel()
+{
+    return _timerWheel;
+}
+
+// Set the start-up priority of this object.
+void M2MObjectHelper::setStartupPriority(int priority)
+{
+    _startupPriority = priority;
+}
+
+// Get the start-up priority of this object.
+int M2MObjectHelper::getStartupPriority() const
+{
+    return _startupPriority;
+}
+
+// Get the number of resources in this object.
+int M2MObjectHelper::getNumResources() const
+{
+    int numResources = 0;
+
+    if (_defObject != NULL) {
+        numResources = _defObject->numResources;
+    }
+
+    return numResources;
+}
+
+// Get the number of resources of this object created so far.
+int M2MObjectHelper::getNumResourcesMade(int *numFailed) const
+{
+    if (numFailed != NULL) {
+        *numFailed = _numResourcesFailed;
+    }
+
+    return _numResourcesMade;
+}
+
+// Get the CoRE link-format fragment for this object instance.
+const char *M2MObjectHelper::getLinkFragment(int *length) const
+{
+    if (length != NULL) {
+        *length = _linkFragmentLength;
+    }
+
+    return (_linkFragmentLength > 0) ? _linkFragment : NULL;
+}
+
+// Get the version of the values of this object.
+uint32_t M2MObjectHelper::getVersion() const
+{
+    return _version;
+}
+
+// Get the version of the value of a resource.
+uint32_t M2MObjectHelper::getResourceVersion(const char *resourceNumber,
+                                             int wantedInstance)
+{
+    uint32_t version = 0;
+    int index;
+
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        version = getVersion(index);
+    }
+
+    return version;
+}
+
+// Republish the values the server has not confirmed receiving.
+int M2MObjectHelper::republish(RepublishStats *stats)
+{
+    int numRepublished = 0;
     const DefResource *defResource;
+    ResourceState *state;
+
+#if ACKNOWLEDGED_VALUES
+    if (!_notificationsConfirmable) {
+        // Nothing is ever confirmed, nothing to go on
+        return 0;
+    }
+#endif
+
+    for (int x = 0; x < _defObject->numResources; x++) {
+        defResource = &(_defObject->resources[x]);
+        state = &(_resourceStates[x]);
+        // Only a value that would be notified counts, either way
+        if (!defResource->observable || (state->handle == NULL) ||
+            (getConstValue(x) != NULL) || !state->handle->is_under_observation()) {
+            continue;
+        }
+#if ACKNOWLEDGED_VALUES
+        if (state->ackedVersion == getVersion(x)) {
+            if (stats != NULL) {
+                stats->numSkipped++;
+                stats->bytesSaved += state->handle->value_length();
+            }
+            continue;
+        }
+        state->queuedVersion = getVersion(x);
+#endif
+        printfLog("M2MObjectHelper: republishing resource \"%s\", instance %d, in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
+        state->handle->set_changed();
+        numRepublished++;
+        if (stats != NULL) {
+            stats->numRepublished++;
+            stats->bytesRepublished += state->handle->value_length();
+        }
+    }
+
+    return numRepublished;
+}
+
+// Say whether Mbed Client sends notifications confirmable.
+void M2MObjectHelper::setNotificationsConfirmable(bool confirmable)
+{
+    _notificationsConfirmable = confirmable;
+}
+
+// Find out whether a resource has gone stale.
+bool M2MObjectHelper::isStale(const char *resourceNumber,
+                              int wantedInstance)
+{
+    bool stale = false;
+#if STALE_VALUES
+    int index;
+
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        stale = _resourceStates[index].stale;
+    }
+#else
+
+    (void) resourceNumber;
+    (void) wantedInstance;
+#endif
+
+    return stale;
+}
+
+// Return the size of the storage needed for STRING values.
+int M2MObjectHelper::getStringStorageSize() const
+{
+    int size = 0;
+
+    for (int x = 0; x < MAX_NUM_RESOURCES; x++) {
+        if (_resourceStates[x].stringInlineLength > 0) {
+            size += _resourceStates[x].stringInlineLength + 1;
+        }
+    }
+
+    return size;
+}
 
+// Create the object, copying the set-up of a prototype if there is one.
+bool M2MObjectHelper::createObject(const M2MObjectHelper *prototype, char *stringStorage)
+{
+    bool allResourcesCreated;
+
+    profileBegin((_defObject != NULL) ? _defObject->name : "NULL", _instance);
+    profileBegin("makeObject", -1);
+    allResourcesCreated = startObject(prototype, stringStorage);
+
+    if (_objectInstance != NULL) {
+        while (_numResourcesMade < _defObject->numResources) {
+            if (!makeResource(_numResourcesMade)) {
+                allResourcesCreated = false;
+            }
+            _numResourcesMade++;
+        }
+        startStaleTimers();
+    }
+    profileEnd();
+    profileEnd();
+
+    return (_objectInstance != NULL) && allResourcesCreated;
+}
+
+// Create the object and its instance, ready for the resources.
+bool M2MObjectHelper::startObject(const M2MObjectHelper *prototype, char *stringStorage)
+{
+    bool success = false;
+
+    _numResourcesMade = 0;
+    _numResourcesFailed = 0;
+#if STALE_VALUES
+    // The object keeps to the wheel it was made with
+    _wheel = _timerWheel;
+#endif
     if (_defObject != NULL) {
         printfLog("M2MObjectHelper: making object \"%s\", instance %d (-1 == single instance), with %d resource(s).\n",
-                  _defObject->name, _defObject->instance, _defObject->numResources);
+                  _defObject->name, _instance, _defObject->numResources);
 
         // Create the object according to the definition
         if (_object == NULL) {
+            profileBeginCall("create_object");
             _object = M2MInterfaceFactory::create_object(_defObject->name);
+            profileEnd();
         }
         if (_object != NULL) {
-            // Create the resources according to the definition
-            objectInstance = _object->create_object_instance(_defObject->instance);
-            if (objectInstance != NULL) {
+            profileBeginCall("create_object_instance");
+            _objectInstance = _object->create_object_instance(_instance);
+            profileEnd();
+            if (_objectInstance != NULL) {
                 for (int x = 0; x < _defObject->numResources; x++) {
-                    defResource = &(_defObject->resources[x]);
-                    // If this is a multi-instance resource, create the base
-                    // instance if it's not already there
-                    if ((defResource->instance != -1) && (objectInstance->resource(defResource->name) == NULL)) {
-                        printfLog("M2MObjectHelper: creating base instance of multi-instance resource \"%s\" in object \"%s\".\n",
-                                  defResource->name, _object->name());
-                        resource = objectInstance->create_dynamic_resource((const char *) defResource->name,
-                                                                           (const char *) defResource->typeString,
-                                                                           defResource->type,
-                                                                           defResource->observable,
-                                                                           true /* multi-instance */);
-                        if (resource == NULL) {
-                            allResourcesCreated = false;
-                            printfLog("M2MObjectHelper: unable to create base instance of multi-instance resource \"%s\" in object \"%s\".\n",
-                                      defResource->name, _defObject->name);
-                        }
-                    }
-
-                    // Now create the resource
-                    if (defResource->instance >= 0) {
-                        printfLog("M2MObjectHelper: creating instance %d of multi-instance resource \"%s\" in object \"%s\".\n",
-                                  defResource->instance, defResource->name, _object->name());
-                        resourceInstance = objectInstance->create_dynamic_resource_instance((const char *) defResource->name,
-                                                                                            (const char *) defResource->typeString,
-                                                                                            defResource->type,
-                                                                                            defResource->observable,
-                                                                                            defResource->instance);
-                        if (resourceInstance != NULL) {
-                            resourceInstance->set_operation(defResource->operation);
-                            if (_valueUpdatedCallback) {
-                                resourceInstance->set_value_updated_function(_valueUpdatedCallback);
-                            }
-                        } else {
-                            allResourcesCreated = false;
-                            printfLog("M2MObjectHelper: unable to create instance %d of multi-instance resource \"%s\" in object \"%s\".\n",
-                                      defResource->instance, defResource->name, _defObject->name);
-                        }
-                    } else {
-                        printfLog("M2MObjectHelper: creating single-instance resource \"%s\" in object \"%s\".\n",
-                                  defResource->name, _object->name());
-                        resource = objectInstance->create_dynamic_resource((const char *) defResource->name,
-                                                                           (const char *) defResource->typeString,
-                                                                           defResource->type,
-                                                                           defResource->observable);
-                        if (resource != NULL) {
-                            resource->set_operation(defResource->operation);
-                            if (_valueUpdatedCallback) {
-                                resource->set_value_updated_function(_valueUpdatedCallback);
-                            }
-                        } else {
-                            allResourcesCreated = false;
-                            printfLog("M2MObjectHelper: unable to create single-instance resource \"%s\" in object \"%s\".\n",
-                                      defResource->name, _defObject->name);
-                        }
+                    _resourceStates[x].handle = NULL;
+                }
+                if (prototype != NULL) {
+                    // Same definition, same hash, same lookups
+#if RESOURCE_HASH
+                    _hashValid = prototype->_hashValid;
+                    memcpy(_hashDisplacement, prototype->_hashDisplacement, sizeof(_hashDisplacement));
+                    memcpy(_hashIndex, prototype->_hashIndex, sizeof(_hashIndex));
+#endif
+                    // The handles in the cache of the prototype are its own
+                    for (int x = 0; x < RESOURCE_LOOKUP_CACHE_SIZE; x++) {
+                        _lookupCache[x].resourceNumber = loadRelaxed(&(prototype->_lookupCache[x].resourceNumber));
+                        _lookupCache[x].wantedInstance = loadRelaxed(&(prototype->_lookupCache[x].wantedInstance));
+                        _lookupCache[x].index = loadRelaxed(&(prototype->_lookupCache[x].index));
+                        _lookupCache[x].handle = NULL;
                     }
+                    _lookupCacheNext = loadRelaxed(&(prototype->_lookupCacheNext));
+                }
+#if RESOURCE_HASH
+                else if (_defObject->numResources >= RESOURCE_HASH_MIN_RESOURCES) {
+                    makeHash();
+                }
+#endif
+                success = makeStringStorage(prototype, stringStorage);
+                // Registration always lists this instance, so do
+                // the formatting now rather than each time
+                if (_instance >= 0) {
+                    _linkFragmentLength = snprintf(_linkFragment, sizeof(_linkFragment), "</%s/%d>",
+                                                   _defObject->name, _instance);
+                } else {
+                    _linkFragmentLength = snprintf(_linkFragment, sizeof(_linkFragment), "</%s>",
+                                                   _defObject->name);
+                }
+                if (_links != NULL) {
+                    _links->add(this);
                 }
             } else {
                 printfLog("M2MObjectHelper: unable to create instance of object \"%s\".\n", _defObject->name);
@@ -133,470 +891,1947 @@ bool M2MObjectHelper::makeObject()
         printfLog("M2MObjectHelper: defObject is NULL.\n");
     }
 
-    return (objectInstance != NULL) && allResourcesCreated;
+    return success;
 }
 
-// Set the execute function for a resource.
-bool M2MObjectHelper::setExecuteCallback(execute_callback callback, const char *resourceNumber)
+// Create a resource of the object according to the definition.
+bool M2MObjectHelper::makeResource(int index)
 {
-    bool success = false;
-    M2MObjectInstance *objectInstance;
+    bool success = true;
+    M2MObjectInstance *objectInstance = _objectInstance;
     M2MResource *resource;
+    M2MResourceInstance *resourceInstance;
+    const DefResource *defResource;
+    const DefResourceOptions *options;
+
+    defResource = &(_defObject->resources[index]);
+    profileBegin(defResource->name, defResource->instance);
+    // If this is a multi-instance resource, create the base
+    // instance if it's not already there
+    if ((defResource->instance != -1) && (objectInstance->resource(defResource->name) == NULL)) {
+        printfLog("M2MObjectHelper: creating base instance of multi-instance resource \"%s\" in object \"%s\".\n",
+                  defResource->name, _object->name());
+        profileBeginCall("create_dynamic_resource");
+        // Creating resources is one at a time, see M2MObjectBuilder::buildInParallel()
+        M2MObjectBuilder::lockMbedClient();
+        resource = objectInstance->create_dynamic_resource((const char *) defResource->name,
+                                                           (const char *) defResource->typeString,
+                                                           defResource->type,
+                                                           defResource->observable,
+                                                           true /* multi-instance */);
+        M2MObjectBuilder::unlockMbedClient();
+        profileEnd();
+        if (resource == NULL) {
+            success = false;
+            printfLog("M2MObjectHelper: unable to create base instance of multi-instance resource \"%s\" in object \"%s\".\n",
+                      defResource->name, _defObject->name);
+        }
+    }
 
-    if (_object != NULL) {
-        printfLog("M2MObjectHelper: setting execute callback for resource \"%s\" in object \"%s\".\n",
-                  resourceNumber, _object->name());
-        objectInstance = _object->object_instance(_defObject->instance);
-        if (objectInstance != NULL) {
-            resource = objectInstance->resource(resourceNumber);
-            if (resource != NULL) {
-                success = resource->set_execute_function(callback);
-            } else {
-                printfLog("M2MObjectHelper: unable to find resource \"%s\" in object \"%s\".\n",
-                          resourceNumber, _object->name());
+    // Now create the resource
+    if (defResource->instance >= 0) {
+        printfLog("M2MObjectHelper: creating instance %d of multi-instance resource \"%s\" in object \"%s\".\n",
+                  defResource->instance, defResource->name, _object->name());
+        profileBeginCall("create_dynamic_resource_instance");
+        M2MObjectBuilder::lockMbedClient();
+        resourceInstance = objectInstance->create_dynamic_resource_instance((const char *) defResource->name,
+                                                                            (const char *) defResource->typeString,
+                                                                            defResource->type,
+                                                                            defResource->observable,
+                                                                            defResource->instance);
+        M2MObjectBuilder::unlockMbedClient();
+        profileEnd();
+        if (resourceInstance != NULL) {
+            _resourceStates[index].handle = resourceInstance;
+            bindResource(index);
+        } else {
+            success = false;
+            printfLog("M2MObjectHelper: unable to create instance %d of multi-instance resource \"%s\" in object \"%s\".\n",
+                      defResource->instance, defResource->name, _defObject->name);
+        }
+    } else {
+        printfLog("M2MObjectHelper: creating single-instance resource \"%s\" in object \"%s\".\n",
+                  defResource->name, _object->name());
+        profileBeginCall("create_dynamic_resource");
+        M2MObjectBuilder::lockMbedClient();
+        resource = objectInstance->create_dynamic_resource((const char *) defResource->name,
+                                                           (const char *) defResource->typeString,
+                                                           defResource->type,
+                                                           defResource->observable);
+        M2MObjectBuilder::unlockMbedClient();
+        profileEnd();
+        if (resource != NULL) {
+            _resourceStates[index].handle = resource;
+            bindResource(index);
+        } else {
+            success = false;
+            printfLog("M2MObjectHelper: unable to create single-instance resource \"%s\" in object \"%s\".\n",
+                      defResource->name, _defObject->name);
+        }
+    }
+
+    if (success) {
+        // A new resource counts as a change, so that a reader
+        // starting from version 0 reads every resource once,
+        // but is not one worth telling the change ring about
+        _version++;
+#if RESOURCE_VERSIONS
+        _resourceStates[index].version = _version;
+#endif
+        options = getResourceOptions(index);
+#if STALE_VALUES
+        // Ready the stale timer, started by startStaleTimers()
+        // since this may be on one of M2MObjectBuilder's threads
+        if ((_wheel != NULL) && (options != NULL) && (options->maxUpdateIntervalMs > 0)) {
+            M2MTimerWheel::init(&(_resourceStates[index].staleTimer), &ResourceBinding::staleTimerExpired, &(_resourceStates[index].binding));
+        }
+#else
+        if ((options != NULL) && (options->maxUpdateIntervalMs > 0)) {
+            printfLog("M2MObjectHelper: maxUpdateIntervalMs of resource \"%s\" in object \"%s\" ignored, STALE_VALUES is 0.\n",
+                      defResource->name, _defObject->name);
+        }
+#endif
+    } else {
+        _numResourcesFailed++;
+    }
+    profileEnd();
+
+    return success;
+}
+
+// Set the callback for when the server writes a resource.
+void M2MObjectHelper::setResourceWrittenCallback(ResourceWrittenCallback callback)
+{
+    _resourceWrittenCallback = callback;
+}
+
+#if OPAQUE_WRITE_STREAMING
+// Set the callback for the blocks of OPAQUE values written by the server.
+void M2MObjectHelper::setOpaqueWriteCallback(OpaqueWriteCallback callback)
+{
+    _opaqueWriteCallback = callback;
+
+    // Re-bind any resources that have already been created
+    if (_defObject != NULL) {
+        for (int x = 0; x < _defObject->numResources; x++) {
+            if (_resourceStates[x].handle != NULL) {
+                bindResource(x);
+            }
+        }
+    }
+}
+#endif
+
+// Set the callback for when a resource goes stale.
+void M2MObjectHelper::setStaleCallback(StaleCallback callback)
+{
+    _staleCallback = callback;
+}
+
+// Set the journal for values written by the server.
+void M2MObjectHelper::setJournal(M2MObjectJournal *journal)
+{
+    _journal = journal;
+}
+
+// Set the pool for the storage of this object.
+bool M2MObjectHelper::setPool(M2MObjectPool *pool)
+{
+    if (_objectInstance != NULL) {
+        printfLog("M2MObjectHelper: object \"%s\" already made, too late to set a pool.\n", _defObject->name);
+        return false;
+    }
+    _pool = pool;
+
+    return true;
+}
+
+// Set the link-format payload for this object.
+bool M2MObjectHelper::setLinkPayload(M2MLinkPayload *links)
+{
+    bool success = true;
+
+    if (links != _links) {
+        if ((_links != NULL) && (_objectInstance != NULL)) {
+            _links->remove(this);
+        }
+        _links = links;
+        if ((_links != NULL) && (_objectInstance != NULL)) {
+            success = _links->add(this);
+        }
+    }
+
+    return success;
+}
+
+#if OPAQUE_WRITE_STREAMING
+// Get how far the server has got in writing an OPAQUE value.
+bool M2MObjectHelper::getOpaqueWriteProgress(uint32_t *offset,
+                                             uint32_t *totalLength,
+                                             const char *resourceNumber,
+                                             int wantedInstance)
+{
+    bool success = false;
+    int index;
+
+    index = findResource(resourceNumber, wantedInstance);
+    if ((index >= 0) && (_defObject->resources[index].type == M2MResourceBase::OPAQUE)) {
+        *offset = _resourceStates[index].opaqueOffset;
+        if (totalLength != NULL) {
+            *totalLength = _resourceStates[index].opaqueTotalLength;
+        }
+        success = true;
+    }
+
+    return success;
+}
+
+// Set how far the server has got in writing an OPAQUE value.
+bool M2MObjectHelper::setOpaqueWriteProgress(uint32_t offset,
+                                             uint32_t totalLength,
+                                             const char *resourceNumber,
+                                             int wantedInstance)
+{
+    bool success = false;
+    int index;
+
+    index = findResource(resourceNumber, wantedInstance);
+    if ((index >= 0) && (_defObject->resources[index].type == M2MResourceBase::OPAQUE) &&
+        (offset <= totalLength)) {
+        _resourceStates[index].opaqueOffset = offset;
+        _resourceStates[index].opaqueTotalLength = totalLength;
+        success = true;
+    }
+
+    return success;
+}
+#endif
+
+// Set the execute function for a resource.
+bool M2MObjectHelper::setExecuteCallback(execute_callback callback, const char *resourceNumber)
+{
+    bool success = false;
+    M2MResource *resource = NULL;
+    M2MResourceBase *handle = NULL;
+
+    if (_object != NULL) {
+        printfLog("M2MObjectHelper: setting execute callback for resource \"%s\" in object \"%s\".\n",
+                  resourceNumber, _object->name());
+        if (_objectInstance != NULL) {
+            // A single-instance resource is its own handle
+            if (findResource(resourceNumber, -1, &handle) >= 0) {
+                resource = (M2MResource *) handle;
+            }
+            if (resource == NULL) {
+                resource = _objectInstance->resource(resourceNumber);
+            }
+            if (resource != NULL) {
+                success = resource->set_execute_function(callback);
+            } else {
+                printfLog("M2MObjectHelper: unable to find resource \"%s\" in object \"%s\".\n",
+                          resourceNumber, _object->name());
+            }
+        } else {
+            printfLog("M2MObjectHelper: unable to get instance of object \"%s\".\n", _object->name());
+        }
+    } else {
+        printfLog("M2MObjectHelper: object is NULL.\n");
+    }
+
+    return success;
+}
+
+
+// Set the value of a given resource in an object.
+bool M2MObjectHelper::setResourceValue(int64_t value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        if ((type == M2MResourceBase::INTEGER) ||
+            (type == M2MResourceBase::TIME)) {
+            success = setResourceValue((void *) &value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Set the value of a given resource in an object.
+bool M2MObjectHelper::setResourceValue(float value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        if (type == M2MResourceBase::FLOAT) {
+            success = setResourceValue((void *) &value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Set the value of a given resource in an object.
+bool M2MObjectHelper::setResourceValue(bool value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        if (type == M2MResourceBase::BOOLEAN) {
+            success = setResourceValue((void *) &value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Set the value of a given resource in an object.
+bool M2MObjectHelper::setResourceValue(const char *value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        if (type == M2MResourceBase::STRING) {
+            profileBegin(_defObject->name, _instance);
+            profileBegin("setResourceValue", -1);
+            profileBegin(_defObject->resources[index].name, _defObject->resources[index].instance);
+            success = setStringValue(value, strlen(value), index);
+            profileEnd();
+            profileEnd();
+            profileEnd();
+        }
+    }
+
+    return success;
+}
+
+// Set the value of a given resource in an object.
+bool M2MObjectHelper::setResourceValue(String value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        if (type == M2MResourceBase::STRING) {
+            profileBegin(_defObject->name, _instance);
+            profileBegin("setResourceValue", -1);
+            profileBegin(_defObject->resources[index].name, _defObject->resources[index].instance);
+            success = setStringValue(value.c_str(), value.size(), index);
+            profileEnd();
+            profileEnd();
+            profileEnd();
+        }
+    }
+
+    return success;
+}
+
+// Set the value of a given enumerated resource in an object.
+bool M2MObjectHelper::setResourceEnumIndex(uint8_t enumIndex,
+                                           const char *resourceNumber,
+                                           int wantedInstance)
+{
+    bool success = false;
+    int index;
+    const DefResourceOptions *options;
+
+    // Find the resource from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        options = getResourceOptions(index);
+        if ((options != NULL) && (options->enumValues != NULL)) {
+            profileBegin(_defObject->name, _instance);
+            profileBegin("setResourceEnumIndex", -1);
+            profileBegin(_defObject->resources[index].name, _defObject->resources[index].instance);
+            success = setEnumValue(enumIndex, index);
+            profileEnd();
+            profileEnd();
+            profileEnd();
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a given resource in an object.
+bool M2MObjectHelper::getResourceValue(int64_t *value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        // Get the value
+        if ((type == M2MResourceBase::INTEGER) ||
+            (type == M2MResourceBase::TIME)) {
+            success = getResourceValue((void *) value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a given resource in an object.
+bool M2MObjectHelper::getResourceValue(float *value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        // Get the value
+        if (type == M2MResourceBase::FLOAT) {
+            success = getResourceValue((void *) value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a given resource in an object.
+bool M2MObjectHelper::getResourceValue(bool *value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        // Get the value
+        if (type == M2MResourceBase::BOOLEAN) {
+            success = getResourceValue((void *) value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a given resource in an object.
+bool M2MObjectHelper::getResourceValue(char *value,
+                                       unsigned int len,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+    const char *stringValue;
+    unsigned int stringLength;
+    String str;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        // Get the value, from our copy if we have it
+        if (type == M2MResourceBase::STRING) {
+            stringValue = getStringValue(index);
+            if (stringValue != NULL) {
+                stringLength = _resourceStates[index].stringLength;
+                success = true;
+            } else {
+                success = getResourceValue((void *) &str, type, index);
+                stringValue = str.c_str();
+                stringLength = str.size();
+            }
+            // Copy the string
+            if (success) {
+                if (len > 0) {
+                    if (stringLength > len - 1) { // -1 for terminator
+                        stringLength = len - 1;
+                    }
+                    memcpy(value, stringValue, stringLength);
+                    *(value + stringLength) = 0; // Add terminator
+                }
+            }
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a given resource in an object.
+bool M2MObjectHelper::getResourceValue(String *value,
+                                       const char *resourceNumber,
+                                       int wantedInstance)
+{
+    bool success = false;
+    int index;
+    M2MResourceBase::ResourceType type;
+
+    // Find the resource type from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        type = _defObject->resources[index].type;
+        // Get the value
+        if (type == M2MResourceBase::STRING) {
+            success = getResourceValue((void *) value, type, index);
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a given enumerated resource in an object.
+bool M2MObjectHelper::getResourceEnumIndex(uint8_t *enumIndex,
+                                           const char *resourceNumber,
+                                           int wantedInstance)
+{
+    bool success = false;
+    int index;
+    const DefResourceOptions *options;
+
+    // Find the resource from the object definition
+    index = findResource(resourceNumber, wantedInstance);
+    if (index >= 0) {
+        options = getResourceOptions(index);
+        if ((options != NULL) && (options->enumValues != NULL)) {
+            *enumIndex = _resourceStates[index].enumIndex;
+            success = true;
+        }
+    }
+
+    return success;
+}
+
+// Get the value of a resource if it has changed.
+bool M2MObjectHelper::getIfChanged(int64_t *value,
+                                   uint32_t *version,
+                                   const char *resourceNumber,
+                                   int wantedInstance)
+{
+    uint32_t current = getResourceVersion(resourceNumber, wantedInstance);
+    bool success = false;
+
+    if ((current != *version) &&
+        getResourceValue(value, resourceNumber, wantedInstance)) {
+        *version = current;
+        success = true;
+    }
+
+    return success;
+}
+
+// Get the value of a resource if it has changed.
+bool M2MObjectHelper::getIfChanged(float *value,
+                                   uint32_t *version,
+                                   const char *resourceNumber,
+                                   int wantedInstance)
+{
+    uint32_t current = getResourceVersion(resourceNumber, wantedInstance);
+    bool success = false;
+
+    if ((current != *version) &&
+        getResourceValue(value, resourceNumber, wantedInstance)) {
+        *version = current;
+        success = true;
+    }
+
+    return success;
+}
+
+// Get the value of a resource if it has changed.
+bool M2MObjectHelper::getIfChanged(bool *value,
+                                   uint32_t *version,
+                                   const char *resourceNumber,
+                                   int wantedInstance)
+{
+    uint32_t current = getResourceVersion(resourceNumber, wantedInstance);
+    bool success = false;
+
+    if ((current != *version) &&
+        getResourceValue(value, resourceNumber, wantedInstance)) {
+        *version = current;
+        success = true;
+    }
+
+    return success;
+}
+
+// Get the value of a resource if it has changed.
+bool M2MObjectHelper::getIfChanged(char *value,
+                                   unsigned int len,
+                                   uint32_t *version,
+                                   const char *resourceNumber,
+                                   int wantedInstance)
+{
+    uint32_t current = getResourceVersion(resourceNumber, wantedInstance);
+    bool success = false;
+
+    if ((current != *version) &&
+        getResourceValue(value, len, resourceNumber, wantedInstance)) {
+        *version = current;
+        success = true;
+    }
+
+    return success;
+}
+
+// Get the value of a resource if it has changed.
+bool M2MObjectHelper::getIfChanged(String *value,
+                                   uint32_t *version,
+                                   const char *resourceNumber,
+                                   int wantedInstance)
+{
+    uint32_t current = getResourceVersion(resourceNumber, wantedInstance);
+    bool success = false;
+
+    if ((current != *version) &&
+        getResourceValue(value, resourceNumber, wantedInstance)) {
+        *version = current;
+        success = true;
+    }
+
+    return success;
+}
+
+// Get the value of an enumerated resource if it has changed.
+bool M2MObjectHelper::getEnumIndexIfChanged(uint8_t *enumIndex,
+                                            uint32_t *version,
+                                            const char *resourceNumber,
+                                            int wantedInstance)
+{
+    uint32_t current = getResourceVersion(resourceNumber, wantedInstance);
+    bool success = false;
+
+    if ((current != *version) &&
+        getResourceEnumIndex(enumIndex, resourceNumber, wantedInstance)) {
+        *version = current;
+        success = true;
+    }
+
+    return success;
+}
+
+// Return this object.
+M2MObject *M2MObjectHelper::getObject()
+{
+    return _object;
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Constructor (private so that this can only be sub-classed).
+M2MObjectHelper::M2MObjectHelper(const DefObject *defObject,
+                                 value_updated_callback valueUpdatedCallback,
+                                 M2MObject *object,
+                                 bool debugOn)
+{
+    _debugOn = debugOn;
+    _defObject = defObject;
+    _object = object;
+    _objectInstance = NULL;
+    _instance = 0;
+    _numResourcesMade = 0;
+    _numResourcesFailed = 0;
+    _startupPriority = STARTUP_PRIORITY_NORMAL;
+    _linkFragment[0] = 0;
+    _linkFragmentLength = 0;
+    _version = 0;
+    _notificationsConfirmable = true;
+    if (defObject != NULL) {
+        _instance = defObject->instance;
+    }
+    _valueUpdatedCallback = valueUpdatedCallback;
+    _journal = NULL;
+    _pool = NULL;
+    _links = NULL;
+#if STALE_VALUES
+    _wheel = NULL;
+#endif
+    for (int x = 0; x < MAX_NUM_RESOURCES; x++) {
+        _resourceStates[x].handle = NULL;
+        _resourceStates[x].binding.helper = this;
+        _resourceStates[x].binding.index = x;
+        _resourceStates[x].stringInline = NULL;
+        _resourceStates[x].stringInlineLength = 0;
+        _resourceStates[x].stringHeap = NULL;
+        _resourceStates[x].stringHeapLength = 0;
+        _resourceStates[x].stringLength = 0;
+        _resourceStates[x].stringValid = false;
+        _resourceStates[x].stringServed = false;
+        _resourceStates[x].enumIndex = ENUM_INDEX_NONE;
+#if OPAQUE_WRITE_STREAMING
+        _resourceStates[x].opaqueOffset = 0;
+        _resourceStates[x].opaqueTotalLength = 0;
+        _resourceStates[x].opaqueBlockSize = 0;
+        _resourceStates[x].opaqueBlockwise = false;
+#endif
+#if RESOURCE_VERSIONS
+        _resourceStates[x].version = 0;
+#endif
+#if ACKNOWLEDGED_VALUES
+        _resourceStates[x].queuedVersion = 0;
+        _resourceStates[x].sentVersion = 0;
+        _resourceStates[x].ackedVersion = 0;
+#endif
+#if STALE_VALUES
+        M2MTimerWheel::init(&(_resourceStates[x].staleTimer), NULL, NULL);
+        _resourceStates[x].lastSet = 0;
+        _resourceStates[x].stale = false;
+#endif
+    }
+    _stringStorage = NULL;
+    _stringStorageOwned = false;
+    for (int x = 0; x < RESOURCE_LOOKUP_CACHE_SIZE; x++) {
+        _lookupCache[x].sequence = 0;
+        _lookupCache[x].resourceNumber = NULL;
+        _lookupCache[x].wantedInstance = 0;
+        _lookupCache[x].index = -1;
+        _lookupCache[x].handle = NULL;
+    }
+    _lookupCacheNext = 0;
+#if RESOURCE_HASH
+    _hashValid = false;
+#endif
+}
+
+/**********************************************************************
+ * PRIVATE METHODS
+ **********************************************************************/
+
+// Attach a newly created resource to the helper.
+void M2MObjectHelper::bindResource(int index)
+{
+    M2MResourceBase *handle = _resourceStates[index].handle;
+    ResourceBinding *binding = &(_resourceStates[index].binding);
+
+    profileBeginCall("set_operation");
+    handle->set_operation(_defObject->resources[index].operation);
+    profileEnd();
+    profileBeginCall("set_value_updated_function");
+    handle->set_value_updated_function(value_updated_callback(binding,
+                                                              &ResourceBinding::valueUpdated));
+    profileEnd();
+#if OPAQUE_WRITE_STREAMING
+    if ((_defObject->resources[index].type == M2MResourceBase::OPAQUE) &&
+        (_defObject->resources[index].operation & M2MBase::PUT_ALLOWED)) {
+        // With a callback, Mbed Client hands us writes block by block
+        if (_opaqueWriteCallback) {
+            handle->set_incoming_block_message_callback(incoming_block_message_callback(binding,
+                                                                                        &ResourceBinding::blockReceived));
+        } else {
+            handle->set_incoming_block_message_callback(NULL);
+        }
+    }
+#endif
+    if ((_defObject->resources[index].type == M2MResourceBase::OPAQUE) &&
+        (getResourceOptions(index) != NULL) && (getResourceOptions(index)->filePath != NULL)) {
+        // Mbed Client asks us for the contents of the file when the server reads it
+        printfLog("M2MObjectHelper: resource \"%s\" is backed by file \"%s\".\n",
+                  _defObject->resources[index].name, getResourceOptions(index)->filePath);
+        handle->set_read_resource_function(&ResourceBinding::readFileValue, binding);
+        handle->set_resource_read_size_function(&ResourceBinding::readFileValueSize, binding);
+    }
+#if ACKNOWLEDGED_VALUES
+    if (_defObject->resources[index].observable) {
+        // So that we know what the server has, see republish()
+        handle->set_notification_delivery_status_cb(&ResourceBinding::notificationStatus, binding);
+    }
+#endif
+    if (getConstValue(index) != NULL) {
+        // Mbed Client asks us for the value when the server reads it
+        printfLog("M2MObjectHelper: resource \"%s\" has constant value \"%s\".\n",
+                  _defObject->resources[index].name, getConstValue(index));
+        handle->set_read_resource_function(&ResourceBinding::readConstValue, binding);
+        handle->set_resource_read_size_function(&ResourceBinding::readConstValueSize, binding);
+    } else if ((_defObject->resources[index].type == M2MResourceBase::STRING) &&
+               !_defObject->resources[index].observable) {
+        // Likewise for a STRING value that is never notified, which
+        // is then only ever held by us; Mbed Client builds
+        // notifications from its own copy, so an observable one
+        // still has to be given to it
+        handle->set_read_resource_function(&ResourceBinding::readStringValue, binding);
+        handle->set_resource_read_size_function(&ResourceBinding::readStringValueSize, binding);
+        _resourceStates[index].stringServed = true;
+    }
+}
+
+#if OPAQUE_WRITE_STREAMING
+// Handle a block of a value written by the server to an OPAQUE resource.
+void M2MObjectHelper::opaqueBlockReceived(int index, M2MBlockMessage *message)
+{
+    const DefResource *defResource = &(_defObject->resources[index]);
+    ResourceState *state = &(_resourceStates[index]);
+    OpaqueBlock block;
+    uint32_t start;
+    uint32_t skip;
+
+    if (message == NULL) {
+        return;
+    }
+    state->opaqueBlockwise = true;
+
+    block.data = message->block_data();
+    block.length = message->block_data_len();
+    block.totalLength = message->total_message_size();
+    block.last = message->is_last_block();
+
+    if (message->block_number() == 0) {
+        // The start of a value: carry on from where we got to
+        // only if it is the same value
+        if ((block.totalLength != state->opaqueTotalLength) ||
+            (state->opaqueOffset >= block.totalLength)) {
+            state->opaqueOffset = 0;
+        }
+        state->opaqueTotalLength = block.totalLength;
+        state->opaqueBlockSize = 0;
+    }
+    if ((state->opaqueBlockSize == 0) && !block.last) {
+        state->opaqueBlockSize = block.length;
+    }
+    start = message->block_number() * state->opaqueBlockSize;
+
+    if ((start > state->opaqueOffset) ||
+        ((state->opaqueBlockSize == 0) && (message->block_number() > 0))) {
+        printfLog("M2MObjectHelper: block %d of resource \"%s\", instance %d, in object \"%s\" is beyond the %u byte(s) received so far.\n",
+                  message->block_number(), defResource->name, defResource->instance, _defObject->name,
+                  (unsigned int) state->opaqueOffset);
+        return;
+    }
+
+    // Skip anything that has been dealt with already
+    skip = state->opaqueOffset - start;
+    if ((skip < block.length) || ((skip == block.length) && block.last)) {
+        block.data += skip;
+        block.length -= skip;
+        block.offset = state->opaqueOffset;
+        printfLog("M2MObjectHelper: %u byte(s) at offset %u of resource \"%s\", instance %d, in object \"%s\" written by server%s.\n",
+                  (unsigned int) block.length, (unsigned int) block.offset, defResource->name,
+                  defResource->instance, _defObject->name, block.last ? " (last)" : "");
+        if (!_opaqueWriteCallback || _opaqueWriteCallback(defResource->name, defResource->instance, &block)) {
+            state->opaqueOffset += block.length;
+        } else {
+            printfLog("M2MObjectHelper: block not accepted (the server will not know).\n");
+        }
+    }
+}
+
+// Pass a value written to an OPAQUE resource in a single message,
+// which Mbed Client does not offer block-wise, on as one block.
+void M2MObjectHelper::opaqueValueReceived(int index)
+{
+    const DefResource *defResource = &(_defObject->resources[index]);
+    ResourceState *state = &(_resourceStates[index]);
+    OpaqueBlock block;
+
+    block.data = state->handle->value();
+    block.length = state->handle->value_length();
+    block.offset = 0;
+    block.totalLength = block.length;
+    block.last = true;
+
+    state->opaqueOffset = 0;
+    state->opaqueTotalLength = block.totalLength;
+    state->opaqueBlockSize = 0;
+    printfLog("M2MObjectHelper: %u byte(s) of resource \"%s\", instance %d, in object \"%s\" written by server in one go.\n",
+              (unsigned int) block.length, defResource->name, defResource->instance, _defObject->name);
+    if (_opaqueWriteCallback(defResource->name, defResource->instance, &block)) {
+        state->opaqueOffset = block.length;
+    } else {
+        printfLog("M2MObjectHelper: value not accepted (the server will not know).\n");
+    }
+}
+#endif
+
+#if FILE_VALUE_PREAD
+
+// Get the length of the value of a file-backed resource.
+bool M2MObjectHelper::getFileValueLength(int index, size_t *length)
+{
+    const char *filePath = getResourceOptions(index)->filePath;
+    struct stat status;
+
+    if (stat(filePath, &status) != 0) {
+        printfLog("M2MObjectHelper: unable to stat file \"%s\".\n", filePath);
+        return false;
+    }
+    *length = status.st_size;
+
+    return true;
+}
+
+// Read the value of a file-backed resource into a buffer; a file
+// that has shrunk since its length was got just gives fewer bytes.
+bool M2MObjectHelper::readFileValue(int index, void *buffer, size_t *length)
+{
+    const char *filePath = getResourceOptions(index)->filePath;
+    size_t done = 0;
+    ssize_t got = 1;
+    int fd;
+
+    fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printfLog("M2MObjectHelper: unable to open file \"%s\".\n", filePath);
+        return false;
+    }
+    // pread() may return less than asked for, so carry on until
+    // the buffer is full or the end of the file
+    while ((done < *length) && (got > 0)) {
+        got = pread(fd, (uint8_t *) buffer + done, *length - done, done);
+        if (got > 0) {
+            done += got;
+        } else if ((got < 0) && (errno == EINTR)) {
+            got = 1;
+        }
+    }
+    close(fd);
+    if (got < 0) {
+        printfLog("M2MObjectHelper: unable to read file \"%s\".\n", filePath);
+        return false;
+    }
+    if (done < *length) {
+        printfLog("M2MObjectHelper: file \"%s\" shrank, %u byte(s) of %u read.\n",
+                  filePath, (unsigned int) done, (unsigned int) *length);
+    }
+    *length = done;
+
+    return true;
+}
+
+#else
+
+// Get the length of the value of a file-backed resource.
+bool M2MObjectHelper::getFileValueLength(int index, size_t *length)
+{
+    const char *filePath = getResourceOptions(index)->filePath;
+    FILE *file;
+    long size = -1;
+
+    file = fopen(filePath, "rb");
+    if (file != NULL) {
+        if (fseek(file, 0, SEEK_END) == 0) {
+            size = ftell(file);
+        }
+        fclose(file);
+    }
+    if (size < 0) {
+        printfLog("M2MObjectHelper: unable to get the size of file \"%s\".\n", filePath);
+        return false;
+    }
+    *length = size;
+
+    return true;
+}
+
+// Read the value of a file-backed resource into a buffer.
+bool M2MObjectHelper::readFileValue(int index, void *buffer, size_t *length)
+{
+    const char *filePath = getResourceOptions(index)->filePath;
+    bool success = true;
+    size_t wanted = *length;
+    FILE *file;
+
+    file = fopen(filePath, "rb");
+    if (file == NULL) {
+        printfLog("M2MObjectHelper: unable to open file \"%s\".\n", filePath);
+        return false;
+    }
+    *length = fread(buffer, 1, wanted, file);
+    // A short read is the end of a file that has shrunk, unless
+    // it is an error
+    if ((*length < wanted) && ferror(file)) {
+        printfLog("M2MObjectHelper: unable to read file \"%s\".\n", filePath);
+        success = false;
+    }
+    fclose(file);
+
+    return success;
+}
+
+#endif
+
+// Get the constant value of a resource.
+const char *M2MObjectHelper::getConstValue(int index)
+{
+    const DefResourceOptions *options = getResourceOptions(index);
+    const char *value = NULL;
+
+    if (options != NULL) {
+        value = options->constValue;
+    }
+
+    return value;
+}
+
+// Get the options for a resource.
+const M2MObjectHelper::DefResourceOptions *M2MObjectHelper::getResourceOptions(int index)
+{
+    const DefResourceOptions *options = NULL;
+
+    if (_defObject->resourceOptions != NULL) {
+        options = &(_defObject->resourceOptions[index]);
+    }
+
+    return options;
+}
+
+// Set up the storage for the values of STRING resources.
+bool M2MObjectHelper::makeStringStorage(const M2MObjectHelper *prototype, char *storage)
+{
+    ResourceState *state;
+    const DefResourceOptions *options;
+    unsigned int size = 0;
+    unsigned int length;
+    unsigned int blockSize;
+
+    for (int x = 0; x < _defObject->numResources; x++) {
+        state = &(_resourceStates[x]);
+        options = getResourceOptions(x);
+        state->stringInline = NULL;
+        state->stringInlineLength = 0;
+        state->stringValid = false;
+        state->enumIndex = ENUM_INDEX_NONE;
+        if (prototype != NULL) {
+            // Just as the prototype started out
+            state->stringInlineLength = prototype->_resourceStates[x].stringInlineLength;
+            if ((options != NULL) && (options->constValue != NULL)) {
+                state->stringLength = prototype->_resourceStates[x].stringLength;
+                state->stringValid = true;
+            }
+            if (state->stringInlineLength > 0) {
+                size += state->stringInlineLength + 1;
+            }
+        } else if ((options != NULL) && (options->constValue != NULL)) {
+            // Constant and enumerated values live in the DefResourceOptions
+            state->stringLength = strlen(options->constValue);
+            state->stringValid = true;
+        } else if ((_defObject->resources[x].type == M2MResourceBase::STRING) &&
+                   ((options == NULL) || (options->enumValues == NULL))) {
+            length = STRING_INLINE_LENGTH;
+            if ((options != NULL) && (options->stringInlineLength > 0)) {
+                length = options->stringInlineLength;
+            }
+            state->stringInlineLength = length;
+            size += length + 1;
+        }
+    }
+
+    if ((size > 0) && (_stringStorage == NULL)) {
+        if (storage != NULL) {
+            _stringStorage = storage;
+        } else {
+            blockSize = 0;
+            if (_pool != NULL) {
+                blockSize = _pool->getBlockSize(M2MObjectPool::BLOCK_TYPE_STRINGS);
+            }
+            if ((blockSize > 0) && (size > blockSize)) {
+                printfLog("M2MObjectHelper: object \"%s\" needs %u byte(s) for STRING values but"
+                          " its pool has %u byte block(s), using the heap.\n",
+                          _defObject->name, size, blockSize);
+            }
+            _stringStorage = M2MObjectPool::takeFrom(_pool, M2MObjectPool::BLOCK_TYPE_STRINGS, size);
+            _stringStorageOwned = (_stringStorage != NULL);
+        }
+    }
+
+    if (_stringStorage != NULL) {
+        size = 0;
+        for (int x = 0; x < _defObject->numResources; x++) {
+            state = &(_resourceStates[x]);
+            if (state->stringInlineLength > 0) {
+                state->stringInline = _stringStorage + size;
+                *(state->stringInline) = 0;
+                size += state->stringInlineLength + 1;
+            }
+        }
+    } else if (size > 0) {
+        printfLog("M2MObjectHelper: unable to allocate %u byte(s) for the values of STRING resources in object \"%s\".\n",
+                  size, _defObject->name);
+    }
+
+    return (size == 0) || (_stringStorage != NULL);
+}
+
+// Get the value of a STRING resource as held by the helper.
+const char *M2MObjectHelper::getStringValue(int index)
+{
+    const ResourceState *state = &(_resourceStates[index]);
+    const char *value = NULL;
+
+    if (state->stringValid) {
+        if (getConstValue(index) != NULL) {
+            value = getConstValue(index);
+        } else if (state->enumIndex != ENUM_INDEX_NONE) {
+            value = getResourceOptions(index)->enumValues[state->enumIndex];
+        } else {
+            value = state->stringInline;
+            if (state->stringLength > state->stringInlineLength) {
+                value = state->stringHeap;
+            }
+        }
+    }
+
+    return value;
+}
+
+// Update the value of a STRING resource as held by the helper.
+void M2MObjectHelper::updateStringValue(int index, const char *value,
+                                        unsigned int length)
+{
+    ResourceState *state = &(_resourceStates[index]);
+    const DefResourceOptions *options = getResourceOptions(index);
+    char *destination = state->stringInline;
+    M2MObjectPool *pool;
+    unsigned int heapLength;
+
+    if ((options != NULL) && (options->enumValues != NULL)) {
+        // Enumerated, just need to know which one
+        state->stringValid = false;
+        state->enumIndex = ENUM_INDEX_NONE;
+        for (int x = 0; (x < options->numEnumValues) && !state->stringValid; x++) {
+            if ((strlen(options->enumValues[x]) == length) &&
+                (memcmp(options->enumValues[x], value, length) == 0)) {
+                state->enumIndex = x;
+                state->stringLength = length;
+                state->stringValid = true;
+            }
+        }
+        return;
+    }
+
+    if ((length > state->stringInlineLength) && (destination != NULL)) {
+        // Too long to go inline, use the heap
+        if ((length > state->stringHeapLength) && (length <= UINT16_MAX)) {
+            M2MObjectPool::giveBack(state->stringHeap);
+            pool = NULL;
+            heapLength = length;
+            if ((_pool != NULL) &&
+                (length < _pool->getBlockSize(M2MObjectPool::BLOCK_TYPE_SPILL)) &&
+                (_pool->getBlockSize(M2MObjectPool::BLOCK_TYPE_SPILL) <= UINT16_MAX)) {
+                // Fits a block of the pool, which may as well be used in full
+                pool = _pool;
+                heapLength = _pool->getBlockSize(M2MObjectPool::BLOCK_TYPE_SPILL) - 1;
+            }
+            state->stringHeap = M2MObjectPool::takeFrom(pool, M2MObjectPool::BLOCK_TYPE_SPILL, heapLength + 1);
+            state->stringHeapLength = (state->stringHeap != NULL) ? heapLength : 0;
+        }
+        destination = NULL;
+        if (length <= state->stringHeapLength) {
+            destination = state->stringHeap;
+        }
+    }
+
+    state->stringValid = false;
+    if (destination != NULL) {
+        if (length > 0) {
+            memcpy(destination, value, length);
+        }
+        *(destination + length) = 0;
+        state->stringLength = length;
+        state->stringValid = true;
+    }
+}
+
+// Set the value of a STRING resource.
+bool M2MObjectHelper::setStringValue(const char *value, unsigned int length,
+                                     int index)
+{
+    bool success = false;
+    const DefResource *defResource = &(_defObject->resources[index]);
+    M2MResourceBase *handle = _resourceStates[index].handle;
+    const DefResourceOptions *options = getResourceOptions(index);
+    const char *oldValue = getStringValue(index);
+
+    if ((options != NULL) && (options->constValue != NULL)) {
+        printfLog("M2MObjectHelper: resource \"%s\", instance %d, in object \"%s\" has a constant value.\n",
+                  defResource->name, defResource->instance, _defObject->name);
+        handle = NULL;
+    } else if ((options != NULL) && (options->enumValues != NULL)) {
+        // Enumerated, the value must be one of the set
+        for (int x = 0; x < options->numEnumValues; x++) {
+            if ((strlen(options->enumValues[x]) == length) &&
+                (memcmp(options->enumValues[x], value, length) == 0)) {
+                return setEnumValue(x, index);
             }
+        }
+        printfLog("M2MObjectHelper: \"%.*s\" is not one of the values of resource \"%s\", instance %d, in object \"%s\".\n",
+                  (int) length, value, defResource->name, defResource->instance, _defObject->name);
+        handle = NULL;
+    } else if (handle != NULL) {
+        printfLog("M2MObjectHelper: setting value of resource \"%s\", instance %d (-1 == single instance), in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
+
+        if ((oldValue != NULL) && (length == _resourceStates[index].stringLength) &&
+            (memcmp(value, oldValue, length) == 0)) {
+            // No change, no need to bother Mbed Client
+            printfLog("M2MObjectHelper:   STRING resource unchanged at \"%.*s\".\n", (int) length, value);
+            success = true;
         } else {
-            printfLog("M2MObjectHelper: unable to get instance of object \"%s\".\n", _object->name());
+            printfLog("M2MObjectHelper:   STRING resource set to \"%.*s\".\n", (int) length, value);
+            if (_resourceStates[index].stringServed) {
+                // Only we hold it
+                updateStringValue(index, value, length);
+                success = _resourceStates[index].stringValid;
+            } else {
+                success = setHandleValue(value, length, index);
+                if (success) {
+                    updateStringValue(index, value, length);
+                }
+            }
+            if (success) {
+                valueChanged(index);
+            }
         }
     } else {
-        printfLog("M2MObjectHelper: object is NULL.\n");
+        printfLog("M2MObjectHelper: unable to find resource \"%s\", instance %d, in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
+    }
+    if (success) {
+        valueSet(index);
     }
 
     return success;
 }
 
-
-// Set the value of a given resource in an object.
-bool M2MObjectHelper::setResourceValue(int64_t value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Set the value of an enumerated STRING resource.
+bool M2MObjectHelper::setEnumValue(uint8_t enumIndex, int index)
 {
     bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
-
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
+    const DefResource *defResource = &(_defObject->resources[index]);
+    ResourceState *state = &(_resourceStates[index]);
+    const DefResourceOptions *options = getResourceOptions(index);
+    const char *value;
+
+    if ((state->handle != NULL) && (enumIndex < options->numEnumValues)) {
+        printfLog("M2MObjectHelper: setting value of resource \"%s\", instance %d (-1 == single instance), in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
+        value = options->enumValues[enumIndex];
+        if (state->stringValid && (state->enumIndex == enumIndex)) {
+            // No change, no need to bother Mbed Client
+            printfLog("M2MObjectHelper:   STRING resource unchanged at \"%s\" (%d).\n", value, enumIndex);
+            success = true;
+        } else {
+            // Mbed Client still needs the text for notifications,
+            // unless it asks us for the value
+            printfLog("M2MObjectHelper:   STRING resource set to \"%s\" (%d).\n", value, enumIndex);
+            success = true;
+            if (!state->stringServed) {
+                success = setHandleValue(value, strlen(value), index);
+            }
+            if (success) {
+                state->enumIndex = enumIndex;
+                state->stringLength = strlen(value);
+                state->stringValid = true;
+                valueChanged(index);
+            }
         }
+    } else {
+        printfLog("M2MObjectHelper: unable to set resource \"%s\", instance %d, in object \"%s\" to enumerated value %d.\n",
+                  defResource->name, defResource->instance, _defObject->name, enumIndex);
     }
-
-    if (foundIt &&
-        ((type == M2MResourceBase::INTEGER) ||
-          type == M2MResourceBase::TIME)) {
-        success = setResourceValue((void *) &value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
+    if (success) {
+        valueSet(index);
     }
 
     return success;
 }
 
-// Set the value of a given resource in an object.
-bool M2MObjectHelper::setResourceValue(float value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Set the value of a non-STRING resource as text.
+bool M2MObjectHelper::setTextValue(const char *text, unsigned int length,
+                                   int index)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
+    bool success = true;
+    M2MResourceBase *handle = _resourceStates[index].handle;
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
+    if ((handle->value_length() == length) &&
+        ((length == 0) || (memcmp(handle->value(), text, length) == 0))) {
+        // No change, no need to bother Mbed Client
+        printfLog("M2MObjectHelper:   value unchanged.\n");
+    } else {
+        success = setHandleValue(text, length, index);
+        if (success) {
+            valueChanged(index);
         }
     }
-
-    if (foundIt && (type == M2MResourceBase::FLOAT)) {
-        success = setResourceValue((void *) &value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
+    if (success) {
+        valueSet(index);
     }
 
     return success;
 }
 
-// Set the value of a given resource in an object.
-bool M2MObjectHelper::setResourceValue(bool value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Give Mbed Client a new value for a resource.
+bool M2MObjectHelper::setHandleValue(const char *value, unsigned int length,
+                                     int index)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
-
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
-        }
-    }
+    bool success;
 
-    if (foundIt && (type == M2MResourceBase::BOOLEAN)) {
-        success = setResourceValue((void *) &value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
-    }
+#if ACKNOWLEDGED_VALUES
+    // Mbed Client may queue a notification of the value at once,
+    // and it carries the version valueChanged() will give it
+    _resourceStates[index].queuedVersion = _version + 1;
+#endif
+    profileBeginCall("set_value");
+    success = _resourceStates[index].handle->set_value((const uint8_t *) value, length);
+    profileEnd();
 
     return success;
-
 }
 
-// Set the value of a given resource in an object.
-bool M2MObjectHelper::setResourceValue(const char *value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Get the version of the value of a resource.
+uint32_t M2MObjectHelper::getVersion(int index) const
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
-    const char * format;
-    String *str = new String(value);
+#if RESOURCE_VERSIONS
+    return _resourceStates[index].version;
+#else
+    (void) index;
+    return _version;
+#endif
+}
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            format = _defObject->resources[x].format;
-            foundIt = true;
-        }
+// Note that the value of a resource has changed.
+void M2MObjectHelper::valueChanged(int index)
+{
+    M2MChangeRing::Change change;
+
+    _version++;
+#if RESOURCE_VERSIONS
+    _resourceStates[index].version = _version;
+#endif
+    if (_changeRing != NULL) {
+        change.object = this;
+        change.objectName = _defObject->name;
+        change.objectInstance = _instance;
+        change.resourceName = _defObject->resources[index].name;
+        change.resourceInstance = _defObject->resources[index].instance;
+        change.version = _version;
+        _changeRing->record(&change);
     }
+}
 
-    if (foundIt && (type == M2MResourceBase::STRING)) {
-        success = setResourceValue((void *) str,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance,
-                                   format);
+// Start the stale timers of the resources of a newly made object.
+void M2MObjectHelper::startStaleTimers()
+{
+#if STALE_VALUES
+    ResourceState *state;
+
+    for (int x = 0; x < _numResourcesMade; x++) {
+        state = &(_resourceStates[x]);
+        if ((state->staleTimer.callback != NULL) && !M2MTimerWheel::isRunning(&(state->staleTimer))) {
+            // Each resource gets its first interval in which to be set
+            state->lastSet = _wheel->getTime();
+            _wheel->start(&(state->staleTimer), getResourceOptions(x)->maxUpdateIntervalMs);
+        }
     }
-
-    return success;
+#endif
 }
 
-// Set the value of a given resource in an object.
-bool M2MObjectHelper::setResourceValue(String value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Note that a resource has been set.
+void M2MObjectHelper::valueSet(int index)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
-    const char * format;
+#if STALE_VALUES
+    ResourceState *state = &(_resourceStates[index]);
+    const DefResource *defResource;
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            format = _defObject->resources[x].format;
-            foundIt = true;
+    if (state->staleTimer.callback != NULL) {
+        // Just the time: the timer looks at it when it expires
+        state->lastSet = _wheel->getTime();
+        if (state->stale) {
+            defResource = &(_defObject->resources[index]);
+            printfLog("M2MObjectHelper: resource \"%s\", instance %d, in object \"%s\" is no longer stale.\n",
+                      defResource->name, defResource->instance, _defObject->name);
+            state->stale = false;
+            _wheel->start(&(state->staleTimer), getResourceOptions(index)->maxUpdateIntervalMs);
+            if (_staleCallback) {
+                _staleCallback(defResource->name, defResource->instance, false);
+            }
         }
     }
+#else
+    (void) index;
+#endif
+}
+
+#if STALE_VALUES
 
-    if (foundIt && (type == M2MResourceBase::STRING)) {
-        success = setResourceValue((void *) &value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance,
-                                   format);
+// Deal with the expiry of the stale timer of a resource.
+void M2MObjectHelper::staleTimerExpired(int index)
+{
+    ResourceState *state = &(_resourceStates[index]);
+    const DefResource *defResource = &(_defObject->resources[index]);
+    uint32_t interval = getResourceOptions(index)->maxUpdateIntervalMs;
+    uint32_t elapsed = _wheel->getTime() - state->lastSet;
+
+    if (elapsed < interval) {
+        // Set in the meantime, wait for the rest of the interval
+        _wheel->start(&(state->staleTimer), interval - elapsed);
+    } else {
+        printfLog("M2MObjectHelper: resource \"%s\", instance %d, in object \"%s\" is stale, not set for %d ms.\n",
+                  defResource->name, defResource->instance, _defObject->name, (int) elapsed);
+        state->stale = true;
+        if (_staleCallback) {
+            _staleCallback(defResource->name, defResource->instance, true);
+        }
     }
+}
+#endif
 
-    return success;
+// Pass a value updated callback from Mbed Client to the helper.
+void M2MObjectHelper::ResourceBinding::valueUpdated(const char *resourceName)
+{
+    helper->resourceWritten(index, resourceName);
 }
 
-// Get the value of a given resource in an object.
-bool M2MObjectHelper::getResourceValue(int64_t *value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+#if OPAQUE_WRITE_STREAMING
+// Pass a block of an OPAQUE value from Mbed Client to the helper.
+void M2MObjectHelper::ResourceBinding::blockReceived(M2MBlockMessage *message)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
+    helper->opaqueBlockReceived(index, message);
+}
+#endif
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
-        }
-    }
+// Serve a constant value to Mbed Client; returns 0 on success.
+int M2MObjectHelper::ResourceBinding::readConstValue(const M2MResourceBase &resource,
+                                                     void *buffer, size_t *bufferSize,
+                                                     void *clientArgs)
+{
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
+    const char *value = binding->helper->getConstValue(binding->index);
+    size_t length = strlen(value);
 
-    // Get the value
-    if (foundIt &&
-       ((type == M2MResourceBase::INTEGER) ||
-         type == M2MResourceBase::TIME)) {
-        success = getResourceValue((void *) value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
+    (void) resource;
+    if (length > *bufferSize) {
+        return -1;
     }
+    memcpy(buffer, value, length);
+    *bufferSize = length;
 
-    return success;
+    return 0;
 }
 
-// Get the value of a given resource in an object.
-bool M2MObjectHelper::getResourceValue(float *value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Serve the value of a STRING resource to Mbed Client from the
+// helper's copy, or from Mbed Client's if the server wrote something
+// the helper could not hold (e.g. not one of an enumeration); returns
+// 0 on success.
+int M2MObjectHelper::ResourceBinding::readStringValue(const M2MResourceBase &resource,
+                                                      void *buffer, size_t *bufferSize,
+                                                      void *clientArgs)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
+    const char *value = binding->helper->getStringValue(binding->index);
+    size_t length;
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
-        }
+    if (value != NULL) {
+        length = binding->helper->_resourceStates[binding->index].stringLength;
+    } else {
+        value = (const char *) resource.value();
+        length = resource.value_length();
     }
-
-    // Get the value
-    if (foundIt && (type == M2MResourceBase::FLOAT)) {
-        success = getResourceValue((void *) value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
+    if (length > *bufferSize) {
+        return -1;
     }
+    if (length > 0) {
+        memcpy(buffer, value, length);
+    }
+    *bufferSize = length;
 
-    return success;
+    return 0;
 }
 
-// Get the value of a given resource in an object.
-bool M2MObjectHelper::getResourceValue(bool *value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Give Mbed Client the size of the value of a STRING resource;
+// returns 0 on success.
+int M2MObjectHelper::ResourceBinding::readStringValueSize(const M2MResourceBase &resource,
+                                                          size_t *bufferSize,
+                                                          void *clientArgs)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
-        }
+    if (binding->helper->getStringValue(binding->index) != NULL) {
+        *bufferSize = binding->helper->_resourceStates[binding->index].stringLength;
+    } else {
+        *bufferSize = resource.value_length();
     }
 
-    // Get the value
-    if (foundIt && (type == M2MResourceBase::BOOLEAN)) {
-        success = getResourceValue((void *) value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
+    return 0;
+}
+
+#if ACKNOWLEDGED_VALUES
+// Track what the server has been sent and has confirmed receiving.
+void M2MObjectHelper::ResourceBinding::notificationStatus(const M2MBase &base,
+                                                         const M2MBase::NotificationDeliveryStatus status,
+                                                         void *clientArgs)
+{
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
+    ResourceState *state = &(binding->helper->_resourceStates[binding->index]);
+
+    (void) base;
+    if (status == M2MBase::NOTIFICATION_STATUS_SENT) {
+        state->sentVersion = state->queuedVersion;
+    } else if (status == M2MBase::NOTIFICATION_STATUS_DELIVERED) {
+        state->ackedVersion = state->sentVersion;
     }
+}
+#endif
 
-    return success;
+#if STALE_VALUES
+// Pass the expiry of a stale timer to the helper.
+void M2MObjectHelper::ResourceBinding::staleTimerExpired(void *clientArgs)
+{
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
+
+    binding->helper->staleTimerExpired(binding->index);
 }
+#endif
 
-// Get the value of a given resource in an object.
-bool M2MObjectHelper::getResourceValue(char *value,
-                                       unsigned int len,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Give Mbed Client the size of a constant value; returns 0 on success.
+int M2MObjectHelper::ResourceBinding::readConstValueSize(const M2MResourceBase &resource,
+                                                         size_t *bufferSize,
+                                                         void *clientArgs)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
-    String *str = new String();
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
-        }
+    (void) resource;
+    *bufferSize = strlen(binding->helper->getConstValue(binding->index));
+
+    return 0;
+}
+
+// Serve the contents of a file to Mbed Client; returns 0 on success.
+int M2MObjectHelper::ResourceBinding::readFileValue(const M2MResourceBase &resource,
+                                                    void *buffer, size_t *bufferSize,
+                                                    void *clientArgs)
+{
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
+
+    (void) resource;
+
+    // Mbed Client asks for the whole value and does any block-wise
+    // transfer from its buffer
+    return binding->helper->readFileValue(binding->index, buffer, bufferSize) ? 0 : -1;
+}
+
+// Give Mbed Client the size of a file; returns 0 on success.
+int M2MObjectHelper::ResourceBinding::readFileValueSize(const M2MResourceBase &resource,
+                                                        size_t *bufferSize,
+                                                        void *clientArgs)
+{
+    ResourceBinding *binding = (ResourceBinding *) clientArgs;
+
+    (void) resource;
+
+    return binding->helper->getFileValueLength(binding->index, bufferSize) ? 0 : -1;
+}
+
+// Handle the server having written to a resource.
+void M2MObjectHelper::resourceWritten(int index, const char *resourceName)
+{
+    const DefResource *defResource = &(_defObject->resources[index]);
+    M2MResourceBase *handle = _resourceStates[index].handle;
+    ResourceValue value;
+    String str;
+    bool valueBool;
+    bool gotValue = false;
+
+    printfLog("M2MObjectHelper: resource \"%s\", instance %d (-1 == single instance), in object \"%s\" written by server.\n",
+              defResource->name, defResource->instance, _defObject->name);
+
+    // The server may have written the same value again but
+    // finding out would cost more than it saves; either way
+    // the server has it
+    valueChanged(index);
+#if ACKNOWLEDGED_VALUES
+    _resourceStates[index].ackedVersion = getVersion(index);
+#endif
+
+    // Keep our copy of a STRING value up to date
+    if ((defResource->type == M2MResourceBase::STRING) && (handle != NULL)) {
+        updateStringValue(index, (const char *) handle->value(), handle->value_length());
     }
 
-    // Get the value
-    if (foundIt && (type == M2MResourceBase::STRING)) {
-        success = getResourceValue((void *) str, type, resourceNumber, wantedInstance);
-        // Convert the string
-        if (success) {
-            if (len > 0) {
-                if (str->size() > len - 1) { // -1 for terminator
-                    str->resize(len - 1);
+#if OPAQUE_WRITE_STREAMING
+    // A block-wise write has been passed on already, block by block
+    if ((defResource->type == M2MResourceBase::OPAQUE) && (handle != NULL) && _opaqueWriteCallback &&
+        !_resourceStates[index].opaqueBlockwise) {
+        opaqueValueReceived(index);
+    }
+    _resourceStates[index].opaqueBlockwise = false;
+#endif
+
+    if ((_journal != NULL) && (handle != NULL) && (defResource->type != M2MResourceBase::OPAQUE)) {
+        _journal->append(_defObject->name, _instance, defResource->name, defResource->instance,
+                         (const char *) handle->value(), handle->value_length());
+    }
+
+    if (_resourceWrittenCallback && (handle != NULL)) {
+        memset(&value, 0, sizeof(value));
+        value.type = defResource->type;
+        switch (value.type) {
+            case M2MResourceBase::STRING:
+                value.valueString = getStringValue(index);
+                value.valueLength = _resourceStates[index].stringLength;
+                gotValue = (value.valueString != NULL);
+                if (!gotValue) {
+                    gotValue = getResourceValue((void *) &str, value.type, index);
+                    value.valueString = str.c_str();
+                    value.valueLength = str.size();
                 }
-                memcpy(value, str->c_str(), str->size());
-                *(value + str->size()) = 0; // Add terminator
-            }
+                break;
+            case M2MResourceBase::INTEGER:
+            case M2MResourceBase::TIME:
+                gotValue = getResourceValue((void *) &(value.valueInt64), value.type, index);
+                break;
+            case M2MResourceBase::BOOLEAN:
+                gotValue = getResourceValue((void *) &valueBool, value.type, index);
+                value.valueInt64 = valueBool;
+                break;
+            case M2MResourceBase::FLOAT:
+                gotValue = getResourceValue((void *) &(value.valueFloat), value.type, index);
+                break;
+            case M2MResourceBase::OPAQUE:
+                value.valueString = (const char *) handle->value();
+                value.valueLength = handle->value_length();
+                gotValue = true;
+                break;
+            default:
+                break;
+        }
+        if (gotValue) {
+            _resourceWrittenCallback(defResource->name, defResource->instance, &value);
         }
     }
 
-    return success;
+    if (_valueUpdatedCallback) {
+        _valueUpdatedCallback(resourceName);
+    }
 }
 
-// Get the value of a given resource in an object.
-bool M2MObjectHelper::getResourceValue(String *value,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+// Find a resource in the object definition.
+int M2MObjectHelper::findResource(const char *resourceNumber,
+                                  int wantedInstance,
+                                  M2MResourceBase **handle)
 {
-    bool success = false;
-    bool foundIt = false;
-    M2MResourceBase::ResourceType type;
+    int index = -1;
+    int x;
+    int y;
+#if RESOURCE_HASH
+    uint32_t hash;
+#endif
+    uint32_t sequence;
+    M2MResourceBase *cachedHandle = NULL;
+    LookupCacheEntry *entry;
+
+    if ((_defObject != NULL) && (resourceNumber != NULL)) {
+        // Callers almost always pass in a string literal, so try the
+        // cache by pointer first; the entry is only believed if its
+        // sequence number is even, i.e. no-one is writing it, and is
+        // the same after reading it as before
+        for (x = 0; (x < RESOURCE_LOOKUP_CACHE_SIZE) && (index < 0); x++) {
+            entry = &(_lookupCache[x]);
+            sequence = __atomic_load_n(&(entry->sequence), __ATOMIC_ACQUIRE);
+            if (((sequence & 1) == 0) &&
+                (loadRelaxed(&(entry->resourceNumber)) == resourceNumber) &&
+                (loadRelaxed(&(entry->wantedInstance)) == wantedInstance)) {
+                y = loadRelaxed(&(entry->index));
+                cachedHandle = loadRelaxed(&(entry->handle));
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if ((__atomic_load_n(&(entry->sequence), __ATOMIC_RELAXED) == sequence) &&
+                    (y >= 0) && (y < _defObject->numResources)
+#if !RESOURCE_LOOKUP_CACHE_TRUST_POINTER
+                    && (strcmp(resourceNumber, _defObject->resources[y].name) == 0)
+#endif
+                   ) {
+                    index = y;
+                }
+            }
+        }
 
-    // Find the resource type and format from the object definition
-    for (int x = 0; (x < _defObject->numResources) && !foundIt; x++) {
-        if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
-            (wantedInstance == _defObject->resources[x].instance)) {
-            type = _defObject->resources[x].type;
-            foundIt = true;
+        // Not in the cache: use the perfect hash, if there is one,
+        // else search the definition, and remember the answer
+        if (index < 0) {
+            cachedHandle = NULL;
+#if RESOURCE_HASH
+            if (_hashValid) {
+                hash = hashResource(resourceNumber, wantedInstance);
+                x = _hashIndex[hashSlot(hash,
+                                        _hashDisplacement[hash % _defObject->numResources],
+                                        _defObject->numResources)];
+                if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
+                    (wantedInstance == _defObject->resources[x].instance)) {
+                    index = x;
+                }
+            } else
+#endif
+            {
+                for (x = 0; (x < _defObject->numResources) && (index < 0); x++) {
+                    if ((strcmp(resourceNumber, _defObject->resources[x].name) == 0) &&
+                        (wantedInstance == _defObject->resources[x].instance)) {
+                        index = x;
+                    }
+                }
+            }
+            if (index >= 0) {
+                cacheLookup(resourceNumber, wantedInstance, index);
+            }
         }
-    }
 
-    // Get the value
-    if (foundIt && (type == M2MResourceBase::STRING)) {
-        success = getResourceValue((void *) value,
-                                   type,
-                                   resourceNumber,
-                                   wantedInstance);
+        if ((index >= 0) && (handle != NULL)) {
+            // The entry may have been made before the resource was
+            // created, in which case ask the resource state
+            if (cachedHandle == NULL) {
+                cachedHandle = _resourceStates[index].handle;
+            }
+            *handle = cachedHandle;
+        }
     }
 
-    return success;
+    return index;
 }
 
-// Return this object.
-M2MObject *M2MObjectHelper::getObject()
+// Remember the result of a lookup in the cache.
+void M2MObjectHelper::cacheLookup(const char *resourceNumber,
+                                  int wantedInstance, int index)
 {
-    return _object;
+    LookupCacheEntry *entry;
+    uint32_t next;
+    uint32_t sequence;
+
+    // Two threads may pick the same entry, which costs no more
+    // than the second not caching its answer
+    next = loadRelaxed(&_lookupCacheNext);
+    storeRelaxed(&_lookupCacheNext, next + 1);
+    entry = &(_lookupCache[next % RESOURCE_LOOKUP_CACHE_SIZE]);
+    sequence = __atomic_load_n(&(entry->sequence), __ATOMIC_RELAXED);
+    // Claim the entry by making its sequence number odd; if another
+    // thread has it already, leave it to them
+    if (((sequence & 1) == 0) &&
+        __atomic_compare_exchange_n(&(entry->sequence), &sequence, sequence + 1,
+                                    false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        storeRelaxed(&(entry->resourceNumber), resourceNumber);
+        storeRelaxed(&(entry->wantedInstance), wantedInstance);
+        storeRelaxed(&(entry->index), index);
+        storeRelaxed(&(entry->handle), _resourceStates[index].handle);
+        __atomic_store_n(&(entry->sequence), sequence + 2, __ATOMIC_RELEASE);
+    }
 }
 
-/**********************************************************************
- * PROTECTED METHODS
- **********************************************************************/
-
-// Constructor (private so that this can only be sub-classed).
-M2MObjectHelper::M2MObjectHelper(const DefObject *defObject,
-                                 value_updated_callback valueUpdatedCallback,
-                                 M2MObject *object,
-                                 bool debugOn)
+#if RESOURCE_HASH
+// Build a minimal perfect hash over the resources in the definition.
+bool M2MObjectHelper::makeHash()
 {
-    _debugOn = debugOn;
-    _defObject = defObject;
-    _object = object;
-    _valueUpdatedCallback = valueUpdatedCallback;
-}
+    int numResources = _defObject->numResources;
+    uint32_t hashes[MAX_NUM_RESOURCES];
+    int bucketSize[MAX_NUM_RESOURCES];
+    bool slotUsed[MAX_NUM_RESOURCES];
+    int slots[MAX_NUM_RESOURCES];
+    int maxBucketSize = 0;
+    int numSlots;
+    int displacement;
+    int bucket;
+    int slot;
+    bool bucketFits;
+
+    // Use a precomputed hash if there is one and it works
+    if ((_defObject->hash != NULL) && (numResources > 0)) {
+        _hashValid = true;
+        for (int x = 0; x < numResources; x++) {
+            _hashDisplacement[x] = _defObject->hash->displacement[x];
+            _hashIndex[x] = _defObject->hash->index[x];
+            if ((_hashIndex[x] < 0) || (_hashIndex[x] >= numResources)) {
+                _hashValid = false;
+            }
+        }
+        for (int x = 0; (x < numResources) && _hashValid; x++) {
+            hashes[x] = hashResource(_defObject->resources[x].name, _defObject->resources[x].instance);
+            _hashValid = (_hashIndex[hashSlot(hashes[x], _hashDisplacement[hashes[x] % numResources],
+                                              numResources)] == x);
+        }
+        if (_hashValid) {
+            return true;
+        }
+        printfLog("M2MObjectHelper: precomputed hash of object \"%s\" doesn't match, working it out.\n",
+                  _defObject->name);
+    }
 
-/**********************************************************************
- * PRIVATE METHODS
- **********************************************************************/
+    // This is "hash and displace": each resource hashes into one of
+    // numResources buckets and each bucket has a displacement chosen
+    // so that its members land in otherwise unused slots.  Buckets
+    // are placed largest first, while there is most room.
+    _hashValid = (numResources > 0);
+    for (int x = 0; x < numResources; x++) {
+        hashes[x] = hashResource(_defObject->resources[x].name, _defObject->resources[x].instance);
+        bucketSize[x] = 0;
+        slotUsed[x] = false;
+        _hashIndex[x] = 0;
+        _hashDisplacement[x] = 0;
+    }
+    for (int x = 0; x < numResources; x++) {
+        bucket = hashes[x] % numResources;
+        bucketSize[bucket]++;
+        if (bucketSize[bucket] > maxBucketSize) {
+            maxBucketSize = bucketSize[bucket];
+        }
+    }
+
+    for (int size = maxBucketSize; (size > 0) && _hashValid; size--) {
+        for (bucket = 0; (bucket < numResources) && _hashValid; bucket++) {
+            if (bucketSize[bucket] == size) {
+                bucketFits = false;
+                for (displacement = 0; (displacement <= UINT16_MAX) && !bucketFits; displacement++) {
+                    bucketFits = true;
+                    numSlots = 0;
+                    for (int x = 0; (x < numResources) && bucketFits; x++) {
+                        if (hashes[x] % numResources == (uint32_t) bucket) {
+                            slot = hashSlot(hashes[x], displacement, numResources);
+                            for (int y = 0; (y < numSlots) && bucketFits; y++) {
+                                bucketFits = (slots[y] != slot);
+                            }
+                            if (slotUsed[slot]) {
+                                bucketFits = false;
+                            }
+                            slots[numSlots] = slot;
+                            numSlots++;
+                        }
+                    }
+                    if (bucketFits) {
+                        _hashDisplacement[bucket] = displacement;
+                        numSlots = 0;
+                        for (int x = 0; x < numResources; x++) {
+                            if (hashes[x] % numResources == (uint32_t) bucket) {
+                                slotUsed[slots[numSlots]] = true;
+                                _hashIndex[slots[numSlots]] = x;
+                                numSlots++;
+                            }
+                        }
+                    }
+                }
+                // This can only happen with a duplicate resource in
+                // the definition or a very unlucky set of names
+                _hashValid = bucketFits;
+            }
+        }
+    }
+
+    if (!_hashValid) {
+        printfLog("M2MObjectHelper: unable to make a perfect hash of the resources in object \"%s\", will search instead.\n",
+                  _defObject->name);
+    }
+
+    return _hashValid;
+}
+#endif
 
 // Set the value of a given resource in an object.
 bool M2MObjectHelper::setResourceValue(const void *value,
                                        M2MResourceBase::ResourceType type,
-                                       const char *resourceNumber,
-                                       int wantedInstance,
-                                       const char *format)
+                                       int index)
 {
     bool success = false;
-    M2MObjectInstance *objectInstance;
-    M2MResource *resource;
-    M2MResourceInstance *resourceInstance = NULL;
-    bool foundIt = false;
-    int64_t valueInt64;
+    const DefResource *defResource = &(_defObject->resources[index]);
+    M2MResourceBase *handle = _resourceStates[index].handle;
+    const char *format;
     char buffer[32];
     int length;
 
-    if (_object != NULL) {
-        objectInstance = _object->object_instance(_defObject->instance);
-        if (objectInstance != NULL) {
-            resource = objectInstance->resource(resourceNumber);
-            if (resource != NULL) {
-
-                printfLog("M2MObjectHelper: setting value of resource \"%s\", instance %d (-1 == single instance), in object \"%s\".\n",
-                          resourceNumber, wantedInstance, _object->name());
-
-                // If this is a multi-instance resource, get the resource instance
-                if (resource->supports_multiple_instances()) {
-                    resourceInstance = resource->resource_instance(wantedInstance);
-                    if (resourceInstance != NULL) {
-                        foundIt = true;
-                    }
-                } else {
-                    foundIt = true;
-                }
-
-                if (foundIt) {
-                    switch (type) {
-                        case M2MResourceBase::STRING:
-                            printfLog("M2MObjectHelper:   STRING resource set to \"%s\".\n", (*((String *) value)).c_str());
-                            if (resourceInstance != NULL) {
-                                success = resourceInstance->set_value((const uint8_t *) (*((const String *) value)).c_str(), (*((const String *) value)).size());
-                            } else {
-                                success = resource->set_value((const uint8_t *) (*((const String *) value)).c_str(), (*((const String *) value)).size());
-                            }
-                            break;
-                        case M2MResourceBase::INTEGER:
-                        case M2MResourceBase::TIME:
-                            valueInt64 = *((int64_t *) value);
-                            printfLog("M2MObjectHelper:   INTEGER or TIME resource set to %lld.\n", valueInt64);
-                            if (resourceInstance != NULL) {
-                                success = resourceInstance->set_value(valueInt64);
-                            } else {
-                                success = resource->set_value(valueInt64);
-                            }
-                            break;
-                        case M2MResourceBase::BOOLEAN:
-                            valueInt64 = *((bool *) value);
-                            printfLog("M2MObjectHelper:   BOOLEAN resource set to %lld.\n", valueInt64);
-                            if (resourceInstance != NULL) {
-                                success = resourceInstance->set_value(valueInt64);
-                            } else {
-                                success = resource->set_value(valueInt64);
-                            }
-                            break;
-                        case M2MResourceBase::FLOAT:
-                            if (format == NULL) {
-                                format = "%f";
-                            }
-                            length = snprintf(buffer, sizeof(buffer), format, *((float *) value));
-                            printfLog("M2MObjectHelper:   FLOAT resource set to %f (\"%*s\", the format string being \"%s\").\n",
-                                      *((float *) value), length, buffer, format);
-                            if (resourceInstance != NULL) {
-                                success = resourceInstance->set_value((uint8_t *) buffer, length);
-                            } else {
-                                success = resource->set_value((uint8_t *) buffer, length);
-                            }
-                            break;
-                        case M2MResourceBase::OBJLINK:
-                        case M2MResourceBase::OPAQUE:
-                            printfLog("M2MObjectHelper:   don't know how to handle resource type %d (OBJLINK or OPAQUE).\n", type);
-                            break;
-                        default:
-                            printfLog("M2MObjectHelper:   unknown resource type %d.\n", type);
-                            break;
+    profileBegin(_defObject->name, _instance);
+    profileBegin("setResourceValue", -1);
+    profileBegin(defResource->name, defResource->instance);
+    if (getConstValue(index) != NULL) {
+        printfLog("M2MObjectHelper: resource \"%s\", instance %d, in object \"%s\" has a constant value.\n",
+                  defResource->name, defResource->instance, _defObject->name);
+    } else if (handle != NULL) {
+        printfLog("M2MObjectHelper: setting value of resource \"%s\", instance %d (-1 == single instance), in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
+
+        switch (type) {
+            case M2MResourceBase::STRING:
+                success = setStringValue((*((const String *) value)).c_str(), (*((const String *) value)).size(), index);
+                break;
+            case M2MResourceBase::INTEGER:
+            case M2MResourceBase::TIME:
+                length = int64ToText(*((int64_t *) value), buffer);
+                printfLog("M2MObjectHelper:   INTEGER or TIME resource set to %s.\n", buffer);
+                success = setTextValue(buffer, length, index);
+                break;
+            case M2MResourceBase::BOOLEAN:
+                buffer[0] = *((bool *) value) ? '1' : '0';
+                buffer[1] = 0;
+                printfLog("M2MObjectHelper:   BOOLEAN resource set to %s.\n", buffer);
+                success = setTextValue(buffer, 1, index);
+                break;
+            case M2MResourceBase::FLOAT:
+                format = defResource->format;
+                if (format != NULL) {
+                    length = snprintf(buffer, sizeof(buffer), format, *((float *) value));
+                    if (length >= (int) sizeof(buffer)) {
+                        length = sizeof(buffer) - 1;
                     }
                 } else {
-                    printfLog("M2MObjectHelper: unable to find resource \"%s\", instance %d, in object \"%s\".\n",
-                              resourceNumber, wantedInstance, _object->name());
+                    // No format so use the fewest digits that
+                    // read back as the same value
+                    length = floatToText(*((float *) value), buffer);
+                    format = "shortest";
                 }
-            } else {
-                printfLog("M2MObjectHelper: unable to find resource \"%s\" of object \"%s\".\n",
-                          resourceNumber, _object->name());
-            }
-        } else {
-            printfLog("M2MObjectHelper: unable to get instance of object \"%s\".\n", _object->name());
+                printfLog("M2MObjectHelper:   FLOAT resource set to %f (\"%.*s\", the format string being \"%s\").\n",
+                          *((float *) value), length, buffer, format);
+                success = setTextValue(buffer, length, index);
+                break;
+            case M2MResourceBase::OBJLINK:
+            case M2MResourceBase::OPAQUE:
+                printfLog("M2MObjectHelper:   don't know how to handle resource type %d (OBJLINK or OPAQUE).\n", type);
+                break;
+            default:
+                printfLog("M2MObjectHelper:   unknown resource type %d.\n", type);
+                break;
         }
     } else {
-        printfLog("M2MObjectHelper: object is NULL.\n");
+        printfLog("M2MObjectHelper: unable to find resource \"%s\", instance %d, in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
     }
+    profileEnd();
+    profileEnd();
+    profileEnd();
 
     return success;
 }
@@ -604,98 +2839,76 @@ bool M2MObjectHelper::setResourceValue(const void *value,
 // Get the value of a given resource in an object.
 bool M2MObjectHelper::getResourceValue(void *value,
                                        M2MResourceBase::ResourceType type,
-                                       const char *resourceNumber,
-                                       int wantedInstance)
+                                       int index)
 {
     bool success = false;
-    M2MObjectInstance *objectInstance;
-    M2MResource *resource;
-    M2MResourceInstance *resourceInstance = NULL;
-    bool foundIt = false;
+    const DefResource *defResource = &(_defObject->resources[index]);
+    M2MResourceBase *handle = _resourceStates[index].handle;
+    const char *text;
+    unsigned int length;
     int64_t localValue;
-    String str;
+    char buffer[32];
 
-    if (_object != NULL) {
-        objectInstance = _object->object_instance(_defObject->instance);
-        if (objectInstance != NULL) {
-            resource = objectInstance->resource(resourceNumber);
-            if (resource != NULL) {
-                printfLog("M2MObjectHelper: getting value of resource \"%s\", instance %d (-1 == single instance), from object \"%s\".\n",
-                          resourceNumber, wantedInstance, _object->name());
-
-                // If this is a multi-instance resource, get the resource instance
-                if (resource->supports_multiple_instances()) {
-                    resourceInstance = resource->resource_instance(wantedInstance);
-                    if (resourceInstance != NULL) {
-                        foundIt = true;
-                    }
-                } else {
-                    foundIt = true;
-                }
+    if (handle != NULL) {
+        printfLog("M2MObjectHelper: getting value of resource \"%s\", instance %d (-1 == single instance), from object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
 
-                if (foundIt) {
-                    switch (type) {
-                        case M2MResourceBase::STRING:
-                            if (resourceInstance != NULL) {
-                                *(String *) value = resourceInstance->get_value_string();
-                            } else {
-                                *(String *) value = resource->get_value_string();
-                            }
-                            printfLog("M2MObjectHelper:   STRING resource value is \"%s\".\n", (*((String *) value)).c_str());
-                            success = true;
-                            break;
-                        case M2MResourceBase::INTEGER:
-                        case M2MResourceBase::TIME:
-                            if (resourceInstance != NULL) {
-                                localValue = resourceInstance->get_value_int();
-                            } else {
-                                localValue = resource->get_value_int();
-                            }
-                            *((int64_t *) value) = localValue;
-                            printfLog("M2MObjectHelper:   INTEGER or TIME resource value is %lld.\n", *((int64_t *) value));
-                            success = true;
-                            break;
-                        case M2MResourceBase::BOOLEAN:
-                            if (resourceInstance != NULL) {
-                                localValue = resourceInstance->get_value_int();
-                            } else {
-                                localValue = resource->get_value_int();
-                            }
-                            *(bool *) value = ((bool) localValue != false);
-                            printfLog("M2MObjectHelper:   BOOLEAN resource value is %d.\n", *((bool *) value));
-                            success = true;
-                            break;
-                        case M2MResourceBase::FLOAT:
-                            if (resourceInstance != NULL) {
-                                str = resourceInstance->get_value_string();
-                            } else {
-                                str = resource->get_value_string();
-                            }
-                            sscanf(str.c_str(), "%f", (float *) value);
-                            printfLog("M2MObjectHelper:   FLOAT resource value is %f (\"%s\").\n", *((float *) value), str.c_str());
-                            success = true;
-                            break;
-                        case M2MResourceBase::OBJLINK:
-                        case M2MResourceBase::OPAQUE:
-                            printfLog("M2MObjectHelper:   don't know how to handle resource type %d (OBJLINK or OPAQUE).\n", type);
-                            break;
-                        default:
-                            printfLog("M2MObjectHelper:   unknown resource type %d.\n", type);
-                            break;
-                    }
+        // A constant value is never given to Mbed Client
+        text = getConstValue(index);
+        if (text != NULL) {
+            length = strlen(text);
+        } else {
+            text = (const char *) handle->value();
+            length = handle->value_length();
+        }
+
+        switch (type) {
+            case M2MResourceBase::STRING:
+                if (getStringValue(index) != NULL) {
+                    *(String *) value = getStringValue(index);
                 } else {
-                    printfLog("M2MObjectHelper: unable to find resource \"%s\", instance %d, in object \"%s\".\n",
-                              resourceNumber, wantedInstance, _object->name());
+                    *(String *) value = handle->get_value_string();
                 }
-            } else {
-                printfLog("M2MObjectHelper: unable to find resource \"%s\" of object \"%s\".\n",
-                          resourceNumber, _object->name());
-            }
-        } else {
-            printfLog("M2MObjectHelper: unable to get instance of object \"%s\".\n", _object->name());
+                printfLog("M2MObjectHelper:   STRING resource value is \"%s\".\n", (*((String *) value)).c_str());
+                success = true;
+                break;
+            case M2MResourceBase::INTEGER:
+            case M2MResourceBase::TIME:
+                localValue = 0;
+                textToInt64(text, length, &localValue);
+                *((int64_t *) value) = localValue;
+                printfLog("M2MObjectHelper:   INTEGER or TIME resource value is %.*s.\n",
+                          (int) length, text);
+                success = true;
+                break;
+            case M2MResourceBase::BOOLEAN:
+                localValue = 0;
+                textToInt64(text, length, &localValue);
+                *(bool *) value = (localValue != 0);
+                printfLog("M2MObjectHelper:   BOOLEAN resource value is %d.\n", *((bool *) value));
+                success = true;
+                break;
+            case M2MResourceBase::FLOAT:
+                if (length >= sizeof(buffer)) {
+                    length = sizeof(buffer) - 1;
+                }
+                memcpy(buffer, text, length);
+                buffer[length] = 0;
+                sscanf(buffer, "%f", (float *) value);
+                printfLog("M2MObjectHelper:   FLOAT resource value is %f (\"%s\").\n", *((float *) value), buffer);
+                success = true;
+                break;
+            case M2MResourceBase::OBJLINK:
+            case M2MResourceBase::OPAQUE:
+                printfLog("M2MObjectHelper:   don't know how to handle resource type %d (OBJLINK or OPAQUE).\n", type);
+                break;
+            default:
+                printfLog("M2MObjectHelper:   unknown resource type %d.\n", type);
+                break;
         }
     } else {
-        printfLog("M2MObjectHelper: object is NULL.\n");
+        printfLog("M2MObjectHelper: unable to find resource \"%s\", instance %d, in object \"%s\".\n",
+                  defResource->name, defResource->instance, _defObject->name);
     }
 
     return success;
@@ -17,6 +17,8 @@
 #ifndef _M2M_OBJECT_HELPER_
 #define _M2M_OBJECT_HELPER_
 
+#include "m2m_object_helper_timer.h"
+
 /** This class helps with constructing LWM2M objects for use with mbed
  * client or mbed cloud client.
  *
@@ -143,6 +145,44 @@
  *     }
  * }
  *
+ * The value updated callback is only given the resource number, so if
+ * a resource has several instances you would have to read all of them
+ * back to find out which one was written.  To avoid this, call
+ * setResourceWrittenCallback() instead; that callback is given the
+ * resource number, the resource instance and the value written, e.g.:
+ *
+ * void MyObject::resourceWritten(const char *resourceName, int instance,
+ *                                const ResourceValue *value)
+ * {
+ *     if (_setCallback) {
+ *         _setCallback(instance, value->valueInt64 != 0);
+ *     }
+ * }
+ *
+ * A large value written to an OPAQUE resource, e.g. a firmware image,
+ * should not be assembled in RAM.  Build with OPAQUE_WRITE_STREAMING
+ * set to 1 and call setOpaqueWriteCallback(): each block will be passed
+ * to your callback as it arrives, along with its offset in the whole
+ * value, so that it can go straight to flash or to a file; a value
+ * small enough to arrive in a single message is passed to your
+ * callback as one block, the last, at offset 0.  The server cannot be
+ * told that a block was not accepted (Mbed Client has already responded
+ * by then) so, if your callback returns false, it is up to you to
+ * remember that the value is incomplete.  The helper keeps track of how
+ * far it has got: if the server sends the same value again, blocks
+ * already dealt with are skipped, and after a restart you can tell the
+ * helper what you already have with setOpaqueWriteProgress().
+ *
+ * If the values written by the server need to be kept, give the object
+ * a journal with setJournal(), see m2m_object_helper_journal.h.
+ *
+ * Where objects are created and deleted over and over, e.g. as sensors
+ * come and go, give each object the pool for its definition with
+ * setPool(), see m2m_object_helper_pool.h, so that its storage is
+ * recycled rather than returned to the heap; to recycle the object
+ * itself too, create it with M2MObjectPool::make() and delete it with
+ * M2MObjectPool::destroy().
+ *
  * For complete examples of the implementation of several different types of
  * LWM2M objects, take a look at the files ioc_m2m.h and ioc_m2m.cpp in
  * this repo:
@@ -206,6 +246,67 @@
  *     }
  * }
  *
+ * Setting a resource to the value it already has costs a compare and
+ * nothing more.  Each real change bumps the version of the object,
+ * getVersion(), so that something reading values over and over (an
+ * exporter, a UI) can skip an object whose version it has already seen
+ * with one integer compare, or read a resource with getIfChanged(),
+ * which only gets the value if it is newer than the version passed in.
+ * Build with RESOURCE_VERSIONS set to 1 and each resource is stamped
+ * with the version of its last change, getResourceVersion(), so that
+ * getIfChanged() skips values that have not changed even though others
+ * in the object have; otherwise every resource has the version of its
+ * object.  To hear of changes across all objects, rather than look,
+ * see setChangeRing() and m2m_object_helper_changes.h.
+ *
+ * ACKNOWLEDGED VALUES
+ *
+ * Built with ACKNOWLEDGED_VALUES set to 1, the helper asks Mbed Client
+ * to say when a notification of an observable resource has been sent
+ * and when the server has confirmed receiving it (for confirmable
+ * notifications), and so knows the version of each value the server
+ * has; a value written by the server is, of course, one it has.  The
+ * version is that of the value when it was given to Mbed Client, so a
+ * value set while an earlier one is on its way is not mistaken for it.
+ * After a reconnect, instead of setting every value again to get it
+ * republished, call republish() on each object: only resources under
+ * observation whose value has changed since the server last confirmed
+ * one are republished, and the statistics say how many bytes of value
+ * that saved.  Resources not under observation would not be published
+ * anyway and count for neither.  A value that changed and changed back
+ * counts as changed, as, unless RESOURCE_VERSIONS is 1, does one that
+ * has not changed while others in its object have.  If Mbed Client is
+ * set up to send notifications non-confirmable, the server never
+ * confirms a value: call setNotificationsConfirmable(false) and
+ * republish() does nothing.  Without ACKNOWLEDGED_VALUES nothing is
+ * known of what the server has, and republish() republishes every
+ * resource under observation.
+ *
+ * STALE VALUES
+ *
+ * A resource fed from a sensor or a field bus should be set every so
+ * often; build with STALE_VALUES set to 1, give the resource a
+ * maxUpdateIntervalMs in its DefResourceOptions and call
+ * setTimerWheel() with a wheel that your application ticks (see
+ * m2m_object_helper_timer.h), and the helper will tell you, through
+ * the callback set with setStaleCallback() and through isStale(), when
+ * it has not been set for that long.  Setting the value, even to the
+ * value it already has, only records the time on the wheel: nothing
+ * is scanned and the timer of the resource is not touched.  Only when
+ * that timer expires is the time looked at and, if the value was set
+ * in the meantime, the timer started again for the rest of the
+ * interval, so a resource that is kept up to date costs one timer
+ * expiry per interval and only a resource that really goes stale is
+ * reported.  Setting a stale value makes it fresh again and calls the
+ * callback to say so.  Values written by the server don't count.
+ * Because setting a stale value starts its timer again, and the wheel
+ * is not thread-safe, set the values of watched resources from the
+ * context that calls tick(), e.g. the same EventQueue.
+ * The wheel is hierarchical, so starting and stopping a timer costs
+ * the same however many are running and however far away they are
+ * due; use the same wheel, getTimerWheel(), for any other deadlines
+ * your objects keep.
+ *
  * CREATING OBJECTS WITH EXECUTABLE RESOURCES
  *
  * If your object includes an executable resource, you will need to do
@@ -287,12 +388,111 @@
  *                                                   getTemperatureDataIndoor,
  *                                                   objectOutdoor);
  *
+ * Where many instances of the same objects are needed, e.g. a device's
+ * worth of objects each time a device joins a gateway, make one set as
+ * normal to act as prototypes and make each further set by passing the
+ * prototype and the new instance ID to makeObject().  The set-up which
+ * the helper would otherwise work out from the DefObject is copied from
+ * the prototype and the object is added as a new instance of the
+ * prototype's M2MObject, so only the Mbed Client resources have to be
+ * created.  getStringStorageSize() tells you how much STRING storage
+ * each clone needs, so that a whole set can share one allocation.
+ *
+ * RESOURCE OPTIONS
+ *
+ * Settings which most resources don't need are kept out of DefResource,
+ * so that existing object definitions don't have to change.  Instead,
+ * the last field of DefObject, resourceOptions, may point to an array
+ * of DefResourceOptions, one per resource, in the same order as the
+ * resources.  If resourceOptions is left out it is NULL and every
+ * resource gets the defaults.
+ *
+ * The helper keeps its own copy of the value of each STRING resource so
+ * that setting an unchanged value costs nothing and reading a value
+ * doesn't go to the heap.  Values of up to STRING_INLINE_LENGTH
+ * characters are held in storage allocated once by makeObject(); if a
+ * resource usually holds something longer, set stringInlineLength for
+ * it, otherwise heap storage is allocated the first time a longer value
+ * is set.  Mbed Client asks the helper for the value of a STRING
+ * resource that is not observable, so setting one causes no heap
+ * traffic at all; the value of an observable one is also given to Mbed
+ * Client, which needs its own copy to build notifications from.
+ *
+ * If a STRING resource can only ever take one of a fixed set of values,
+ * point enumValues at those values and set numEnumValues: the helper
+ * then keeps just the index of the current value, which can be set and
+ * got directly with setResourceEnumIndex() and getResourceEnumIndex().
+ * Setting text which is not one of the values fails.
+ *
+ * A resource whose value never changes (a manufacturer, a model number,
+ * etc.) can be given that value, as text, in constValue.  Mbed Client
+ * then asks the helper for the value when the server reads it and the
+ * helper serves it from where it is, e.g. flash: there is no need to
+ * call setResourceValue() for it and no copy is made on the heap.
+ * getResourceValue() works as normal; setResourceValue() fails.
+ *
+ * Similarly, the value of an OPAQUE resource can be the contents of a
+ * file (a log, a captured trace, etc.): set filePath and the file is
+ * read only when the server reads the resource, so no copy of it is
+ * kept in Mbed Client between reads.  Mbed Client asks for the whole
+ * value at once, into a buffer of its own the size of the file, and
+ * does any block-wise transfer from there; the file is read into that
+ * buffer with pread() (FILE_VALUE_PREAD, the default on Linux) or
+ * stdio.  Nothing is held open or mapped between reads, so the file
+ * may be appended-to, replaced or truncated (e.g. by logrotate) at any
+ * time: if it shrinks while being read the value is just shorter.
+ *
+ * MAKING OBJECTS A SLICE AT A TIME
+ *
+ * Creating all of the resources of all of the objects in one go at
+ * boot can take long enough, on a slow MCU, to trip a watchdog or hold
+ * up something time-critical.  Instead, an object's constructor may
+ * call beginMakeObject() in place of makeObject(), which creates just
+ * the object; the resources are then created by calls to
+ * makeObjectSlice(), each of which is limited to a number of resources
+ * and/or a number of microseconds, from the application's main loop.
+ * When the last resource has been created objectMade() is called,
+ * where initial values should be set.  M2MObjectBuilder, see
+ * m2m_object_helper_builder.h, does this across a whole set of objects
+ * and says when they are all ready to be registered.
+ *
+ * So that a device can register quickly with the objects it must have
+ * (Security, Server, Device, alarms, etc.), give those objects
+ * STARTUP_PRIORITY_CRITICAL with setStartupPriority(): M2MObjectBuilder
+ * makes objects in order of priority and hands out the critical ones
+ * for the first registration as soon as they are complete, the rest
+ * following in registration updates.  Each object also works out, once,
+ * its CoRE link-format fragment for registration, e.g. "</3303/0>",
+ * which M2MLinkPayload (see m2m_object_helper_links.h) splices into or
+ * out of a registration payload as objects come and go; give each
+ * object the payload with setLinkPayload() and it keeps itself there.
+ *
+ * To find out where the time and heap go while objects are made, build
+ * with STARTUP_PROFILE set to 1 and use setStartupProfile(), see
+ * m2m_object_helper_profile.h.
+ *
+ * LOADING DEFINITIONS AT RUN TIME
+ *
+ * Object definitions can also be loaded from a binary file made by
+ * tools/m2m_def_blob.py, see m2m_object_helper_blob.h.  Such a
+ * definition carries a precomputed hash of its resources in the hash
+ * field of DefObject, which saves makeObject() working it out; if the
+ * hash doesn't work for the resources it is ignored.  A set of objects
+ * can be saved, with their values, to a snapshot of the same form and
+ * made again from it on restart, see m2m_object_helper_snapshot.h.
+ *
  * CLEARING UP
  *
  * When clearing objects up, always delete them BEFORE mbed client/cloud client
  * itself is deleted (since their destructors do things inside mbed client/cloud
  * client).
  */
+class M2MObjectJournal;
+class M2MObjectPool;
+class M2MStartupProfile;
+class M2MChangeRing;
+class M2MLinkPayload;
+
 class M2MObjectHelper {
 public:
 
@@ -312,12 +512,214 @@ public:
      */
     virtual void updateObservableResources();
 
+    /** The start-up priority of objects which must be
+     * in the first registration, e.g. Device; lower
+     * values are also critical.
+     */
+#   define STARTUP_PRIORITY_CRITICAL 0
+
+    /** The start-up priority of all other objects
+     * unless set otherwise.
+     */
+#   define STARTUP_PRIORITY_NORMAL 100
+
     /** Return this object.
      *
      * @return pointer to this object.
      */
     M2MObject *getObject();
 
+    /** Set a profile in which to record where the time
+     * and heap go as objects are made and their values
+     * set, for all objects; only has an effect if
+     * STARTUP_PROFILE is 1.  See
+     * m2m_object_helper_profile.h.
+     *
+     * @param profile  the profile, NULL to stop recording.
+     */
+    static void setStartupProfile(M2MStartupProfile *profile);
+
+    /** Set a ring in which to record each change to the
+     * value of a resource, for all objects.  See
+     * m2m_object_helper_changes.h.
+     *
+     * @param ring  the ring, NULL to stop recording.
+     */
+    static void setChangeRing(M2MChangeRing *ring);
+
+    /** Set the timer wheel with which to spot resources
+     * that have gone stale, for all objects made from
+     * then on; each object keeps to the wheel it was made
+     * with, which must outlive it, so the wheel may be
+     * changed or set to NULL while objects exist.  Values
+     * of watched resources must be set from the context
+     * that calls M2MTimerWheel::tick().  See STALE VALUES.
+     *
+     * @param wheel  the timer wheel, NULL for none.
+     */
+    static void setTimerWheel(M2MTimerWheel *wheel);
+
+    /** Get the timer wheel set with setTimerWheel(), so
+     * that other per-resource deadlines (rate limits,
+     * heartbeats, debounce windows etc.) can share it
+     * rather than each having a timer of their own.
+     *
+     * @return  the timer wheel, NULL if there is none.
+     */
+    static M2MTimerWheel *getTimerWheel();
+
+    /** Get the number of bytes of storage needed for
+     * the values of the STRING resources of this
+     * object, see makeObject().
+     *
+     * @return the number of bytes, valid once
+     *         makeObject() has been called.
+     */
+    int getStringStorageSize() const;
+
+    /** Create the next few resources of an object whose
+     * making was begun with beginMakeObject(), see
+     * MAKING OBJECTS A SLICE AT A TIME.  At least one
+     * resource is created on each call, if any remain.
+     *
+     * @param maxResources     the most resources to create,
+     *                         0 for no limit.
+     * @param maxMicroseconds  the time after which to stop
+     *                         creating resources, 0 for no
+     *                         limit.
+     * @return                 the number of resources still
+     *                         to be created, 0 when the object
+     *                         is complete, -1 if there is no
+     *                         object being made.
+     */
+    int makeObjectSlice(int maxResources, uint32_t maxMicroseconds = 0);
+
+    /** Set the start-up priority of this object, which
+     * says how soon M2MObjectBuilder makes it and hands
+     * it out for registration; see MAKING OBJECTS A
+     * SLICE AT A TIME.
+     *
+     * @param priority  the priority, lower values first,
+     *                  STARTUP_PRIORITY_CRITICAL or lower
+     *                  for an object that must be in the
+     *                  first registration.
+     */
+    void setStartupPriority(int priority);
+
+    /** Get the start-up priority of this object.
+     *
+     * @return the priority, STARTUP_PRIORITY_NORMAL
+     *         unless set otherwise.
+     */
+    int getStartupPriority() const;
+
+    /** Get the number of resources in this object.
+     *
+     * @return the number of resources.
+     */
+    int getNumResources() const;
+
+    /** Get the number of resources of this object that
+     * have been created so far.
+     *
+     * @param numFailed  pointer to a place to put the
+     *                   number of those that could not
+     *                   be created, may be NULL.
+     * @return           the number of resources created
+     *                   (or attempted).
+     */
+    int getNumResourcesMade(int *numFailed = NULL) const;
+
+    /** Get the CoRE link-format fragment which stands
+     * for this object instance in a registration
+     * payload, e.g. "</3303/0>", worked out once when
+     * the object is made; see M2MLinkPayload in
+     * m2m_object_helper_links.h.
+     *
+     * @param length  pointer to a place to put the
+     *                number of bytes in the fragment,
+     *                may be NULL.
+     * @return        the NULL terminated fragment,
+     *                NULL if the object has not
+     *                been made.
+     */
+    const char *getLinkFragment(int *length = NULL) const;
+
+    /** Get the version of the values of this object,
+     * which goes up each time the value of any of its
+     * resources changes; if it is the same as when
+     * you last looked, nothing has changed.
+     *
+     * @return the version, 0 until the object has
+     *         been made.
+     */
+    uint32_t getVersion() const;
+
+    /** Get the version of the value of a resource,
+     * which is the version of the object when the
+     * value last changed or, unless RESOURCE_VERSIONS
+     * is 1, simply the version of the object.
+     *
+     * @param resourceNumber   the number of the resource.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 the version, 0 if there is no
+     *                         such resource.
+     */
+    uint32_t getResourceVersion(const char *resourceNumber,
+                                int wantedInstance = -1);
+
+    /** Structure to report what republish() did; it is
+     * added to, so that one structure can be passed to
+     * each object in turn.
+     */
+    typedef struct {
+        int numRepublished;        ///< resources republished.
+        int numSkipped;            ///< resources the server already has.
+        uint32_t bytesRepublished; ///< bytes of value republished.
+        uint32_t bytesSaved;       ///< bytes of value the server already
+                                   /// has, so not republished.
+    } RepublishStats;
+
+    /** Republish, e.g. after a reconnect, the observable
+     * resources of this object, under observation by the
+     * server, whose values the server has not confirmed
+     * receiving, see ACKNOWLEDGED VALUES; unless
+     * ACKNOWLEDGED_VALUES is 1, all of them.
+     *
+     * @param stats  pointer to statistics to add to, may
+     *               be NULL.
+     * @return       the number of resources republished.
+     */
+    int republish(RepublishStats *stats = NULL);
+
+    /** Tell the helper whether Mbed Client sends the
+     * notifications of this object confirmable, which it
+     * does unless set up otherwise.  If not, the server
+     * never confirms receiving a value and republish()
+     * leaves this object alone; unless ACKNOWLEDGED_VALUES
+     * is 1 this has no effect.
+     *
+     * @param confirmable  true if notifications are sent
+     *                     confirmable, otherwise false.
+     */
+    void setNotificationsConfirmable(bool confirmable);
+
+    /** Find out whether a resource has gone stale, i.e.
+     * has not been set for longer than the
+     * maxUpdateIntervalMs of its DefResourceOptions;
+     * always false unless STALE_VALUES is 1.
+     *
+     * @param resourceNumber   the number of the resource.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 true if it is stale, false if
+     *                         not or if there is no such
+     *                         resource.
+     */
+    bool isStale(const char *resourceNumber,
+                 int wantedInstance = -1);
+
 protected:
 
     /** The maximum length of an object
@@ -335,12 +737,108 @@ protected:
 #   endif
 
     /** The maximum number of resources
-     * an object can have.
+     * an object can have.  Each object keeps its
+     * resource states, and the tables of its perfect
+     * hash if there are any (see
+     * RESOURCE_HASH_MIN_RESOURCES), for this many
+     * resources, so raise it only as far as your
+     * definitions need.
      */
 #   ifndef MAX_NUM_RESOURCES
 #   define MAX_NUM_RESOURCES 8
 #   endif
 
+    /** The fewest resources an object must have for
+     * them to be found through a perfect hash (see
+     * makeHash()) rather than by searching the
+     * definition; below this the search costs no more
+     * than the hash.  Unless MAX_NUM_RESOURCES is at
+     * least this, the tables of the hash and the code
+     * that makes them are left out altogether.
+     */
+#   ifndef RESOURCE_HASH_MIN_RESOURCES
+#   define RESOURCE_HASH_MIN_RESOURCES 16
+#   endif
+#   define RESOURCE_HASH (MAX_NUM_RESOURCES >= RESOURCE_HASH_MIN_RESOURCES)
+
+    /** Set to 1 to read the value of a file-backed
+     * OPAQUE resource (see DefResourceOptions) with
+     * pread(), 0 to read it with stdio; by default 1
+     * on Linux.
+     */
+#   ifndef FILE_VALUE_PREAD
+#   ifdef __linux__
+#   define FILE_VALUE_PREAD 1
+#   else
+#   define FILE_VALUE_PREAD 0
+#   endif
+#   endif
+
+    /** Set to 1 to build in the recording of a
+     * start-up profile, see setStartupProfile().
+     */
+#   ifndef STARTUP_PROFILE
+#   define STARTUP_PROFILE 0
+#   endif
+
+    /** Set to 1 to build in the passing of values
+     * written to OPAQUE resources to a callback block
+     * by block, see setOpaqueWriteCallback(); this
+     * adds 16 bytes per resource, and the callback, to
+     * each object.
+     */
+#   ifndef OPAQUE_WRITE_STREAMING
+#   define OPAQUE_WRITE_STREAMING 0
+#   endif
+
+    /** Set to 1 to keep track of the values the server
+     * has confirmed receiving, so that republish()
+     * republishes only the others, see ACKNOWLEDGED
+     * VALUES; this adds 12 bytes per resource to each
+     * object, and RESOURCE_VERSIONS defaults to 1.
+     */
+#   ifndef ACKNOWLEDGED_VALUES
+#   define ACKNOWLEDGED_VALUES 0
+#   endif
+
+    /** Set to 1 to keep the version of the value of
+     * each resource, see getResourceVersion(), as
+     * well as that of the object; this adds 4 bytes
+     * per resource to each object, 8 once padded on
+     * x86-64.  Otherwise the
+     * version of a resource is that of its object, so
+     * getIfChanged() gets a value whenever any value
+     * of the object has changed.  By default 1 if
+     * ACKNOWLEDGED_VALUES is, otherwise 0.
+     */
+#   ifndef RESOURCE_VERSIONS
+#   define RESOURCE_VERSIONS ACKNOWLEDGED_VALUES
+#   endif
+
+    /** Set to 1 to build in the spotting of resources
+     * that have not been set within their
+     * maxUpdateIntervalMs, see STALE VALUES; this adds
+     * a timer wheel timer and 5 bytes per resource to
+     * each object, 48 bytes per resource on x86-64.
+     */
+#   ifndef STALE_VALUES
+#   define STALE_VALUES 0
+#   endif
+
+    /** The number of characters of the value of
+     * a STRING resource that the helper keeps
+     * without using the heap, unless overridden
+     * for that resource in DefResourceOptions.
+     */
+#   ifndef STRING_INLINE_LENGTH
+#   define STRING_INLINE_LENGTH 16
+#   endif
+
+    /** The enumeration index that means "no value",
+     * see DefResourceOptions.
+     */
+#   define ENUM_INDEX_NONE 0xFF
+
     /** Structure to represent a resource.
      */
     typedef struct {
@@ -352,18 +850,136 @@ protected:
         bool observable; ///< true if the object is observable, otherwise false.
         M2MBase::Operation operation;
         const char * format; ///< format string, can be user to present
-                             /// a nicely formatted value if type is FLOAT.
+                             /// a nicely formatted value if type is FLOAT;
+                             /// if NULL the shortest string that reads
+                             /// back as the same float is used, e.g.
+                             /// "21.5" rather than "21.500000".
     } DefResource;
 
+    /** Structure to hold optional settings for a
+     * resource, see the resourceOptions field of
+     * DefObject.
+     */
+    typedef struct {
+        int stringInlineLength; ///< for a STRING resource, the number of
+                                /// characters of value held without using
+                                /// the heap; 0 for STRING_INLINE_LENGTH.
+        const char * const *enumValues; ///< for a STRING resource which can
+                                        /// only take one of a fixed set of
+                                        /// values, the values, else NULL.
+        int numEnumValues;      ///< the number of entries in enumValues,
+                                /// at most ENUM_INDEX_NONE.
+        const char *constValue; ///< for a resource whose value never
+                                /// changes, the value as text (e.g. "1.0"),
+                                /// which is served from where it is rather
+                                /// than copied into Mbed Client; else NULL.
+        const char *filePath;   ///< for an OPAQUE resource, the path of a
+                                /// file whose contents are the value of the
+                                /// resource, else NULL.
+        uint32_t maxUpdateIntervalMs; ///< the longest the value should go
+                                      /// without being set before it is
+                                      /// considered stale, 0 for no limit;
+                                      /// see setTimerWheel().  Ignored
+                                      /// unless STALE_VALUES is 1.
+    } DefResourceOptions;
+
+    /** Structure to hold a precomputed perfect hash of
+     * the resources of an object, see the hash field of
+     * DefObject.  Normally this is only produced by the
+     * definition blob converter, tools/m2m_def_blob.py.
+     */
+    typedef struct {
+        uint16_t displacement[MAX_NUM_RESOURCES]; ///< for each bucket.
+        int16_t index[MAX_NUM_RESOURCES];         ///< for each slot.
+    } DefObjectHash;
+
     /** Structure to represent an object.
+     *
+     * resourceOptions may be left out of the initialiser
+     * (and hence be NULL), in which case all resources
+     * get the default options.  Otherwise it should point
+     * to an array of numResources DefResourceOptions, in
+     * the same order as resources[], e.g.:
+     *
+     * const M2MObjectHelper::DefResourceOptions MyObject::_options[] =
+     *     {{0}, {4}};
+     * const M2MObjectHelper::DefObject MyObject::_defObject =
+     *     {0, "3312", 2,
+     *         {{-1, "5850", "on/off", M2MResourceBase::BOOLEAN, false, M2MBase::GET_ALLOWED, NULL},
+     *          {-1, "5750", "name", M2MResourceBase::STRING, false, M2MBase::GET_ALLOWED, NULL}},
+     *      _options
+     *     };
      */
     typedef struct {
         int instance;
         char name[MAX_OBJECT_RESOURCE_NAME_LENGTH];
         int numResources;
         DefResource resources[MAX_NUM_RESOURCES];
+        const DefResourceOptions *resourceOptions; ///< may be NULL.
+        const DefObjectHash *hash; ///< may be NULL, in which case
+                                   /// makeObject() works the hash out;
+                                   /// unused for objects of fewer than
+                                   /// RESOURCE_HASH_MIN_RESOURCES resources.
     } DefObject;
 
+    /** Structure to carry the value of a resource
+     * that has been written by the server.
+     */
+    typedef struct {
+        M2MResourceBase::ResourceType type;
+        int64_t valueInt64;      ///< the value if type is INTEGER, TIME
+                                 /// or BOOLEAN.
+        float valueFloat;        ///< the value if type is FLOAT.
+        const char *valueString; ///< the value if type is STRING or OPAQUE;
+                                 /// NOT NULL terminated and only valid for
+                                 /// the duration of the callback.
+        unsigned int valueLength; ///< the length of valueString.
+    } ResourceValue;
+
+    /** Callback for when a resource has been written by
+     * the server, receiving the resource number, the
+     * resource instance (-1 if there is only a single
+     * instance) and the value that was written.
+     */
+    typedef Callback<void(const char *, int, const ResourceValue *)> ResourceWrittenCallback;
+
+#if OPAQUE_WRITE_STREAMING
+    /** Structure to carry one block of a value written
+     * by the server to an OPAQUE resource.
+     */
+    typedef struct {
+        const uint8_t *data;     ///< the data, only valid for the duration
+                                 /// of the callback.
+        uint32_t length;         ///< the number of bytes at data.
+        uint32_t offset;         ///< the offset of data from the start of
+                                 /// the value.
+        uint32_t totalLength;    ///< the length of the whole value, 0 if
+                                 /// the server has not said.
+        bool last;               ///< true if this is the end of the value.
+    } OpaqueBlock;
+
+    /** Callback for each block of a value written by the
+     * server to an OPAQUE resource, receiving the resource
+     * number, the resource instance (-1 if there is only a
+     * single instance) and the block; it should return true
+     * if the block has been dealt with, false to have it
+     * offered again should the server resend it.  Note that
+     * returning false does not fail the write as far as the
+     * server is concerned: Mbed Client gives no way to refuse
+     * a block, so the server will have been told that all is
+     * well and the callback must keep track of the failure
+     * itself.
+     */
+    typedef Callback<bool(const char *, int, const OpaqueBlock *)> OpaqueWriteCallback;
+#endif
+
+    /** Callback for when a resource goes stale or, being
+     * set again, stops being stale, receiving the resource
+     * number, the resource instance (-1 if there is only
+     * a single instance) and true if it is now stale.
+     */
+    typedef Callback<void(const char *, int, bool)> StaleCallback;
+
     /** Constructor.
      *
      * @param defObject              the definition of the LWM2M object.
@@ -374,7 +990,9 @@ protected:
      *                               number, the M2MClient code doesn't seem
      *                               to do that) as a string so that
      *                               finer-grained action can be performed
-     *                               if required.
+     *                               if required.  If you need the instance
+     *                               number, use setResourceWrittenCallback()
+     *                               instead.
      * @param object                 if this is the second (or more) instance
      *                               of the same object type then a pointer to
      *                               the first object of this type that was
@@ -396,6 +1014,171 @@ protected:
      */
     bool makeObject();
 
+    /** Create an object as makeObject() does but as a
+     * clone of a prototype: an object already made from
+     * the same defObject.  The set-up that makeObject()
+     * does inside the helper is copied from the prototype
+     * rather than worked out again and the object becomes
+     * a new instance of the prototype's LWM2M object; only
+     * the Mbed Client resources have to be created.  This
+     * makes it quick to create many instances of the same
+     * objects, e.g. a device's worth of objects each time
+     * a device is added to a gateway.
+     *
+     * @param prototype      an object made from the same
+     *                       defObject.
+     * @param instance       the object instance to create,
+     *                       which must not already exist.
+     * @param stringStorage  storage for the values of STRING
+     *                       resources, at least
+     *                       prototype->getStringStorageSize()
+     *                       bytes, which must remain until
+     *                       this object is deleted, or NULL
+     *                       for the helper to allocate it; use
+     *                       this to make a single allocation
+     *                       for a whole set of objects.
+     * @return               true if successful, otherwise
+     *                       false.
+     */
+    bool makeObject(const M2MObjectHelper *prototype,
+                    int instance,
+                    char *stringStorage = NULL);
+
+    /** Begin making an object as makeObject() does but
+     * without creating any of its resources; these are
+     * then created, a few at a time, by calls to
+     * makeObjectSlice().  Values cannot be set until the
+     * resource in question has been created, so set
+     * initial values in objectMade().
+     *
+     * @return  true if successful, otherwise false.
+     */
+    bool beginMakeObject();
+
+    /** Called when the last resource of an object begun
+     * with beginMakeObject() has been created.  Derived
+     * classes may implement this to set initial values.
+     */
+    virtual void objectMade();
+
+    /** Set a callback to be called when the server has
+     * written to any resource in this object.  Unlike
+     * the valueUpdatedCallback passed to the constructor,
+     * this callback is given the resource instance and
+     * the value that was written, so there is no need to
+     * read back every instance of a multi-instance resource
+     * to find out what has changed.  May be called before
+     * or after makeObject().
+     *
+     * @param callback the callback, NULL to remove it.
+     */
+    void setResourceWrittenCallback(ResourceWrittenCallback callback);
+
+#if OPAQUE_WRITE_STREAMING
+    /** Set a callback to be given, block by block, the
+     * values written by the server to the writable OPAQUE
+     * resources in this object (a firmware image, a
+     * certificate bundle, etc.), which are then passed
+     * straight through from Mbed Client rather than
+     * being assembled in RAM.  May be called before or
+     * after makeObject().  Only present if
+     * OPAQUE_WRITE_STREAMING is 1.
+     *
+     * @param callback the callback, NULL to remove it.
+     */
+    void setOpaqueWriteCallback(OpaqueWriteCallback callback);
+#endif
+
+    /** Set a callback to be called when a resource in
+     * this object goes stale and when it is set again,
+     * see STALE VALUES.  Called from M2MTimerWheel::tick()
+     * and from setResourceValue(); never called unless
+     * STALE_VALUES is 1.
+     *
+     * @param callback the callback, NULL to remove it.
+     */
+    void setStaleCallback(StaleCallback callback);
+
+    /** Set a journal to which each value written by the
+     * server to a resource in this object, other than an
+     * OPAQUE resource, is appended; see
+     * m2m_object_helper_journal.h.  The journal may be
+     * shared between objects.
+     *
+     * @param journal the journal, NULL to stop journalling.
+     */
+    void setJournal(M2MObjectJournal *journal);
+
+    /** Set a pool from which to take the storage for the
+     * values of STRING resources in this object, including
+     * those too long to be held inline, and to which it is
+     * given back when the object is deleted; see
+     * m2m_object_helper_pool.h.  Must be called before
+     * makeObject() and the pool should only be shared with
+     * objects of the same defObject.  To take the object
+     * itself from the pool, create it with
+     * M2MObjectPool::make().
+     *
+     * @param pool the pool, NULL to use the heap.
+     * @return     true if successful, otherwise false.
+     */
+    bool setPool(M2MObjectPool *pool);
+
+    /** Set a link-format payload, see
+     * m2m_object_helper_links.h, which this object adds
+     * itself to when it is made and removes itself from
+     * when it is deleted.  If the object has already been
+     * made it is moved from any previous payload to this
+     * one straight away.
+     *
+     * @param links the payload, NULL for none.
+     * @return      true if successful, otherwise false.
+     */
+    bool setLinkPayload(M2MLinkPayload *links);
+
+#if OPAQUE_WRITE_STREAMING
+    /** Get how far the server has got in writing a value
+     * to an OPAQUE resource through the callback set with
+     * setOpaqueWriteCallback().
+     *
+     * @param offset           pointer to a place to put the
+     *                         number of bytes of the value
+     *                         that have been dealt with.
+     * @param totalLength      pointer to a place to put the
+     *                         length of the whole value, 0 if
+     *                         not known; may be NULL.
+     * @param resourceNumber   the number of the resource.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 true if successful, otherwise
+     *                         false.
+     */
+    bool getOpaqueWriteProgress(uint32_t *offset,
+                                uint32_t *totalLength,
+                                const char *resourceNumber,
+                                int wantedInstance = -1);
+
+    /** Set how far the server has got in writing a value
+     * to an OPAQUE resource, e.g. to carry on after a
+     * restart with what has already been stored.  When the
+     * server next sends the same value (i.e. one of the same
+     * totalLength) the blocks up to offset are skipped.
+     *
+     * @param offset           the number of bytes of the
+     *                         value already dealt with.
+     * @param totalLength      the length of the whole value.
+     * @param resourceNumber   the number of the resource.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 true if successful, otherwise
+     *                         false.
+     */
+    bool setOpaqueWriteProgress(uint32_t offset,
+                                uint32_t totalLength,
+                                const char *resourceNumber,
+                                int wantedInstance = -1);
+#endif
+
     /** Set the execute callback (for an executable resource).
      *
      * @param callback the callback.
@@ -474,6 +1257,23 @@ protected:
                           const char *resourceNumber,
                           int wantedInstance = -1);
 
+    /** Set the value of a given enumerated STRING resource
+     * in an object (i.e. one with enumValues set in its
+     * DefResourceOptions) by its index in enumValues.
+     *
+     * @param enumIndex        the index of the value in
+     *                         enumValues.
+     * @param resourceNumber   the number of the resource whose
+     *                         value is to be set.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 true if successful, otherwise
+     *                         false.
+     */
+    bool setResourceEnumIndex(uint8_t enumIndex,
+                              const char *resourceNumber,
+                              int wantedInstance = -1);
+
     /** Get the value of a given resource in an object.
      *
      * @param value            pointer to a place to put
@@ -552,6 +1352,70 @@ protected:
                           const char *resourceNumber,
                           int wantedInstance = -1);
 
+    /** Get the value of a given enumerated STRING resource
+     * in an object as its index in enumValues.
+     *
+     * @param enumIndex        pointer to a place to put the
+     *                         index, which will be
+     *                         ENUM_INDEX_NONE if the resource
+     *                         has no value or the server has
+     *                         written a value not in enumValues.
+     * @param resourceNumber   the number of the resource whose
+     *                         value is to be got.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 true if successful, otherwise
+     *                         false.
+     */
+    bool getResourceEnumIndex(uint8_t *enumIndex,
+                              const char *resourceNumber,
+                              int wantedInstance = -1);
+
+    /** Get the value of a given resource in an object if
+     * it has changed since the version given, see
+     * getResourceVersion(); a version of 0 gets any value.
+     * There is a version for each type getResourceValue()
+     * takes, the char * version also taking len, and
+     * getEnumIndexIfChanged() for getResourceEnumIndex().
+     *
+     * @param value            pointer to a place to put
+     *                         the resource value.
+     * @param version          pointer to the version last
+     *                         got, updated if the value is.
+     * @param resourceNumber   the number of the resource whose
+     *                         value is to be got.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @return                 true if the value has changed
+     *                         and has been got, false if it
+     *                         is unchanged or could not be got.
+     */
+    bool getIfChanged(int64_t *value,
+                      uint32_t *version,
+                      const char *resourceNumber,
+                      int wantedInstance = -1);
+    bool getIfChanged(float *value,
+                      uint32_t *version,
+                      const char *resourceNumber,
+                      int wantedInstance = -1);
+    bool getIfChanged(bool *value,
+                      uint32_t *version,
+                      const char *resourceNumber,
+                      int wantedInstance = -1);
+    bool getIfChanged(char *value,
+                      unsigned int len,
+                      uint32_t *version,
+                      const char *resourceNumber,
+                      int wantedInstance = -1);
+    bool getIfChanged(String *value,
+                      uint32_t *version,
+                      const char *resourceNumber,
+                      int wantedInstance = -1);
+    bool getEnumIndexIfChanged(uint8_t *enumIndex,
+                               uint32_t *version,
+                               const char *resourceNumber,
+                               int wantedInstance = -1);
+
     /** True if debug is on, otherwise false.
      */
     bool _debugOn;
@@ -560,8 +1424,434 @@ protected:
      */
     friend class M2MBase;
 
+    /** Needs the definition types to load them.
+     */
+    friend class M2MDefinitionBlob;
+
+    /** Creates resources on its own threads.
+     */
+    friend class M2MObjectBuilder;
+
+    /** Saves and restores objects.
+     */
+    friend class M2MObjectSnapshot;
+
+    /** Keeps the fragments of objects in order.
+     */
+    friend class M2MLinkPayload;
+
 private:
 
+    /** The number of entries in the cache
+     * used to speed up resource lookups.  The
+     * cache is not locked: each entry carries a
+     * sequence number, odd while the entry is
+     * being written, which a reader checks before
+     * and after reading the entry, so an entry
+     * being overwritten by another thread costs a
+     * miss but never gives the wrong resource.
+     * The rest of the helper, like Mbed Client
+     * itself, expects to be called from one thread
+     * at a time.
+     */
+#   ifndef RESOURCE_LOOKUP_CACHE_SIZE
+#   define RESOURCE_LOOKUP_CACHE_SIZE 4
+#   endif
+
+    /** A resource number found in the lookup cache
+     * by its pointer is believed without comparing
+     * the name, so the resource numbers passed in
+     * must not change while the object exists, as
+     * string literals don't.  Set to 0 if resource
+     * numbers are built at run time in buffers that
+     * are re-used, and each cache hit is then
+     * confirmed by comparing the name.
+     */
+#   ifndef RESOURCE_LOOKUP_CACHE_TRUST_POINTER
+#   define RESOURCE_LOOKUP_CACHE_TRUST_POINTER 1
+#   endif
+
+    /** Binds the value updated callback of a resource
+     * in Mbed Client back to this object, so that we
+     * know which resource instance was written.
+     */
+    class ResourceBinding {
+    public:
+        void valueUpdated(const char *resourceName);
+#if OPAQUE_WRITE_STREAMING
+        void blockReceived(M2MBlockMessage *message);
+#endif
+        static int readConstValue(const M2MResourceBase &resource,
+                                  void *buffer, size_t *bufferSize,
+                                  void *clientArgs);
+        static int readConstValueSize(const M2MResourceBase &resource,
+                                      size_t *bufferSize,
+                                      void *clientArgs);
+        static int readStringValue(const M2MResourceBase &resource,
+                                   void *buffer, size_t *bufferSize,
+                                   void *clientArgs);
+        static int readStringValueSize(const M2MResourceBase &resource,
+                                       size_t *bufferSize,
+                                       void *clientArgs);
+        static int readFileValue(const M2MResourceBase &resource,
+                                 void *buffer, size_t *bufferSize,
+                                 void *clientArgs);
+        static int readFileValueSize(const M2MResourceBase &resource,
+                                     size_t *bufferSize,
+                                     void *clientArgs);
+#if ACKNOWLEDGED_VALUES
+        static void notificationStatus(const M2MBase &base,
+                                       const M2MBase::NotificationDeliveryStatus status,
+                                       void *clientArgs);
+#endif
+#if STALE_VALUES
+        static void staleTimerExpired(void *clientArgs);
+#endif
+        M2MObjectHelper *helper;
+        int index;
+    };
+
+    /** Structure to hold what we know about a resource
+     * once it has been created, indexed in the same
+     * way as the resources[] array of the DefObject.
+     */
+    typedef struct {
+        M2MResourceBase *handle; ///< the resource or, for a multi-instance
+                                 /// resource, the resource instance; NULL
+                                 /// if it has not been created.
+        ResourceBinding binding; ///< binding for the value updated callback.
+        char *stringInline;      ///< for a STRING resource, storage for its
+                                 /// value, NULL for other resource types.
+        uint16_t stringInlineLength; ///< the number of characters (excluding
+                                     /// the terminator) stringInline can hold.
+        char *stringHeap;        ///< storage for a value longer than
+                                 /// stringInlineLength, NULL until needed,
+                                 /// from M2MObjectPool::takeFrom().
+        uint16_t stringHeapLength; ///< the number of characters (excluding
+                                   /// the terminator) stringHeap can hold.
+        uint16_t stringLength;   ///< the length of the value.
+        bool stringValid;        ///< true if the value held here matches
+                                 /// that in Mbed Client.
+        bool stringServed;       ///< true if Mbed Client asks the helper
+                                 /// for the value rather than keeping a
+                                 /// copy of its own.
+        uint8_t enumIndex;       ///< for an enumerated STRING resource, the
+                                 /// index of the value in enumValues, in
+                                 /// which case stringInline is not used.
+#if OPAQUE_WRITE_STREAMING
+        uint32_t opaqueOffset;   ///< for an OPAQUE resource, the number of
+                                 /// bytes of the value being written that
+                                 /// have been passed to the callback.
+        uint32_t opaqueTotalLength; ///< the length of the whole value being
+                                    /// written, 0 if not known.
+        uint32_t opaqueBlockSize;   ///< the size of the blocks in which it
+                                    /// is being written, 0 if not known.
+        bool opaqueBlockwise;    ///< true if the value being written has
+                                 /// arrived block-wise, i.e. has been passed
+                                 /// to the callback already.
+#endif
+#if RESOURCE_VERSIONS
+        uint32_t version;        ///< the version of the object when the
+                                 /// value last changed.
+#endif
+#if ACKNOWLEDGED_VALUES
+        uint32_t queuedVersion;  ///< the version of the value last given
+                                 /// to Mbed Client to notify.
+        uint32_t sentVersion;    ///< the version of the value last sent to
+                                 /// the server in a notification.
+        uint32_t ackedVersion;   ///< the version of the value the server
+                                 /// last confirmed receiving, 0 if none.
+#endif
+#if STALE_VALUES
+        M2MTimerWheel::Timer staleTimer; ///< runs while the value is not
+                                         /// stale if the resource has a
+                                         /// maxUpdateIntervalMs; its callback
+                                         /// is NULL if not.
+        uint32_t lastSet;        ///< the time on the timer wheel when the
+                                 /// value was last set.
+        bool stale;              ///< true if the value has gone stale.
+#endif
+    } ResourceState;
+
+    /** Structure to represent an entry in the
+     * resource lookup cache.
+     */
+    typedef struct {
+        uint32_t sequence;          ///< bumped before and after the entry
+                                    /// is written, so odd while it is.
+        const char *resourceNumber; ///< the resourceNumber pointer as passed
+                                    /// in by the caller, NULL if unused.
+        int wantedInstance;         ///< the instance asked for.
+        int index;                  ///< index into the resources[] array of
+                                    /// the DefObject, -1 if unused.
+        M2MResourceBase *handle;    ///< the handle of the resource, NULL if
+                                    /// it had not been created.
+    } LookupCacheEntry;
+
+#if RESOURCE_HASH
+    /** Build a minimal perfect hash over the name
+     * and instance of each resource in the object
+     * definition, called by makeObject() for objects
+     * of at least RESOURCE_HASH_MIN_RESOURCES
+     * resources.  If one can't be found findResource()
+     * will search the definition instead.
+     *
+     * @return  true if successful, otherwise false.
+     */
+    bool makeHash();
+#endif
+
+    /** Create the object, called by makeObject().
+     *
+     * @param prototype      the object to copy the set-up of,
+     *                       NULL to work it out.
+     * @param stringStorage  storage for the values of STRING
+     *                       resources, NULL to allocate it.
+     * @return               true if successful, otherwise false.
+     */
+    bool createObject(const M2MObjectHelper *prototype, char *stringStorage);
+
+    /** Create the object and its instance, but none of
+     * its resources, called by createObject() and
+     * beginMakeObject().
+     *
+     * @param prototype      the object to copy the set-up of,
+     *                       NULL to work it out.
+     * @param stringStorage  storage for the values of STRING
+     *                       resources, NULL to allocate it.
+     * @return               true if successful, otherwise false.
+     */
+    bool startObject(const M2MObjectHelper *prototype, char *stringStorage);
+
+    /** Create a resource of the object.
+     *
+     * @param index  the index of the resource in the
+     *               resources[] array of the DefObject.
+     * @return       true if successful, otherwise false.
+     */
+    bool makeResource(int index);
+
+    /** Find a resource in the object definition.
+     * The resourceNumber pointer is looked up first
+     * in a small cache, since callers almost always
+     * pass in the same string literal each time, and
+     * a hit costs no compare of the name (see
+     * RESOURCE_LOOKUP_CACHE_TRUST_POINTER).  Otherwise
+     * the perfect hash, which costs one hash and one
+     * compare whatever the size of the object, is used
+     * if there is one, else the definition is searched.
+     *
+     * @param resourceNumber   the number of the resource.
+     * @param wantedInstance   the resource instance if there
+     *                         is more than one.
+     * @param handle           pointer to a place to put the
+     *                         handle of the resource, NULL
+     *                         if it has not been created;
+     *                         may be NULL.
+     * @return                 the index of the resource in the
+     *                         resources[] array of the DefObject,
+     *                         -1 if it is not found.
+     */
+    int findResource(const char *resourceNumber,
+                     int wantedInstance = -1,
+                     M2MResourceBase **handle = NULL);
+
+    /** Remember the result of a lookup in the cache,
+     * unless another thread is writing the entry that
+     * is next to be overwritten.
+     *
+     * @param resourceNumber   the number of the resource.
+     * @param wantedInstance   the resource instance asked for.
+     * @param index            the index of the resource.
+     */
+    void cacheLookup(const char *resourceNumber,
+                     int wantedInstance, int index);
+
+    /** Attach a newly created resource to the helper:
+     * set its operation and callbacks.
+     *
+     * @param index  the index of the resource.
+     */
+    void bindResource(int index);
+
+#if OPAQUE_WRITE_STREAMING
+    /** Handle a block of a value written by the server
+     * to an OPAQUE resource.
+     *
+     * @param index    the index of the resource.
+     * @param message  the block from Mbed Client.
+     */
+    void opaqueBlockReceived(int index, M2MBlockMessage *message);
+
+    /** Pass a value written by the server to an OPAQUE
+     * resource in a single message to the opaque write
+     * callback as one block.
+     *
+     * @param index  the index of the resource.
+     */
+    void opaqueValueReceived(int index);
+#endif
+
+    /** Get the length of the value of a file-backed
+     * OPAQUE resource.
+     *
+     * @param index   the index of the resource.
+     * @param length  pointer to a place to put the length.
+     * @return        true if successful, otherwise false.
+     */
+    bool getFileValueLength(int index, size_t *length);
+
+    /** Read the value of a file-backed OPAQUE resource
+     * into a buffer.
+     *
+     * @param index   the index of the resource.
+     * @param buffer  the buffer.
+     * @param length  on entry the size of buffer, on
+     *                return the number of bytes read,
+     *                fewer if the file is shorter.
+     * @return        true if successful, otherwise false.
+     */
+    bool readFileValue(int index, void *buffer, size_t *length);
+
+    /** Get the constant value of a resource.
+     *
+     * @param index  the index of the resource.
+     * @return       the value, NULL if the resource does
+     *               not have a constant value.
+     */
+    const char *getConstValue(int index);
+
+    /** Get the options for a resource.
+     *
+     * @param index  the index of the resource.
+     * @return       the options, NULL if there are none.
+     */
+    const DefResourceOptions *getResourceOptions(int index);
+
+    /** Set the value of an enumerated STRING resource,
+     * doing nothing if the value is unchanged.
+     *
+     * @param enumIndex  the index of the value in enumValues.
+     * @param index      the index of the resource.
+     * @return           true if successful, otherwise false.
+     */
+    bool setEnumValue(uint8_t enumIndex, int index);
+
+    /** Set up the storage for the values of STRING
+     * resources, called by makeObject().  This is a
+     * single allocation which holds the inline storage
+     * of all of the STRING resources in the object.
+     *
+     * @param prototype  the object to copy the layout of the
+     *                   storage from, NULL to work it out.
+     * @param storage    the storage to use, NULL to allocate it.
+     * @return           true if successful, otherwise false.
+     */
+    bool makeStringStorage(const M2MObjectHelper *prototype, char *storage);
+
+    /** Get the value of a STRING resource as held by
+     * the helper.
+     *
+     * @param index  the index of the resource.
+     * @return       the NULL terminated value, or NULL if
+     *               the helper doesn't hold it.
+     */
+    const char *getStringValue(int index);
+
+    /** Update the value of a STRING resource as held
+     * by the helper.  The inline storage is used if the
+     * value fits, otherwise heap storage is allocated
+     * (and then kept for re-use).
+     *
+     * @param index   the index of the resource.
+     * @param value   the value, need not be NULL terminated.
+     * @param length  the length of value.
+     */
+    void updateStringValue(int index, const char *value,
+                           unsigned int length);
+
+    /** Set the value of a STRING resource, doing nothing
+     * if the value is unchanged.
+     *
+     * @param value   the value, need not be NULL terminated.
+     * @param length  the length of value.
+     * @param index   the index of the resource.
+     * @return        true if successful, otherwise false.
+     */
+    bool setStringValue(const char *value, unsigned int length,
+                        int index);
+
+    /** Set the value of a non-STRING resource as text,
+     * doing nothing if the value is unchanged.
+     *
+     * @param text    the value, need not be NULL terminated.
+     * @param length  the length of text.
+     * @param index   the index of the resource.
+     * @return        true if successful, otherwise false.
+     */
+    bool setTextValue(const char *text, unsigned int length,
+                      int index);
+
+    /** Give Mbed Client a new value for a resource, noting,
+     * if ACKNOWLEDGED_VALUES is 1, the version that any
+     * notification it queues will carry.
+     *
+     * @param value   the value, need not be NULL terminated.
+     * @param length  the length of value.
+     * @param index   the index of the resource.
+     * @return        true if successful, otherwise false.
+     */
+    bool setHandleValue(const char *value, unsigned int length,
+                        int index);
+
+    /** Note that the value of a resource has changed,
+     * bumping its version and that of the object and
+     * recording the change in the change ring.
+     *
+     * @param index  the index of the resource.
+     */
+    void valueChanged(int index);
+
+    /** Get the version of the value of a resource, see
+     * getResourceVersion().
+     *
+     * @param index  the index of the resource.
+     * @return       the version.
+     */
+    uint32_t getVersion(int index) const;
+
+    /** Note that a resource has been set, changed or
+     * not, for the purpose of spotting stale values.
+     *
+     * @param index  the index of the resource.
+     */
+    void valueSet(int index);
+
+    /** Start the stale timers of the resources of this
+     * object, called once they have all been made.
+     */
+    void startStaleTimers();
+
+#if STALE_VALUES
+    /** Called when the stale timer of a resource expires:
+     * marks the resource stale if it has not been set
+     * since the timer was started, otherwise starts the
+     * timer again for the rest of the interval.
+     *
+     * @param index  the index of the resource.
+     */
+    void staleTimerExpired(int index);
+#endif
+
+    /** Called via the ResourceBinding when the server
+     * has written to a resource.
+     *
+     * @param index            the index of the resource.
+     * @param resourceName     the resource name as passed
+     *                         to us by Mbed Client.
+     */
+    void resourceWritten(int index, const char *resourceName);
+
     /** Set the value of a given resource in an object.
      *
      * @param value            pointer to the value of the
@@ -577,20 +1867,14 @@ private:
      *                         type BOOLEAN the value should
      *                         be a pointer to bool.
      * @param resourceType     the resource type.
-     * @param resourceNumber   the number of the resource whose
-     *                         value is to be set.
-     * @param wantedInstance   the resource instance if there
-     *                         is more than one.
-     * @param format           the format string, only relevant
-     *                         if type is String.
+     * @param index            the index of the resource, as
+     *                         returned by findResource().
      * @return                 true if successful, otherwise
      *                         false.
      */
     bool setResourceValue(const void *value,
                           M2MResourceBase::ResourceType type,
-                          const char *resourceNumber,
-                          int wantedInstance = -1,
-                          const char *format = NULL);
+                          int index);
 
     /** Get the value of a given resource in an object.
      *
@@ -608,17 +1892,14 @@ private:
      *                         the value should be a pointer
      *                         to bool.
      * @param resourceType     the resource type.
-     * @param resourceNumber   the number of the resource whose
-     *                         value is to be set.
-     * @param wantedInstance   the resource instance if there
-     *                         is more than one.
+     * @param index            the index of the resource, as
+     *                         returned by findResource().
      * @return                 true if successful, otherwise
      *                         false.
      */
     bool getResourceValue(void *value,
                           M2MResourceBase::ResourceType type,
-                          const char *resourceNumber,
-                          int wantedInstance = -1);
+                          int index);
 
     /** A pointer to the definition for this object.
      */
@@ -628,6 +1909,88 @@ private:
      */
     M2MObject *_object;
 
+    /** A pointer to the instance of the LWM2M object
+     * created by makeObject().
+     */
+    M2MObjectInstance *_objectInstance;
+
+    /** The instance of the LWM2M object, normally that
+     * in the DefObject.
+     */
+    int _instance;
+
+    /** The number of resources created (or attempted)
+     * so far and, of those, the number that failed.
+     */
+    int _numResourcesMade;
+    int _numResourcesFailed;
+
+    /** The start-up priority.
+     */
+    int _startupPriority;
+
+    /** The CoRE link-format fragment for this object
+     * instance, "</" + name + "/" + instance + ">".
+     */
+    char _linkFragment[MAX_OBJECT_RESOURCE_NAME_LENGTH + 16];
+
+    /** The length of _linkFragment, 0 until the object
+     * has been made.
+     */
+    uint8_t _linkFragmentLength;
+
+    /** The version of the values of this object, bumped
+     * each time the value of a resource changes.
+     */
+    uint32_t _version;
+
+    /** False if Mbed Client sends the notifications of this
+     * object non-confirmable, see setNotificationsConfirmable().
+     */
+    bool _notificationsConfirmable;
+
+    /** The state of each resource, indexed in the same
+     * way as the resources[] array of the DefObject.
+     */
+    ResourceState _resourceStates[MAX_NUM_RESOURCES];
+
+    /** Cache of recent resource lookups.
+     */
+    LookupCacheEntry _lookupCache[RESOURCE_LOOKUP_CACHE_SIZE];
+
+    /** The number of entries written to _lookupCache,
+     * which gives the next to be overwritten.
+     */
+    uint32_t _lookupCacheNext;
+
+    /** The inline storage for the values of all of
+     * the STRING resources in this object, pointed-to
+     * by the stringInline field of each ResourceState.
+     */
+    char *_stringStorage;
+
+    /** True if _stringStorage was allocated by the helper,
+     * with M2MObjectPool::takeFrom() from _pool if there is one.
+     */
+    bool _stringStorageOwned;
+
+#if RESOURCE_HASH
+    /** True if the perfect hash below is usable.
+     */
+    bool _hashValid;
+
+    /** The displacement for each bucket of the perfect hash;
+     * only the first numResources of this and _hashIndex
+     * are used.
+     */
+    uint16_t _hashDisplacement[MAX_NUM_RESOURCES];
+
+    /** The index into the resources[] array of the
+     * DefObject for each slot of the perfect hash.
+     */
+    int16_t _hashIndex[MAX_NUM_RESOURCES];
+#endif
+
     /** The value updated callback, may be NULL.  This should be
      * set if the object includes a writable resource and you
      * want to know when it has been written-to by the server
@@ -635,6 +1998,53 @@ private:
      * as appropriate).
      */
     value_updated_callback _valueUpdatedCallback;
+
+    /** The resource written callback, may be NULL.
+     */
+    ResourceWrittenCallback _resourceWrittenCallback;
+
+#if OPAQUE_WRITE_STREAMING
+    /** The OPAQUE write callback, may be NULL.
+     */
+    OpaqueWriteCallback _opaqueWriteCallback;
+#endif
+
+    /** The stale callback, may be NULL.
+     */
+    StaleCallback _staleCallback;
+
+    /** The journal, may be NULL.
+     */
+    M2MObjectJournal *_journal;
+
+    /** The pool, may be NULL.
+     */
+    M2MObjectPool *_pool;
+
+    /** The link-format payload, may be NULL.
+     */
+    M2MLinkPayload *_links;
+
+#if STALE_VALUES
+    /** The timer wheel that the stale timers of this
+     * object run on, taken from _timerWheel when the
+     * object is made; may be NULL.
+     */
+    M2MTimerWheel *_wheel;
+#endif
+
+    /** The start-up profile, may be NULL.
+     */
+    static M2MStartupProfile *_startupProfile;
+
+    /** The change ring, may be NULL.
+     */
+    static M2MChangeRing *_changeRing;
+
+    /** The timer wheel for objects made from now on,
+     * may be NULL.
+     */
+    static M2MTimerWheel *_timerWheel;
 };
 
 #endif // _M2M_OBJECT_HELPER_
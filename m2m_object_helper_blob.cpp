@@ -0,0 +1,402 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_blob.h"
+
+#if DEFINITION_BLOB_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/**********************************************************************
+ * STATIC FUNCTIONS
+ **********************************************************************/
+
+// Order offsets in a blob, for qsort() and bsearch().
+static int compareOffsets(const void *a, const void *b)
+{
+    uint32_t offsetA = *(const uint32_t *) a;
+    uint32_t offsetB = *(const uint32_t *) b;
+
+    if (offsetA != offsetB) {
+        return (offsetA < offsetB) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MDefinitionBlob::M2MDefinitionBlob(bool debugOn)
+{
+    _debugOn = debugOn;
+    _magic = "M2MD";
+    _blob = NULL;
+    _size = 0;
+    _index = NULL;
+    _sortedRelocations = NULL;
+    _numPointers = 0;
+}
+
+// Destructor.
+M2MDefinitionBlob::~M2MDefinitionBlob()
+{
+    close();
+}
+
+// Load a blob from a file.
+bool M2MDefinitionBlob::open(const char *path)
+{
+    close();
+
+#if DEFINITION_BLOB_MMAP
+    struct stat status;
+    void *map = MAP_FAILED;
+    int fd;
+
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if ((fd >= 0) && (fstat(fd, &status) == 0) && (status.st_size > 0)) {
+        // Private and writable so that the pointers can be fixed up,
+        // which dirties only the pages that hold them
+        map = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (map == MAP_FAILED) {
+        printfLog("M2MDefinitionBlob: unable to map \"%s\".\n", path);
+        return false;
+    }
+    _blob = (uint8_t *) map;
+    _size = status.st_size;
+#else
+    FILE *file;
+    long size = -1;
+
+    file = fopen(path, "rb");
+    if (file != NULL) {
+        if (fseek(file, 0, SEEK_END) == 0) {
+            size = ftell(file);
+        }
+        if ((size > 0) && (fseek(file, 0, SEEK_SET) == 0)) {
+            _blob = (uint8_t *) malloc(size);
+            if ((_blob != NULL) && (fread(_blob, 1, size, file) == (size_t) size)) {
+                _size = size;
+            }
+        }
+        fclose(file);
+    }
+    if (_size == 0) {
+        printfLog("M2MDefinitionBlob: unable to read \"%s\".\n", path);
+        close();
+        return false;
+    }
+#endif
+
+    if (!check()) {
+        printfLog("M2MDefinitionBlob: \"%s\" is not a definition blob for this build.\n", path);
+        close();
+        return false;
+    }
+    relocate();
+#if DEFINITION_BLOB_MMAP
+    mprotect(_blob, _size, PROT_READ);
+#endif
+    printfLog("M2MDefinitionBlob: loaded %d object definition(s) from \"%s\".\n", getNumObjects(), path);
+
+    return true;
+}
+
+// Release the blob.
+void M2MDefinitionBlob::close()
+{
+    if (_blob != NULL) {
+#if DEFINITION_BLOB_MMAP
+        munmap(_blob, _size);
+#else
+        free(_blob);
+#endif
+    }
+    _blob = NULL;
+    _size = 0;
+    _index = NULL;
+}
+
+// Get the number of object definitions in the blob.
+int M2MDefinitionBlob::getNumObjects()
+{
+    int numObjects = 0;
+
+    if (_blob != NULL) {
+        numObjects = ((const BlobHeader *) _blob)->numObjects;
+    }
+
+    return numObjects;
+}
+
+// Get an object definition by its position in the blob.
+const M2MObjectHelper::DefObject *M2MDefinitionBlob::getObject(int number)
+{
+    const M2MObjectHelper::DefObject *defObject = NULL;
+
+    if ((number >= 0) && (number < getNumObjects())) {
+        defObject = (const M2MObjectHelper::DefObject *) (_blob + _index[number].defObjectOffset);
+    }
+
+    return defObject;
+}
+
+// Find an object definition by its object ID and instance.
+const M2MObjectHelper::DefObject *M2MDefinitionBlob::findObject(uint32_t objectId, int instance)
+{
+    return getObject(findPosition(objectId, instance));
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Constructor for a derived format.
+M2MDefinitionBlob::M2MDefinitionBlob(const char *magic, bool debugOn)
+{
+    _debugOn = debugOn;
+    _magic = magic;
+    _blob = NULL;
+    _size = 0;
+    _index = NULL;
+    _sortedRelocations = NULL;
+    _numPointers = 0;
+}
+
+// Find the position of an object definition in the blob.
+int M2MDefinitionBlob::findPosition(uint32_t objectId, int instance)
+{
+    int low = 0;
+    int high = getNumObjects() - 1;
+    int middle;
+    const BlobIndexEntry *entry;
+
+    // The index is sorted, so a binary search
+    while (low <= high) {
+        middle = (low + high) / 2;
+        entry = &(_index[middle]);
+        if ((entry->objectId < objectId) ||
+            ((entry->objectId == objectId) && (entry->instance < instance))) {
+            low = middle + 1;
+        } else if ((entry->objectId == objectId) && (entry->instance == instance)) {
+            return middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+// Check that the blob is one we understand.
+bool M2MDefinitionBlob::check()
+{
+    const BlobHeader *header = (const BlobHeader *) _blob;
+    const uint32_t *relocations;
+    uint32_t *sorted;
+    uintptr_t value;
+    bool success = true;
+
+    if ((_size < sizeof(BlobHeader)) || (memcmp(header->magic, _magic, 4) != 0) ||
+        (header->version != DEFINITION_BLOB_VERSION) ||
+        (header->headerSize != sizeof(BlobHeader)) ||
+        (header->pointerSize != sizeof(void *)) ||
+        (header->defObjectSize != sizeof(M2MObjectHelper::DefObject)) ||
+        (header->defResourceSize != sizeof(M2MObjectHelper::DefResource)) ||
+        (header->defObjectHashSize != sizeof(M2MObjectHelper::DefObjectHash)) ||
+        (header->maxNumResources != MAX_NUM_RESOURCES) ||
+        (header->maxNameLength != MAX_OBJECT_RESOURCE_NAME_LENGTH) ||
+        (header->maxTypeLength != MAX_RESOURCE_TYPE_LENGTH) ||
+        (header->totalSize != _size)) {
+        return false;
+    }
+
+    // Everything must stay inside the blob and be aligned
+    if ((header->indexOffset % sizeof(uint32_t) != 0) ||
+        (header->indexOffset > _size) ||
+        (header->numObjects > (_size - header->indexOffset) / sizeof(BlobIndexEntry)) ||
+        (header->relocationsOffset % sizeof(uint32_t) != 0) ||
+        (header->relocationsOffset > _size) ||
+        (header->numRelocations > (_size - header->relocationsOffset) / sizeof(uint32_t))) {
+        return false;
+    }
+    _index = (const BlobIndexEntry *) (_blob + header->indexOffset);
+    relocations = (const uint32_t *) (_blob + header->relocationsOffset);
+    for (uint32_t x = 0; x < header->numRelocations; x++) {
+        if ((relocations[x] % sizeof(void *) != 0) || (relocations[x] > _size - sizeof(void *))) {
+            return false;
+        }
+        value = *(const uintptr_t *) (_blob + relocations[x]);
+        if (value >= _size) {
+            return false;
+        }
+    }
+
+    // Each pointer in the blob must be relocated exactly once and
+    // nothing else may be, so keep the relocations sorted to look
+    // the pointers up in while the objects are checked
+    sorted = (uint32_t *) malloc((header->numRelocations + 1) * sizeof(uint32_t));
+    if (sorted == NULL) {
+        return false;
+    }
+    memcpy(sorted, relocations, header->numRelocations * sizeof(uint32_t));
+    qsort(sorted, header->numRelocations, sizeof(uint32_t), compareOffsets);
+    for (uint32_t x = 1; (x < header->numRelocations) && success; x++) {
+        success = (sorted[x] != sorted[x - 1]);
+    }
+    _sortedRelocations = sorted;
+    _numPointers = 0;
+    for (uint32_t x = 0; (x < header->numObjects) && success; x++) {
+        success = checkObject(x);
+    }
+    success = success && (_numPointers == header->numRelocations);
+    _sortedRelocations = NULL;
+    free(sorted);
+
+    return success;
+}
+
+// Check an object definition in the blob.
+bool M2MDefinitionBlob::checkObject(uint32_t position)
+{
+    const BlobHeader *header = (const BlobHeader *) _blob;
+    uint32_t offset = _index[position].defObjectOffset;
+    const M2MObjectHelper::DefObject *defObject;
+    const M2MObjectHelper::DefResource *defResource;
+    const M2MObjectHelper::DefResourceOptions *options;
+    const char * const *enumValues;
+
+    if ((offset % sizeof(void *) != 0) || (offset > _size) ||
+        (sizeof(M2MObjectHelper::DefObject) > _size - offset)) {
+        return false;
+    }
+    defObject = (const M2MObjectHelper::DefObject *) (_blob + offset);
+    if ((defObject->numResources < 0) || (defObject->numResources > MAX_NUM_RESOURCES) ||
+        (memchr(defObject->name, 0, sizeof(defObject->name)) == NULL) ||
+        !checkPointer(&(defObject->hash), sizeof(M2MObjectHelper::DefObjectHash), sizeof(uint16_t))) {
+        return false;
+    }
+    for (int x = 0; x < MAX_NUM_RESOURCES; x++) {
+        // Unused resources are never looked at but, if they have
+        // a format, it must still be relocated
+        defResource = &(defObject->resources[x]);
+        if (!checkString(&(defResource->format)) ||
+            ((x < defObject->numResources) &&
+             ((memchr(defResource->name, 0, sizeof(defResource->name)) == NULL) ||
+              (memchr(defResource->typeString, 0, sizeof(defResource->typeString)) == NULL)))) {
+            return false;
+        }
+    }
+
+    if (defObject->resourceOptions != NULL) {
+        // The options, and everything they point to, must
+        // be inside the blob too
+        if ((header->defResourceOptionsSize != sizeof(M2MObjectHelper::DefResourceOptions)) ||
+            !checkPointer(&(defObject->resourceOptions),
+                          defObject->numResources * sizeof(M2MObjectHelper::DefResourceOptions),
+                          sizeof(void *))) {
+            return false;
+        }
+        options = (const M2MObjectHelper::DefResourceOptions *) (_blob + (uintptr_t) defObject->resourceOptions);
+        for (int x = 0; x < defObject->numResources; x++) {
+            if ((options[x].stringInlineLength < 0) || (options[x].stringInlineLength > UINT16_MAX) ||
+                (options[x].numEnumValues < 0) || (options[x].numEnumValues > ENUM_INDEX_NONE) ||
+                !checkPointer(&(options[x].enumValues), options[x].numEnumValues * sizeof(const char *),
+                              sizeof(void *)) ||
+                !checkString(&(options[x].constValue)) || !checkString(&(options[x].filePath))) {
+                return false;
+            }
+            if (options[x].enumValues != NULL) {
+                enumValues = (const char * const *) (_blob + (uintptr_t) options[x].enumValues);
+                for (int y = 0; y < options[x].numEnumValues; y++) {
+                    if ((enumValues[y] == NULL) || !checkString(&(enumValues[y]))) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Check that a pointer in the blob is NULL or a relocated
+// offset of some bytes inside it.
+bool M2MDefinitionBlob::checkPointer(const void *pointer, size_t size, size_t alignment)
+{
+    uintptr_t value = *(const uintptr_t *) pointer;
+
+    return (value == 0) ||
+           (isRelocated(pointer) && (value % alignment == 0) && (value <= _size) &&
+            (size <= _size - value));
+}
+
+// Check that a string pointer in the blob is NULL or the relocated
+// offset of a string which ends inside it.
+bool M2MDefinitionBlob::checkString(const void *pointer)
+{
+    uintptr_t value = *(const uintptr_t *) pointer;
+
+    return (value == 0) ||
+           (isRelocated(pointer) && (value < _size) &&
+            (memchr(_blob + value, 0, _size - value) != NULL));
+}
+
+// Find out if a pointer in the blob is relocated, counting it.
+bool M2MDefinitionBlob::isRelocated(const void *pointer)
+{
+    uint32_t offset = (const uint8_t *) pointer - _blob;
+    const BlobHeader *header = (const BlobHeader *) _blob;
+    bool relocated = false;
+
+    if (_sortedRelocations != NULL) {
+        relocated = (bsearch(&offset, _sortedRelocations, header->numRelocations,
+                             sizeof(uint32_t), compareOffsets) != NULL);
+        if (relocated) {
+            _numPointers++;
+        }
+    }
+
+    return relocated;
+}
+
+// Turn the offsets in the blob into pointers.
+void M2MDefinitionBlob::relocate()
+{
+    const BlobHeader *header = (const BlobHeader *) _blob;
+    const uint32_t *relocations = (const uint32_t *) (_blob + header->relocationsOffset);
+
+    for (uint32_t x = 0; x < header->numRelocations; x++) {
+        *(uintptr_t *) (_blob + relocations[x]) += (uintptr_t) _blob;
+    }
+}
+
+// End of file
@@ -0,0 +1,269 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_BLOB_
+#define _M2M_OBJECT_HELPER_BLOB_
+
+/** This class loads object definitions for M2MObjectHelper from a
+ * binary file, so that the set of object types need not be compiled in.
+ *
+ * OVERVIEW
+ *
+ * A definition blob is made from object definitions in the C
+ * initialiser form (as you would write in your own code) or from OMA
+ * LWM2M object XML by tools/m2m_def_blob.py, e.g.:
+ *
+ * tools/m2m_def_blob.py -o site.blob my_objects.cpp 3303.xml
+ *
+ * The DefObjects in the blob are laid out exactly as the compiler lays
+ * them out, each with the perfect hash of its resources already worked
+ * out, so that once the blob is loaded they are used where they are:
+ * nothing is parsed and nothing is copied.  The only fix-up on loading
+ * is to turn the offsets of any pointers in the blob (to the hashes, to
+ * FLOAT format strings and to resourceOptions and what they point to)
+ * into addresses.  The blob says which version of the format it is in
+ * and the sizes of the structures it was made for, and is refused if
+ * these don't match the build; the converter must be given the same
+ * MAX_NUM_RESOURCES etc. as the build, and the pointer size of the
+ * target.  A blob is also refused if anything in it would be read
+ * from outside it: every name must be terminated, every pointer must
+ * be in the relocation table, exactly once, and point to as much as
+ * it should (a hash, a string, etc.) within the blob.
+ *
+ * On Linux (DEFINITION_BLOB_MMAP) the file is memory-mapped privately,
+ * elsewhere it is read into a single heap allocation.  Load a blob
+ * and then pass its definitions to your M2MObjectHelper subclasses,
+ * e.g.:
+ *
+ * M2MDefinitionBlob blob;
+ * if (blob.open("/etc/site.blob")) {
+ *     sensor = new GenericObject(blob.findObject(3303, 0));
+ *     ...
+ *
+ * The blob must not be closed or deleted while any object made from it
+ * still exists.  The blobs made by tools/m2m_def_blob.py have no
+ * resourceOptions; a snapshot (see m2m_object_helper_snapshot.h) has
+ * those of the objects saved in it.
+ */
+class M2MDefinitionBlob {
+public:
+
+    /** The version of the blob format that this code
+     * understands.
+     */
+#   define DEFINITION_BLOB_VERSION 1
+
+    /** Set to 1 to memory-map blob files, 0 to read
+     * them into the heap; by default 1 on Linux.
+     */
+#   ifndef DEFINITION_BLOB_MMAP
+#   ifdef __linux__
+#   define DEFINITION_BLOB_MMAP 1
+#   else
+#   define DEFINITION_BLOB_MMAP 0
+#   endif
+#   endif
+
+    /** Constructor.
+     *
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MDefinitionBlob(bool debugOn = false);
+
+    /** Destructor.
+     */
+    virtual ~M2MDefinitionBlob();
+
+    /** Load a blob from a file.
+     *
+     * @param path  the path of the file.
+     * @return      true if successful, otherwise false.
+     */
+    bool open(const char *path);
+
+    /** Release the blob.
+     */
+    void close();
+
+    /** Get the number of object definitions in the blob.
+     *
+     * @return  the number of object definitions.
+     */
+    int getNumObjects();
+
+    /** Get an object definition by its position in the
+     * blob, the definitions being in order of object ID
+     * and then instance.
+     *
+     * @param number  the position, 0 for the first.
+     * @return        the definition, NULL if there is none.
+     */
+    const M2MObjectHelper::DefObject *getObject(int number);
+
+    /** Find an object definition by its object ID and
+     * instance.
+     *
+     * @param objectId  the object ID, e.g. 3303.
+     * @param instance  the object instance.
+     * @return          the definition, NULL if there is none.
+     */
+    const M2MObjectHelper::DefObject *findObject(uint32_t objectId, int instance = 0);
+
+protected:
+
+    /** Constructor for a derived format.
+     *
+     * @param magic    the four characters at the start
+     *                 of a file in that format.
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MDefinitionBlob(const char *magic, bool debugOn);
+
+    /** The header at the start of a blob; all fields are
+     * in the byte order of the target.
+     */
+    typedef struct {
+        char magic[4];              ///< "M2MD" (or as given to the
+                                    /// constructor of a derived format).
+        uint16_t version;           ///< DEFINITION_BLOB_VERSION.
+        uint16_t headerSize;        ///< sizeof(BlobHeader).
+        uint16_t pointerSize;       ///< sizeof(void *).
+        uint16_t defObjectSize;     ///< sizeof(DefObject).
+        uint16_t defResourceSize;   ///< sizeof(DefResource).
+        uint16_t defObjectHashSize; ///< sizeof(DefObjectHash).
+        uint16_t maxNumResources;   ///< MAX_NUM_RESOURCES.
+        uint16_t maxNameLength;     ///< MAX_OBJECT_RESOURCE_NAME_LENGTH.
+        uint16_t maxTypeLength;     ///< MAX_RESOURCE_TYPE_LENGTH.
+        uint16_t defResourceOptionsSize; ///< sizeof(DefResourceOptions), 0
+                                         /// if no DefObject in the blob has
+                                         /// resourceOptions.
+        uint32_t numObjects;        ///< the number of BlobIndexEntry.
+        uint32_t indexOffset;       ///< the offset of the BlobIndexEntry
+                                    /// array, sorted by object ID and then
+                                    /// instance.
+        uint32_t numRelocations;    ///< the number of relocations.
+        uint32_t relocationsOffset; ///< the offset of an array of uint32_t,
+                                    /// each the offset of a pointer in the
+                                    /// blob holding an offset in the blob.
+        uint32_t totalSize;         ///< the size of the whole blob.
+    } BlobHeader;
+
+    /** An entry in the index of a blob.
+     */
+    typedef struct {
+        uint32_t objectId;          ///< the object ID.
+        int32_t instance;           ///< the object instance.
+        uint32_t defObjectOffset;   ///< the offset of the DefObject.
+    } BlobIndexEntry;
+
+    /** Check that the blob is one we understand and
+     * that everything in it stays within it.
+     *
+     * @return  true if the blob is good, otherwise false.
+     */
+    virtual bool check();
+
+    /** Check an object definition in the blob, which
+     * check() has found the index entry of.
+     *
+     * @param position  the position of the definition.
+     * @return          true if the definition is good,
+     *                  otherwise false.
+     */
+    bool checkObject(uint32_t position);
+
+    /** Check that a pointer in the blob, before it is
+     * relocated, is NULL or is the relocated offset of
+     * a number of bytes inside the blob.
+     *
+     * @param pointer    the pointer.
+     * @param size       the number of bytes it points to.
+     * @param alignment  the alignment they need.
+     * @return           true if the pointer is good,
+     *                   otherwise false.
+     */
+    bool checkPointer(const void *pointer, size_t size, size_t alignment);
+
+    /** Check that a string pointer in the blob, before
+     * it is relocated, is NULL or is the relocated
+     * offset of a string which ends inside the blob.
+     *
+     * @param pointer  the pointer.
+     * @return         true if the pointer is good,
+     *                 otherwise false.
+     */
+    bool checkString(const void *pointer);
+
+    /** Find out if a pointer in the blob is in the
+     * relocation table, counting those that are; only
+     * for use while check() is running.
+     *
+     * @param pointer  the pointer.
+     * @return         true if it is relocated, otherwise
+     *                 false.
+     */
+    bool isRelocated(const void *pointer);
+
+    /** Find the position of an object definition in
+     * the blob by its object ID and instance.
+     *
+     * @param objectId  the object ID.
+     * @param instance  the object instance.
+     * @return          the position, -1 if there is none.
+     */
+    int findPosition(uint32_t objectId, int instance);
+
+    /** Turn the offsets in the blob into pointers.
+     */
+    void relocate();
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The magic characters expected at the start of
+     * the blob.
+     */
+    const char *_magic;
+
+    /** The blob, NULL if none is loaded.
+     */
+    uint8_t *_blob;
+
+    /** The size of the blob.
+     */
+    size_t _size;
+
+    /** The index of the blob.
+     */
+    const BlobIndexEntry *_index;
+
+    /** While check() is running, a sorted copy of the
+     * relocation table, otherwise NULL.
+     */
+    uint32_t *_sortedRelocations;
+
+    /** While check() is running, the number of pointers
+     * found in the relocation table.
+     */
+    uint32_t _numPointers;
+};
+
+#endif // _M2M_OBJECT_HELPER_BLOB_
+
+// End of file
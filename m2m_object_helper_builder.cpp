@@ -0,0 +1,462 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_builder.h"
+
+#if OBJECT_BUILDER_THREADS
+#include <pthread.h>
+#endif
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/**********************************************************************
+ * STATIC VARIABLES
+ **********************************************************************/
+
+void *M2MObjectBuilder::_mbedClientMutex = NULL;
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MObjectBuilder::M2MObjectBuilder(M2MObjectHelper * const *objects,
+                                   int numObjects,
+                                   bool debugOn)
+{
+    int priority;
+    int y;
+
+    _startTime = us_ticker_read();
+    _debugOn = debugOn;
+    _objects = objects;
+    _numObjects = numObjects;
+    _next = 0;
+    _nextReady = 0;
+    _numSteps = 0;
+    _stepUsMax = 0;
+    _stepUsTotal = 0;
+    _criticalReadyUs = 0;
+    _allReadyUs = 0;
+    _firstRegistrationUs = 0;
+    _fullRegistrationUs = 0;
+    _work = NULL;
+
+    // Order the objects by priority, keeping the order of the array
+    // within a priority; an insertion sort as there are usually only
+    // a few priorities and the array is mostly in order already
+    _numCritical = 0;
+    _order = new int[numObjects];
+    for (int x = 0; x < numObjects; x++) {
+        priority = objects[x]->getStartupPriority();
+        if (priority <= STARTUP_PRIORITY_CRITICAL) {
+            _numCritical++;
+        }
+        for (y = x; (y > 0) && (objects[_order[y - 1]]->getStartupPriority() > priority); y--) {
+            _order[y] = _order[y - 1];
+        }
+        _order[y] = x;
+    }
+}
+
+// Destructor.
+M2MObjectBuilder::~M2MObjectBuilder()
+{
+    delete[] _order;
+}
+
+// Create the next few resources of the set.
+int M2MObjectBuilder::step(int maxResources, uint32_t maxMicroseconds)
+{
+    uint32_t start = us_ticker_read();
+    uint32_t elapsed = 0;
+    int numMade = 0;
+    int numRemaining = 0;
+    int sliceResources = 0;
+    uint32_t sliceMicroseconds;
+    int numMadeBefore;
+    M2MObjectHelper *object;
+
+    // Work through the objects in order, sharing the limits between them
+    while ((_next < _numObjects) &&
+           ((numMade == 0) ||
+            (((maxResources <= 0) || (numMade < maxResources)) &&
+             ((maxMicroseconds == 0) || (elapsed < maxMicroseconds))))) {
+        object = _objects[_order[_next]];
+        numMadeBefore = object->getNumResourcesMade();
+        if (maxResources > 0) {
+            sliceResources = maxResources - numMade;
+        }
+        sliceMicroseconds = 0;
+        if (maxMicroseconds > 0) {
+            sliceMicroseconds = (elapsed < maxMicroseconds) ? maxMicroseconds - elapsed : 1;
+        }
+        if (object->makeObjectSlice(sliceResources, sliceMicroseconds) <= 0) {
+            // Complete, or never begun: either way nothing more to do
+            _next++;
+        }
+        numMade += object->getNumResourcesMade() - numMadeBefore;
+        elapsed = us_ticker_read() - start;
+        if ((_criticalReadyUs == 0) && (_next >= _numCritical)) {
+            _criticalReadyUs = (us_ticker_read() - _startTime) | 1;
+        }
+        if ((_allReadyUs == 0) && (_next >= _numObjects)) {
+            _allReadyUs = (us_ticker_read() - _startTime) | 1;
+        }
+    }
+
+    if (numMade > 0) {
+        _numSteps++;
+        _stepUsTotal += elapsed;
+        if (elapsed > _stepUsMax) {
+            _stepUsMax = elapsed;
+        }
+    }
+
+    for (int x = _next; x < _numObjects; x++) {
+        object = _objects[_order[x]];
+        numRemaining += object->getNumResources() - object->getNumResourcesMade();
+    }
+    if ((numRemaining == 0) && (numMade > 0)) {
+        printfLog("M2MObjectBuilder: %d object(s) ready, %u step(s), the longest %u us.\n",
+                  _numObjects, (unsigned int) _numSteps, (unsigned int) _stepUsMax);
+    }
+
+    return numRemaining;
+}
+
+// Determine whether all of the objects, or the critical ones, are complete.
+bool M2MObjectBuilder::isReady(bool criticalOnly)
+{
+    if (criticalOnly) {
+        return _next >= _numCritical;
+    }
+
+    return _next >= _numObjects;
+}
+
+// Add the objects that have become complete to a list.
+int M2MObjectBuilder::getReadyObjects(M2MObjectList *list)
+{
+    int numReady = _next - _nextReady;
+    int numNew = 0;
+    GroupKey *keys;
+
+    if (numReady > 0) {
+        // An M2MObject is handed out with the first of its objects to
+        // be complete: group what is complete by M2MObject, sorting as
+        // buildInParallel() does, and keep the first of each group if
+        // it has not been handed out before
+        keys = new GroupKey[_next];
+        for (int x = 0; x < _next; x++) {
+            keys[x].parent = _objects[_order[x]]->getObject();
+            keys[x].position = x;
+        }
+        qsort(keys, _next, sizeof(GroupKey), compareGroupKeys);
+        for (int x = 0; x < _next; x++) {
+            if ((keys[x].parent != NULL) && ((x == 0) || (keys[x].parent != keys[x - 1].parent)) &&
+                (keys[x].position >= _nextReady)) {
+                keys[numNew] = keys[x];
+                numNew++;
+            }
+        }
+        // Hand them out in build order
+        qsort(keys, numNew, sizeof(GroupKey), compareGroupPositions);
+        for (int x = 0; x < numNew; x++) {
+            list->push_back(keys[x].parent);
+        }
+        delete[] keys;
+        _nextReady = _next;
+    }
+
+    return numReady;
+}
+
+// Registration, or a registration update, has completed.
+void M2MObjectBuilder::registered()
+{
+    uint32_t now = (us_ticker_read() - _startTime) | 1;
+
+    if (_firstRegistrationUs == 0) {
+        _firstRegistrationUs = now;
+        printfLog("M2MObjectBuilder: first registration after %u us, %d object(s) of %d.\n",
+                  (unsigned int) now, _nextReady, _numObjects);
+    }
+    if ((_fullRegistrationUs == 0) && (_nextReady >= _numObjects)) {
+        _fullRegistrationUs = now;
+        printfLog("M2MObjectBuilder: full registration after %u us.\n", (unsigned int) now);
+    }
+}
+
+// Finish building the set on a pool of threads.
+bool M2MObjectBuilder::buildInParallel(int numThreads)
+{
+    ParallelWork work;
+    M2MObjectHelper *object;
+    GroupKey *keys;
+    GroupKey *groups;
+    bool *building;
+    int numKeys = 0;
+    int numGroupMembers = 0;
+    int numFailed = 0;
+    int numStarted = 0;
+    uint32_t start = us_ticker_read();
+    uint32_t elapsed;
+#if OBJECT_BUILDER_THREADS
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_mutex_t mbedClientMutex;
+#endif
+
+    // Group what remains by M2MObject, in build order: a group must
+    // only ever be touched by one thread.  Sorting by M2MObject, rather
+    // than searching for each, keeps this quick with thousands of groups
+    work.groupMembers = new int[_numObjects];
+    work.groupStart = new int[_numObjects + 1];
+    work.numGroups = 0;
+    work.nextGroup = 0;
+    work.mutex = NULL;
+    keys = new GroupKey[_numObjects];
+    groups = new GroupKey[_numObjects];
+    building = new bool[_numObjects];
+    for (int x = 0; x < _numObjects; x++) {
+        // Only objects that have been begun and are not complete
+        object = _objects[_order[x]];
+        building[x] = (x >= _next) && (object->_objectInstance != NULL) &&
+                      (object->_numResourcesMade < object->_defObject->numResources);
+        if (building[x]) {
+            keys[numKeys].parent = object->getObject();
+            keys[numKeys].position = x;
+            numKeys++;
+        }
+    }
+    qsort(keys, numKeys, sizeof(GroupKey), compareGroupKeys);
+    for (int x = 0; x < numKeys; x++) {
+        // Objects without an M2MObject can't share one
+        if ((x == 0) || (keys[x].parent != keys[x - 1].parent) || (keys[x].parent == NULL)) {
+            groups[work.numGroups].parent = keys[x].parent;
+            groups[work.numGroups].position = keys[x].position;
+            groups[work.numGroups].start = x;
+            groups[work.numGroups].length = 0;
+            work.numGroups++;
+        }
+        groups[work.numGroups - 1].length++;
+    }
+    // Back into build order, by the first object of each group
+    qsort(groups, work.numGroups, sizeof(GroupKey), compareGroupPositions);
+    for (int x = 0; x < work.numGroups; x++) {
+        work.groupStart[x] = numGroupMembers;
+        for (int y = groups[x].start; y < groups[x].start + groups[x].length; y++) {
+            work.groupMembers[numGroupMembers] = _order[keys[y].position];
+            numGroupMembers++;
+        }
+    }
+    delete[] keys;
+    delete[] groups;
+    work.groupStart[work.numGroups] = numGroupMembers;
+
+    if (numThreads > work.numGroups) {
+        numThreads = work.numGroups;
+    }
+    if (M2MObjectHelper::_startupProfile != NULL) {
+        numThreads = 1;
+    }
+    printfLog("M2MObjectBuilder: building %d object(s) in %d group(s) on %d thread(s).\n",
+              numGroupMembers, work.numGroups, numThreads);
+
+    _work = &work;
+#if OBJECT_BUILDER_THREADS
+    if (numThreads > 1) {
+        threads = new pthread_t[numThreads - 1];
+        if (pthread_mutex_init(&mutex, NULL) == 0) {
+            if (pthread_mutex_init(&mbedClientMutex, NULL) == 0) {
+                work.mutex = &mutex;
+                _mbedClientMutex = &mbedClientMutex;
+                for (; numStarted < numThreads - 1; numStarted++) {
+                    if (pthread_create(&(threads[numStarted]), NULL, threadMain, this) != 0) {
+                        printfLog("M2MObjectBuilder: only able to start %d thread(s).\n", numStarted);
+                        break;
+                    }
+                }
+            } else {
+                pthread_mutex_destroy(&mutex);
+            }
+        }
+        // The calling thread works too
+        buildGroups(&work);
+        for (int x = 0; x < numStarted; x++) {
+            pthread_join(threads[x], NULL);
+        }
+        if (work.mutex != NULL) {
+            pthread_mutex_destroy(&mutex);
+            pthread_mutex_destroy((pthread_mutex_t *) _mbedClientMutex);
+            work.mutex = NULL;
+            _mbedClientMutex = NULL;
+        }
+        delete[] threads;
+    }
+#endif
+    // Whatever is left, e.g. if there are no threads
+    buildGroups(&work);
+    _work = NULL;
+
+    // Merge: back on the calling thread, tell the objects
+    // that they are made, in the usual order
+    for (; _next < _numObjects; _next++) {
+        object = _objects[_order[_next]];
+        if (building[_next]) {
+            object->startStaleTimers();
+            object->objectMade();
+        }
+        numFailed += object->_numResourcesFailed;
+    }
+    delete[] building;
+
+    elapsed = us_ticker_read() - start;
+    _numSteps++;
+    _stepUsTotal += elapsed;
+    if (elapsed > _stepUsMax) {
+        _stepUsMax = elapsed;
+    }
+    if (_criticalReadyUs == 0) {
+        _criticalReadyUs = (us_ticker_read() - _startTime) | 1;
+    }
+    if (_allReadyUs == 0) {
+        _allReadyUs = (us_ticker_read() - _startTime) | 1;
+    }
+    printfLog("M2MObjectBuilder: %d object(s) ready after %u us on %d thread(s).\n",
+              _numObjects, (unsigned int) elapsed, numStarted + 1);
+
+    delete[] work.groupMembers;
+    delete[] work.groupStart;
+
+    return numFailed == 0;
+}
+
+// Get the progress of building the set.
+void M2MObjectBuilder::getProgress(Progress *progress)
+{
+    int numFailed;
+
+    memset(progress, 0, sizeof(*progress));
+    progress->numObjects = _numObjects;
+    progress->numObjectsMade = _next;
+    for (int x = 0; x < _numObjects; x++) {
+        progress->numResources += _objects[x]->getNumResources();
+        progress->numResourcesMade += _objects[x]->getNumResourcesMade(&numFailed);
+        progress->numResourcesFailed += numFailed;
+    }
+    progress->numSteps = _numSteps;
+    progress->stepUsMax = _stepUsMax;
+    progress->stepUsTotal = _stepUsTotal;
+    progress->criticalReadyUs = _criticalReadyUs;
+    progress->allReadyUs = _allReadyUs;
+    progress->firstRegistrationUs = _firstRegistrationUs;
+    progress->fullRegistrationUs = _fullRegistrationUs;
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Build groups of objects until there are none left.
+void M2MObjectBuilder::buildGroups(ParallelWork *work)
+{
+    M2MObjectHelper *object;
+    int group;
+
+    for (;;) {
+#if OBJECT_BUILDER_THREADS
+        if (work->mutex != NULL) {
+            pthread_mutex_lock((pthread_mutex_t *) work->mutex);
+        }
+#endif
+        group = work->nextGroup;
+        if (group < work->numGroups) {
+            work->nextGroup++;
+        }
+#if OBJECT_BUILDER_THREADS
+        if (work->mutex != NULL) {
+            pthread_mutex_unlock((pthread_mutex_t *) work->mutex);
+        }
+#endif
+        if (group >= work->numGroups) {
+            break;
+        }
+        for (int x = work->groupStart[group]; x < work->groupStart[group + 1]; x++) {
+            object = _objects[work->groupMembers[x]];
+            if (object->_objectInstance != NULL) {
+                for (; object->_numResourcesMade < object->_defObject->numResources; object->_numResourcesMade++) {
+                    object->makeResource(object->_numResourcesMade);
+                }
+            }
+        }
+    }
+}
+
+// The entry point of a thread of buildInParallel().
+void *M2MObjectBuilder::threadMain(void *context)
+{
+    M2MObjectBuilder *builder = (M2MObjectBuilder *) context;
+
+    builder->buildGroups(builder->_work);
+
+    return NULL;
+}
+
+// Compare two GroupKeys by M2MObject and then by position.
+int M2MObjectBuilder::compareGroupKeys(const void *a, const void *b)
+{
+    const GroupKey *keyA = (const GroupKey *) a;
+    const GroupKey *keyB = (const GroupKey *) b;
+
+    if (keyA->parent != keyB->parent) {
+        return ((uintptr_t) keyA->parent < (uintptr_t) keyB->parent) ? -1 : 1;
+    }
+
+    return keyA->position - keyB->position;
+}
+
+// Compare two GroupKeys by position.
+int M2MObjectBuilder::compareGroupPositions(const void *a, const void *b)
+{
+    return ((const GroupKey *) a)->position - ((const GroupKey *) b)->position;
+}
+
+// Lock Mbed Client while buildInParallel() has threads running.
+void M2MObjectBuilder::lockMbedClient()
+{
+#if OBJECT_BUILDER_THREADS
+    if (_mbedClientMutex != NULL) {
+        pthread_mutex_lock((pthread_mutex_t *) _mbedClientMutex);
+    }
+#endif
+}
+
+// Unlock Mbed Client.
+void M2MObjectBuilder::unlockMbedClient()
+{
+#if OBJECT_BUILDER_THREADS
+    if (_mbedClientMutex != NULL) {
+        pthread_mutex_unlock((pthread_mutex_t *) _mbedClientMutex);
+    }
+#endif
+}
+
+// End of file
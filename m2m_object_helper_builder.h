@@ -0,0 +1,352 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_BUILDER_
+#define _M2M_OBJECT_HELPER_BUILDER_
+
+/** This class finishes making a set of objects, begun with
+ * M2MObjectHelper::beginMakeObject(), in slices of bounded length, so
+ * that the application can do it from its main loop without tripping
+ * a watchdog or holding up anything time-critical.
+ *
+ * OVERVIEW
+ *
+ * Construct your objects (each of which calls beginMakeObject() rather
+ * than makeObject()), put pointers to them in an array and give it to
+ * a builder.  Then call step() from the main loop, kicking the watchdog
+ * in between, until it returns 0, e.g.:
+ *
+ * M2MObjectHelper *objects[] = {device, temperature, ...};
+ * M2MObjectBuilder builder(objects, sizeof(objects) / sizeof(objects[0]));
+ *
+ * while (builder.step(0, 2000) > 0) {
+ *     watchdog.kick();
+ *     doTimeCriticalThings();
+ * }
+ * ...register the objects with Mbed Client.
+ *
+ * Each step creates resources, in order of the start-up priority of the
+ * objects (see M2MObjectHelper::setStartupPriority()) and then in the
+ * order of the array, until the
+ * given number of resources have been created or the given time has
+ * passed, but always at least one resource so that building does
+ * progress.  A step can overrun its time by the time taken to create
+ * one resource.  Objects already made with makeObject() may be
+ * included and are simply counted as made.  getProgress() says how far
+ * building has got, e.g. for a boot progress indication, and the
+ * longest step taken.
+ *
+ * To register quickly with the objects that matter, hand the objects
+ * to Mbed Client as they become ready rather than waiting for the lot:
+ * getReadyObjects() adds to a list those objects which are complete and
+ * have not been handed out before, and isReady(true) says when all of
+ * the critical ones (those with STARTUP_PRIORITY_CRITICAL or lower) are
+ * complete, e.g.:
+ *
+ * while (!builder.isReady(true)) {
+ *     builder.step(0, 2000);
+ *     ...
+ * }
+ * builder.getReadyObjects(&objectList);
+ * cloudClient.add_objects(objectList);
+ * cloudClient.setup(...);
+ * ...then, while registered, carry on with step() and, from time to
+ * time, call getReadyObjects() and, if it returns non-zero, add the
+ * list and call cloudClient.register_update().
+ *
+ * Call registered() from the registered and registration-updated
+ * callbacks of Mbed Client so that getProgress() can report the time to
+ * first registration and the time to full registration (i.e. with
+ * every object) as part of the start-up profile.
+ *
+ * BUILDING IN PARALLEL
+ *
+ * On a multi-core Linux gateway (OBJECT_BUILDER_THREADS, which is on
+ * by default on Linux) thousands of objects can instead be finished in
+ * one go on a pool of threads with buildInParallel().  Objects which
+ * share an M2MObject (i.e. instances of the same object) are always
+ * built by the same thread, one after another; only objects with
+ * different M2MObjects, e.g. different object IDs or different devices,
+ * are built in parallel.  Mbed Client makes no promise that it is safe
+ * to create resources in different objects at once, so the call that
+ * creates each resource is made under one lock; setting the callbacks
+ * of the new resource, which no other thread can reach, and the
+ * helper's own work run in parallel.  How much that gains depends on
+ * how the time to make a resource divides between the two, which
+ * tools/bench/parallel_build.cpp measures.  Once the threads
+ * are done the results are merged on the calling thread: objectMade()
+ * is called for each object in the usual order and all objects are
+ * then ready.  The objects must have been begun with beginMakeObject(),
+ * which is not itself thread-safe, and nothing else may touch them, or
+ * Mbed Client, while buildInParallel() runs.  A start-up profile, which
+ * is not thread-safe, makes buildInParallel() use just the calling
+ * thread.
+ *
+ * The array must remain while the builder exists.
+ */
+class M2MObjectBuilder {
+public:
+
+    /** Set to 1 to allow buildInParallel() to use
+     * threads, 0 for it to build everything on the
+     * calling thread; by default 1 on Linux.
+     */
+#   ifndef OBJECT_BUILDER_THREADS
+#   ifdef __linux__
+#   define OBJECT_BUILDER_THREADS 1
+#   else
+#   define OBJECT_BUILDER_THREADS 0
+#   endif
+#   endif
+
+    /** Structure to report progress.
+     */
+    typedef struct {
+        int numObjects;           ///< objects in the set.
+        int numObjectsMade;       ///< of those, how many are complete.
+        int numResources;         ///< resources in the set.
+        int numResourcesMade;     ///< of those, how many have been created
+                                  /// (or attempted).
+        int numResourcesFailed;   ///< of those, how many could not be
+                                  /// created.
+        uint32_t numSteps;        ///< calls to step() that did something.
+        uint32_t stepUsMax;       ///< the longest of those.
+        uint64_t stepUsTotal;     ///< the total time taken by them.
+        uint32_t criticalReadyUs; ///< the time from the construction of
+                                  /// the builder until the critical
+                                  /// objects were complete, 0 if not yet.
+        uint32_t allReadyUs;      ///< the same until all objects were
+                                  /// complete, 0 if not yet.
+        uint32_t firstRegistrationUs; ///< the same until registered() was
+                                      /// first called, 0 if not yet.
+        uint32_t fullRegistrationUs;  ///< the same until registered() was
+                                      /// first called after every object
+                                      /// had been handed out, 0 if not yet.
+    } Progress;
+
+    /** Constructor: the start-up profile is timed from
+     * here.
+     *
+     * @param objects     the objects to build.
+     * @param numObjects  the number of entries in objects.
+     * @param debugOn     true to switch debug prints on,
+     *                    otherwise false.
+     */
+    M2MObjectBuilder(M2MObjectHelper * const *objects,
+                     int numObjects,
+                     bool debugOn = false);
+
+    /** Destructor.
+     */
+    ~M2MObjectBuilder();
+
+    /** Create the next few resources of the set.
+     *
+     * @param maxResources     the most resources to create,
+     *                         0 for no limit.
+     * @param maxMicroseconds  the time after which to stop
+     *                         creating resources, 0 for no
+     *                         limit.
+     * @return                 the number of resources still to
+     *                         be created, 0 when the set is
+     *                         ready to be registered.
+     */
+    int step(int maxResources, uint32_t maxMicroseconds);
+
+    /** Determine whether all of the objects, or all of
+     * the critical objects, are complete.
+     *
+     * @param criticalOnly  true to consider only the objects
+     *                      with STARTUP_PRIORITY_CRITICAL or
+     *                      lower.
+     * @return              true if they are ready to be
+     *                      registered, otherwise false.
+     */
+    bool isReady(bool criticalOnly = false);
+
+    /** Add to a list the objects that are complete and
+     * have not been added by a previous call, each
+     * M2MObject (which several instances may share)
+     * being added only once.
+     *
+     * @param list  the list to add to.
+     * @return      the number of objects that have become
+     *              ready since the last call, which may be
+     *              more than the number added to the list
+     *              where instances share an M2MObject; if
+     *              it is not zero a registration update is
+     *              needed.
+     */
+    int getReadyObjects(M2MObjectList *list);
+
+    /** Tell the builder that registration, or a
+     * registration update, has completed.
+     */
+    void registered();
+
+    /** Finish building the set on a pool of threads,
+     * returning when it is complete; see BUILDING IN
+     * PARALLEL.
+     *
+     * @param numThreads  the number of threads to use, which
+     *                    should be no more than the number of
+     *                    cores.
+     * @return            true if every resource was created,
+     *                    otherwise false.
+     */
+    bool buildInParallel(int numThreads);
+
+    /** Get the progress of building the set.
+     *
+     * @param progress  pointer to a place to put the progress.
+     */
+    void getProgress(Progress *progress);
+
+protected:
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The objects.
+     */
+    M2MObjectHelper * const *_objects;
+
+    /** The number of objects.
+     */
+    int _numObjects;
+
+    /** The order in which to build the objects, as
+     * indexes into _objects.
+     */
+    int *_order;
+
+    /** The number of critical objects, which are the
+     * first in _order.
+     */
+    int _numCritical;
+
+    /** The position in _order of the first object that
+     * is not yet complete.
+     */
+    int _next;
+
+    /** The position in _order of the first object not
+     * yet handed out by getReadyObjects().
+     */
+    int _nextReady;
+
+    /** When the builder was constructed.
+     */
+    uint32_t _startTime;
+
+    /** The times of the start-up profile.
+     */
+    uint32_t _criticalReadyUs;
+    uint32_t _allReadyUs;
+    uint32_t _firstRegistrationUs;
+    uint32_t _fullRegistrationUs;
+
+    /** The work shared by the threads of buildInParallel():
+     * groups of objects sharing an M2MObject, as ranges of
+     * _groupMembers (indexes into _objects), and the next
+     * group to be taken.
+     */
+    typedef struct {
+        int *groupMembers;
+        int *groupStart;
+        int numGroups;
+        int nextGroup;
+        void *mutex;
+    } ParallelWork;
+
+    /** An object to be built by buildInParallel(), or a
+     * group of them, while grouping objects by M2MObject.
+     */
+    typedef struct {
+        M2MObject *parent;  ///< the M2MObject of the object.
+        int position;       ///< the position of the object, or of
+                            /// the first in the group, in _order.
+        int start;          ///< for a group, where its objects start.
+        int length;         ///< for a group, how many objects it has.
+    } GroupKey;
+
+    /** Compare two GroupKeys by M2MObject and then by
+     * position, for qsort().
+     *
+     * @param a  pointer to the first GroupKey.
+     * @param b  pointer to the second GroupKey.
+     * @return   less than, equal to or greater than zero.
+     */
+    static int compareGroupKeys(const void *a, const void *b);
+
+    /** Compare two GroupKeys by position, for qsort().
+     *
+     * @param a  pointer to the first GroupKey.
+     * @param b  pointer to the second GroupKey.
+     * @return   less than, equal to or greater than zero.
+     */
+    static int compareGroupPositions(const void *a, const void *b);
+
+    /** Build groups of objects until there are none left.
+     *
+     * @param work  the work.
+     */
+    void buildGroups(ParallelWork *work);
+
+    /** The entry point of a thread of buildInParallel().
+     *
+     * @param context  the builder.
+     * @return         NULL.
+     */
+    static void *threadMain(void *context);
+
+    /** Lock Mbed Client around the creation of a resource
+     * while buildInParallel() has threads running, since
+     * Mbed Client makes no promise that creating resources
+     * in different objects at once is safe; does nothing
+     * otherwise.
+     */
+    static void lockMbedClient();
+
+    /** Unlock Mbed Client, see lockMbedClient().
+     */
+    static void unlockMbedClient();
+
+    /** The lock taken by lockMbedClient(), NULL when
+     * buildInParallel() has no threads running.
+     */
+    static void *_mbedClientMutex;
+
+    /** So that the helper can lock Mbed Client.
+     */
+    friend class M2MObjectHelper;
+
+    /** The work of buildInParallel(), NULL when not
+     * running.
+     */
+    ParallelWork *_work;
+
+    /** The statistics of the steps.
+     */
+    uint32_t _numSteps;
+    uint32_t _stepUsMax;
+    uint64_t _stepUsTotal;
+};
+
+#endif // _M2M_OBJECT_HELPER_BUILDER_
+
+// End of file
@@ -0,0 +1,147 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_changes.h"
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+// Each field of a change is copied atomically, but on its own, so that a
+// reader racing with a writer sees no torn fields; the sequence number of
+// the slot, checked before and after, says whether the whole is good.
+#define loadRelaxed(pointer) __atomic_load_n(pointer, __ATOMIC_RELAXED)
+#define storeRelaxed(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELAXED)
+
+/**********************************************************************
+ * STATIC FUNCTIONS
+ **********************************************************************/
+
+// Copy a change into or out of a slot.
+static void copyChange(M2MChangeRing::Change *to, const M2MChangeRing::Change *from)
+{
+    storeRelaxed(&(to->object), loadRelaxed(&(from->object)));
+    storeRelaxed(&(to->objectName), loadRelaxed(&(from->objectName)));
+    storeRelaxed(&(to->objectInstance), loadRelaxed(&(from->objectInstance)));
+    storeRelaxed(&(to->resourceName), loadRelaxed(&(from->resourceName)));
+    storeRelaxed(&(to->resourceInstance), loadRelaxed(&(from->resourceInstance)));
+    storeRelaxed(&(to->version), loadRelaxed(&(from->version)));
+}
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MChangeRing::M2MChangeRing(int size, bool debugOn)
+{
+    uint32_t numSlots = 1;
+
+    _debugOn = debugOn;
+    while ((int) numSlots < size) {
+        numSlots <<= 1;
+    }
+    _slots = new Slot[numSlots];
+    memset(_slots, 0, numSlots * sizeof(Slot));
+    _mask = numSlots - 1;
+    _head = 0;
+    _numOverruns = 0;
+    printfLog("M2MChangeRing: holding %d change(s).\n", (int) numSlots);
+}
+
+// Destructor.
+M2MChangeRing::~M2MChangeRing()
+{
+    delete[] _slots;
+}
+
+// Record a change.
+void M2MChangeRing::record(const Change *change)
+{
+    uint32_t position = __atomic_fetch_add(&_head, 1, __ATOMIC_RELAXED);
+    Slot *slot = &(_slots[position & _mask]);
+
+    // Mark the slot as being written, write it, then mark it as
+    // holding this position
+    storeRelaxed(&(slot->sequence), position);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    copyChange(&(slot->change), change);
+    __atomic_store_n(&(slot->sequence), position + 1, __ATOMIC_RELEASE);
+}
+
+// Get a cursor to read changes recorded from now on.
+uint32_t M2MChangeRing::getCursor()
+{
+    return __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+}
+
+// Read the changes recorded since a cursor.
+int M2MChangeRing::read(uint32_t *cursor, Change *changes, int maxChanges)
+{
+    int numChanges = 0;
+    uint32_t position = *cursor;
+    uint32_t head;
+    uint32_t sequence;
+    const Slot *slot;
+
+    while (numChanges < maxChanges) {
+        head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+        if (head - position > _mask + 1) {
+            break;
+        }
+        slot = &(_slots[position & _mask]);
+        sequence = __atomic_load_n(&(slot->sequence), __ATOMIC_ACQUIRE);
+        if ((int32_t) (sequence - (position + 1)) < 0) {
+            // Not recorded yet (or still being written)
+            *cursor = position;
+            return numChanges;
+        }
+        if (sequence == position + 1) {
+            copyChange(&(changes[numChanges]), &(slot->change));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (loadRelaxed(&(slot->sequence)) == sequence) {
+                numChanges++;
+                position++;
+                continue;
+            }
+        }
+        // Overwritten before it could be read
+        break;
+    }
+
+    if (numChanges == maxChanges) {
+        *cursor = position;
+        return numChanges;
+    }
+
+    // Fallen too far behind: start again from now
+    __atomic_fetch_add(&_numOverruns, 1, __ATOMIC_RELAXED);
+    *cursor = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    printfLog("M2MChangeRing: reader overrun, changes missed.\n");
+
+    return CHANGE_RING_OVERRUN;
+}
+
+// Get the statistics of the ring.
+void M2MChangeRing::getStats(Stats *stats)
+{
+    stats->numRecorded = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    stats->numOverruns = __atomic_load_n(&_numOverruns, __ATOMIC_RELAXED);
+    stats->size = _mask + 1;
+}
+
+// End of file
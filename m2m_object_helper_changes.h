@@ -0,0 +1,166 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_CHANGES_
+#define _M2M_OBJECT_HELPER_CHANGES_
+
+/** This class records, in a ring of fixed size, each change to the
+ * value of a resource of any object made with M2MObjectHelper, so
+ * that any number of consumers can find out what has changed without
+ * polling every resource.
+ *
+ * OVERVIEW
+ *
+ * Create a ring and give it to the helper, for all objects, with
+ * M2MObjectHelper::setChangeRing().  Each real change to a value (see
+ * M2MObjectHelper::getVersion()) is then recorded as the object, its
+ * instance, the resource, its instance and the new version; the value
+ * itself is not recorded, read it from the object.  Creating an object
+ * is not recorded as a change.
+ *
+ * A consumer keeps a cursor, starting from getCursor(), and pulls
+ * everything recorded since with read():
+ *
+ * uint32_t cursor = ring->getCursor();
+ * ...
+ * while ((n = ring->read(&cursor, changes, 32)) != 0) {
+ *     if (n < 0) {
+ *         // Overrun: read everything again
+ *         ...
+ *     }
+ *     ...
+ *
+ * A consumer which falls more than the size of the ring behind has
+ * missed changes: read() then says so by returning CHANGE_RING_OVERRUN
+ * and moves the cursor up to date, and the consumer should read all of
+ * the values it is interested in again (getVersion() makes that cheap
+ * for objects that have not changed).
+ *
+ * Recording and reading take no locks: a change may be recorded from
+ * any thread and read() may be called from any number of threads, each
+ * with its own cursor.  The ring must outlive its use by the helper.
+ * The object pointer in a change is there to tell objects apart, the
+ * object may have been deleted since.
+ */
+class M2MChangeRing {
+public:
+
+    /** What read() returns if the consumer has fallen
+     * so far behind that changes have been overwritten.
+     */
+#   define CHANGE_RING_OVERRUN -1
+
+    /** Structure to hold a change.
+     */
+    typedef struct {
+        M2MObjectHelper *object;  ///< the object.
+        const char *objectName;   ///< the object name, e.g. "3303".
+        int objectInstance;       ///< the object instance.
+        const char *resourceName; ///< the resource name, e.g. "5700".
+        int resourceInstance;     ///< the resource instance, -1 if there
+                                  /// is only a single instance.
+        uint32_t version;         ///< the version of the object after the
+                                  /// change, see getResourceVersion().
+    } Change;
+
+    /** Structure to report how the ring is doing.
+     */
+    typedef struct {
+        uint32_t numRecorded;     ///< changes recorded.
+        uint32_t numOverruns;     ///< reads that found changes overwritten.
+        int size;                 ///< the number of changes the ring holds.
+    } Stats;
+
+    /** Constructor.
+     *
+     * @param size     the number of changes to hold, rounded
+     *                 up to a power of two.
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MChangeRing(int size, bool debugOn = false);
+
+    /** Destructor.
+     */
+    ~M2MChangeRing();
+
+    /** Record a change, called by M2MObjectHelper.
+     *
+     * @param change  the change.
+     */
+    void record(const Change *change);
+
+    /** Get a cursor to read changes recorded from now on.
+     *
+     * @return  the cursor.
+     */
+    uint32_t getCursor();
+
+    /** Read the changes recorded since a cursor.
+     *
+     * @param cursor      pointer to the cursor, which is
+     *                    moved past the changes read.
+     * @param changes     a place to put the changes.
+     * @param maxChanges  the number of entries in changes.
+     * @return            the number of changes read, 0 if
+     *                    there are no more, or
+     *                    CHANGE_RING_OVERRUN if changes have
+     *                    been missed, in which case the
+     *                    cursor is moved up to date.
+     */
+    int read(uint32_t *cursor, Change *changes, int maxChanges);
+
+    /** Get the statistics of the ring.
+     *
+     * @param stats  pointer to a place to put the statistics.
+     */
+    void getStats(Stats *stats);
+
+protected:
+
+    /** Structure to hold a change in the ring.
+     */
+    typedef struct {
+        uint32_t sequence;        ///< one more than the position of the
+                                  /// change held, the position itself
+                                  /// while it is being written.
+        Change change;            ///< the change.
+    } Slot;
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The slots.
+     */
+    Slot *_slots;
+
+    /** The number of slots less one, a mask.
+     */
+    uint32_t _mask;
+
+    /** The position of the next change to be recorded.
+     */
+    uint32_t _head;
+
+    /** The number of overruns.
+     */
+    uint32_t _numOverruns;
+};
+
+#endif // _M2M_OBJECT_HELPER_CHANGES_
+
+// End of file
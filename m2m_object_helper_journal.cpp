@@ -0,0 +1,528 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "m2m_object_helper_journal.h"
+
+#if JOURNAL_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/** The longest record header, i.e. everything before the value.
+ */
+#define JOURNAL_MAX_HEADER_LENGTH 64
+
+/** The user data of an operation is the index of its batch,
+ * shifted up by one, with this bit set if it is a sync.
+ */
+#define JOURNAL_USER_DATA_SYNC 1
+
+/** The batch index used for a sync submitted on its own.
+ */
+#define JOURNAL_NO_BATCH JOURNAL_MAX_IN_FLIGHT
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MObjectJournal::M2MObjectJournal(const char *path, bool debugOn)
+{
+    _debugOn = debugOn;
+    _path = path;
+    _file = NULL;
+    for (int x = 0; x < JOURNAL_MAX_IN_FLIGHT; x++) {
+        _batches[x].data = NULL;
+        _batches[x].length = 0;
+        _batches[x].numPending = 0;
+        _batches[x].submitTime = 0;
+        _batches[x].failed = false;
+    }
+    _storage = NULL;
+    _current = NULL;
+    _unsynced = false;
+    _numSyncsPending = 0;
+    _syncSubmitTime = 0;
+    memset(&_stats, 0, sizeof(_stats));
+    _numFailedReported = 0;
+#if JOURNAL_IO_URING
+    _fd = -1;
+    _fileOffset = 0;
+    _ringFd = -1;
+    _sqRing = NULL;
+    _cqRing = NULL;
+    _sqes = NULL;
+#endif
+}
+
+// Destructor.
+M2MObjectJournal::~M2MObjectJournal()
+{
+    if (_storage != NULL) {
+        flush(true);
+        wait();
+    }
+#if JOURNAL_IO_URING
+    closeRing();
+    if (_fd >= 0) {
+        close(_fd);
+    }
+#endif
+    if (_file != NULL) {
+        fclose(_file);
+    }
+    delete[] _storage;
+}
+
+// Open the journal file.
+bool M2MObjectJournal::open()
+{
+    int numBatches = 1;
+
+    if (_storage != NULL) {
+        return true;
+    }
+
+#if JOURNAL_IO_URING
+    struct stat status;
+
+    _fd = ::open(_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if ((_fd >= 0) && (fstat(_fd, &status) == 0) && openRing()) {
+        _fileOffset = status.st_size;
+        _stats.async = true;
+        numBatches = JOURNAL_MAX_IN_FLIGHT;
+    } else if (_fd >= 0) {
+        printfLog("M2MObjectJournal: io_uring not available, using stdio.\n");
+        close(_fd);
+        _fd = -1;
+    }
+#endif
+
+    if (!_stats.async) {
+        _file = fopen(_path, "ab");
+        if (_file == NULL) {
+            printfLog("M2MObjectJournal: unable to open \"%s\".\n", _path);
+            return false;
+        }
+    }
+
+    _storage = new char[numBatches * JOURNAL_BATCH_SIZE];
+    if (_storage != NULL) {
+        for (int x = 0; x < numBatches; x++) {
+            _batches[x].data = _storage + (x * JOURNAL_BATCH_SIZE);
+        }
+        printfLog("M2MObjectJournal: opened \"%s\" (%s).\n", _path, _stats.async ? "io_uring" : "stdio");
+    }
+
+    return (_storage != NULL);
+}
+
+// Append a record to the journal.
+bool M2MObjectJournal::append(const char *objectName, int objectInstance,
+                              const char *resourceName, int resourceInstance,
+                              const char *value, unsigned int length)
+{
+    char header[JOURNAL_MAX_HEADER_LENGTH];
+    int headerLength;
+    unsigned int recordLength;
+    Batch *batch;
+
+    if (_storage == NULL) {
+        return false;
+    }
+
+    headerLength = snprintf(header, sizeof(header), "%s/%d/%s/%d %u\n",
+                            objectName, objectInstance, resourceName, resourceInstance, length);
+    recordLength = headerLength + length + 1;
+    if ((headerLength >= (int) sizeof(header)) || (recordLength > JOURNAL_BATCH_SIZE)) {
+        printfLog("M2MObjectJournal: record for %s/%d/%s/%d too long (%u byte(s)).\n",
+                  objectName, objectInstance, resourceName, resourceInstance, recordLength);
+        return false;
+    }
+
+    batch = getBatch();
+    if ((batch != NULL) && (batch->length + recordLength > JOURNAL_BATCH_SIZE)) {
+        // Full, send it on its way and start another
+        submit(batch, false);
+        batch = getBatch();
+    }
+    if (batch == NULL) {
+        return false;
+    }
+
+    memcpy(batch->data + batch->length, header, headerLength);
+    memcpy(batch->data + batch->length + headerLength, value, length);
+    batch->data[batch->length + recordLength - 1] = '\n';
+    batch->length += recordLength;
+    _stats.numRecords++;
+
+    return true;
+}
+
+// Write out whatever records have been appended.
+bool M2MObjectJournal::flush(bool sync)
+{
+    bool success = true;
+
+    if (_storage == NULL) {
+        return false;
+    }
+
+    if ((_current != NULL) && (_current->length > 0)) {
+        success = submit(_current, sync);
+    } else if (sync && _unsynced) {
+        success = submit(NULL, true);
+    }
+
+    return success;
+}
+
+// Wait for everything outstanding to complete.
+bool M2MObjectJournal::wait()
+{
+    bool success;
+    bool pending = true;
+
+    while (pending) {
+        pending = (_numSyncsPending > 0);
+        for (int x = 0; (x < JOURNAL_MAX_IN_FLIGHT) && !pending; x++) {
+            pending = (_batches[x].numPending > 0);
+        }
+        if (pending) {
+            reap(true);
+        }
+    }
+
+    success = (_stats.numFailed == _numFailedReported);
+    _numFailedReported = _stats.numFailed;
+
+    return success;
+}
+
+// Get the statistics of the journal.
+void M2MObjectJournal::getStats(Stats *stats)
+{
+    if (_stats.async) {
+        reap(false);
+    }
+    *stats = _stats;
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Get a batch that is free for appending to.
+M2MObjectJournal::Batch *M2MObjectJournal::getBatch()
+{
+    if ((_current == NULL) && !_stats.async) {
+        _current = &(_batches[0]);
+    }
+
+    // With io_uring, wait for a batch to come free
+    // if they are all in flight
+    for (int y = 0; _current == NULL; y++) {
+        for (int x = 0; (x < JOURNAL_MAX_IN_FLIGHT) && (_current == NULL); x++) {
+            if (_batches[x].numPending == 0) {
+                _current = &(_batches[x]);
+            }
+        }
+        if (_current == NULL) {
+            reap(y > 0);
+        }
+    }
+
+    return _current;
+}
+
+// Submit a batch to be written.
+bool M2MObjectJournal::submit(Batch *batch, bool sync)
+{
+    bool success = false;
+    uint32_t start = us_ticker_read();
+
+    _stats.numSubmitted++;
+
+    if (!_stats.async) {
+        // Plain old blocking stdio
+        success = true;
+        if ((batch != NULL) &&
+            ((fwrite(batch->data, 1, batch->length, _file) != batch->length) || (fflush(_file) != 0))) {
+            success = false;
+        }
+#ifdef __linux__
+        if (success && sync && (fdatasync(fileno(_file)) != 0)) {
+            success = false;
+        }
+#endif
+        recordTime(start, &(_stats.submitUsMax), &(_stats.submitUsTotal));
+        recordTime(start, &(_stats.completeUsMax), &(_stats.completeUsTotal));
+        _stats.numCompleted++;
+        if (!success) {
+            _stats.numFailed++;
+            printfLog("M2MObjectJournal: unable to write to \"%s\".\n", _path);
+        }
+        _unsynced = !sync;
+        if (batch != NULL) {
+            batch->length = 0;
+        }
+        _current = NULL;
+        return success;
+    }
+
+#if JOURNAL_IO_URING
+    struct io_uring_sqe *sqe;
+    unsigned int tail = *_sqTail;
+    unsigned int numSqes = 0;
+    uint64_t userData = JOURNAL_NO_BATCH << 1;
+    unsigned int numSubmitted = 0;
+    int submitted;
+
+    if (batch != NULL) {
+        // Batches are written at explicit offsets, so any
+        // number may be in flight without getting mixed up
+        userData = (batch - _batches) << 1;
+        sqe = &(_sqes[tail & _sqMask]);
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = _fd;
+        sqe->addr = (uint64_t) (uintptr_t) batch->data;
+        sqe->len = batch->length;
+        sqe->off = _fileOffset;
+        sqe->user_data = userData;
+        _sqArray[tail & _sqMask] = tail & _sqMask;
+        tail++;
+        numSqes++;
+        _fileOffset += batch->length;
+        batch->numPending = 1;
+        batch->submitTime = start;
+        batch->failed = false;
+        _unsynced = true;
+    }
+    if (sync) {
+        // Drain so that the sync covers every write before it
+        sqe = &(_sqes[tail & _sqMask]);
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = _fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->flags = IOSQE_IO_DRAIN;
+        sqe->user_data = userData | JOURNAL_USER_DATA_SYNC;
+        _sqArray[tail & _sqMask] = tail & _sqMask;
+        tail++;
+        numSqes++;
+        if (batch != NULL) {
+            batch->numPending++;
+        } else {
+            _numSyncsPending++;
+            _syncSubmitTime = start;
+        }
+        _unsynced = false;
+    }
+    __atomic_store_n(_sqTail, tail, __ATOMIC_RELEASE);
+
+    // Hand the lot to the kernel in one go
+    do {
+        submitted = syscall(__NR_io_uring_enter, _ringFd, numSqes - numSubmitted, 0, 0, NULL, 0);
+        if (submitted > 0) {
+            numSubmitted += submitted;
+        } else if ((submitted < 0) && ((errno == EAGAIN) || (errno == EBUSY))) {
+            reap(true);
+        }
+    } while ((numSubmitted < numSqes) &&
+             ((submitted > 0) || ((submitted < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY)))));
+    recordTime(start, &(_stats.submitUsMax), &(_stats.submitUsTotal));
+    success = (numSubmitted == numSqes);
+    if (!success) {
+        // The kernel won't take the rest: take them back out of the
+        // ring, as nothing would ever complete them, and count what
+        // they were for as failed
+        printfLog("M2MObjectJournal: io_uring submitted %u of %u operation(s) (%d).\n",
+                  numSubmitted, numSqes, (submitted < 0) ? errno : 0);
+        __atomic_store_n(_sqTail, tail - (numSqes - numSubmitted), __ATOMIC_RELEASE);
+        if (batch == NULL) {
+            _numSyncsPending--;
+            _stats.numCompleted++;
+            _stats.numFailed++;
+        } else {
+            if (numSubmitted == 0) {
+                // Not even the write went, so the next batch goes
+                // where this one would have
+                _fileOffset -= batch->length;
+                batch->numPending = 0;
+            } else {
+                // The write went but the sync didn't
+                batch->numPending--;
+            }
+            batch->failed = true;
+            if (batch->numPending == 0) {
+                _stats.numCompleted++;
+                _stats.numFailed++;
+                batch->length = 0;
+            }
+        }
+        if (sync) {
+            _unsynced = true;
+        }
+    }
+    _current = NULL;
+#endif
+
+    return success;
+}
+
+// Deal with completed operations.
+void M2MObjectJournal::reap(bool waitForOne)
+{
+#if JOURNAL_IO_URING
+    struct io_uring_cqe *cqe;
+    unsigned int head = *_cqHead;
+    unsigned int tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    unsigned int index;
+    bool isSync;
+    Batch *batch;
+
+    if (waitForOne && (head == tail)) {
+        while ((syscall(__NR_io_uring_enter, _ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) &&
+               (errno == EINTR)) {
+        }
+        tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    }
+
+    for (; head != tail; head++) {
+        cqe = &(_cqes[head & _cqMask]);
+        index = (unsigned int) (cqe->user_data >> 1);
+        isSync = ((cqe->user_data & JOURNAL_USER_DATA_SYNC) != 0);
+        if (index < JOURNAL_NO_BATCH) {
+            batch = &(_batches[index]);
+            if ((cqe->res < 0) || (!isSync && ((unsigned int) cqe->res != batch->length))) {
+                printfLog("M2MObjectJournal: %s of %u byte(s) failed (%d).\n",
+                          isSync ? "sync" : "write", batch->length, cqe->res);
+                batch->failed = true;
+            }
+            batch->numPending--;
+            if (batch->numPending == 0) {
+                recordTime(batch->submitTime, &(_stats.completeUsMax), &(_stats.completeUsTotal));
+                _stats.numCompleted++;
+                if (batch->failed) {
+                    _stats.numFailed++;
+                }
+                batch->length = 0;
+            }
+        } else {
+            if (cqe->res < 0) {
+                printfLog("M2MObjectJournal: sync failed (%d).\n", cqe->res);
+                _stats.numFailed++;
+            }
+            recordTime(_syncSubmitTime, &(_stats.completeUsMax), &(_stats.completeUsTotal));
+            _stats.numCompleted++;
+            _numSyncsPending--;
+        }
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+#else
+    (void) waitForOne;
+#endif
+}
+
+// Record the time taken by an operation.
+void M2MObjectJournal::recordTime(uint32_t start, uint32_t *usMax, uint64_t *usTotal)
+{
+    uint32_t duration = us_ticker_read() - start;
+
+    if (duration > *usMax) {
+        *usMax = duration;
+    }
+    *usTotal += duration;
+}
+
+#if JOURNAL_IO_URING
+
+// Set up io_uring.
+bool M2MObjectJournal::openRing()
+{
+    struct io_uring_params params;
+    void *map;
+
+    memset(&params, 0, sizeof(params));
+    // A write and a sync for each batch, at most
+    _ringFd = syscall(__NR_io_uring_setup, JOURNAL_MAX_IN_FLIGHT * 2, &params);
+    if (_ringFd < 0) {
+        return false;
+    }
+
+    _sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(unsigned int));
+    _cqRingSize = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    map = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               _ringFd, IORING_OFF_SQ_RING);
+    _sqRing = (map != MAP_FAILED) ? map : NULL;
+    map = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               _ringFd, IORING_OFF_CQ_RING);
+    _cqRing = (map != MAP_FAILED) ? map : NULL;
+    map = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               _ringFd, IORING_OFF_SQES);
+    _sqes = (map != MAP_FAILED) ? (struct io_uring_sqe *) map : NULL;
+    if ((_sqRing == NULL) || (_cqRing == NULL) || (_sqes == NULL)) {
+        closeRing();
+        return false;
+    }
+
+    _sqTail = (unsigned int *) ((char *) _sqRing + params.sq_off.tail);
+    _sqMask = *(unsigned int *) ((char *) _sqRing + params.sq_off.ring_mask);
+    _sqArray = (unsigned int *) ((char *) _sqRing + params.sq_off.array);
+    _cqHead = (unsigned int *) ((char *) _cqRing + params.cq_off.head);
+    _cqTail = (unsigned int *) ((char *) _cqRing + params.cq_off.tail);
+    _cqMask = *(unsigned int *) ((char *) _cqRing + params.cq_off.ring_mask);
+    _cqes = (struct io_uring_cqe *) ((char *) _cqRing + params.cq_off.cqes);
+
+    return true;
+}
+
+// Tear down io_uring.
+void M2MObjectJournal::closeRing()
+{
+    if (_sqes != NULL) {
+        munmap(_sqes, _sqesSize);
+        _sqes = NULL;
+    }
+    if (_cqRing != NULL) {
+        munmap(_cqRing, _cqRingSize);
+        _cqRing = NULL;
+    }
+    if (_sqRing != NULL) {
+        munmap(_sqRing, _sqRingSize);
+        _sqRing = NULL;
+    }
+    if (_ringFd >= 0) {
+        close(_ringFd);
+        _ringFd = -1;
+    }
+}
+
+#endif
+
+// End of file
@@ -0,0 +1,306 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_JOURNAL_
+#define _M2M_OBJECT_HELPER_JOURNAL_
+
+/** This class keeps a journal, in a file, of the values written by
+ * the server to the resources of objects made with M2MObjectHelper.
+ *
+ * OVERVIEW
+ *
+ * Give a journal to as many objects as you like with
+ * M2MObjectHelper::setJournal(): each value the server writes to a
+ * resource (other than an OPAQUE one) is then appended to it as a
+ * record of the form:
+ *
+ * <object>/<object instance>/<resource>/<resource instance> <length>\n
+ * <value>\n
+ *
+ * ...where the value is as held by Mbed Client (i.e. text) and the
+ * resource instance is -1 for a single-instance resource.
+ *
+ * Records are gathered into batches of JOURNAL_BATCH_SIZE bytes and a
+ * batch is only written when it is full or when flush() is called, so
+ * a stream of small writes costs one write to the file per batch.
+ * Call flush() from wherever suits you, e.g. a periodic refresh; by
+ * default it also makes sure that everything written so far has
+ * reached storage.
+ *
+ * On Linux (JOURNAL_IO_URING, which is on there by default) batches
+ * and the syncs that follow them are handed to the kernel through
+ * io_uring: append() and flush() return without waiting for the
+ * storage, with up to JOURNAL_MAX_IN_FLIGHT batches outstanding; only
+ * when all of those are still outstanding does append() wait for one
+ * to complete.  If io_uring is not available, or elsewhere, batches
+ * are written with stdio and flush() waits.  getStats() reports how
+ * long submission and completion of each batch has taken.
+ *
+ * Delete the journal only after the objects using it; its destructor
+ * flushes it and waits for everything outstanding to complete.
+ */
+class M2MObjectJournal {
+public:
+
+    /** The number of bytes of records gathered
+     * before they are written to the file; a
+     * single record may not be longer than this.
+     */
+#   ifndef JOURNAL_BATCH_SIZE
+#   define JOURNAL_BATCH_SIZE 4096
+#   endif
+
+    /** The maximum number of batches that may
+     * be in the process of being written at
+     * any one time with io_uring.
+     */
+#   ifndef JOURNAL_MAX_IN_FLIGHT
+#   define JOURNAL_MAX_IN_FLIGHT 8
+#   endif
+
+    /** Set to 1 to write batches through io_uring,
+     * 0 to write them with stdio; by default 1 on
+     * Linux.
+     */
+#   ifndef JOURNAL_IO_URING
+#   ifdef __linux__
+#   define JOURNAL_IO_URING 1
+#   else
+#   define JOURNAL_IO_URING 0
+#   endif
+#   endif
+
+    /** Structure to report how the journal is doing.
+     */
+    typedef struct {
+        uint32_t numRecords;      ///< records appended.
+        uint32_t numSubmitted;    ///< batches (and syncs) submitted.
+        uint32_t numCompleted;    ///< batches (and syncs) completed.
+        uint32_t numFailed;       ///< of those, how many failed.
+        uint32_t submitUsMax;     ///< the longest time taken to submit.
+        uint64_t submitUsTotal;   ///< the total time taken to submit.
+        uint32_t completeUsMax;   ///< the longest time from submission
+                                  /// to completion.
+        uint64_t completeUsTotal; ///< the total time from submission to
+                                  /// completion.
+        bool async;               ///< true if io_uring is being used.
+    } Stats;
+
+    /** Constructor.
+     *
+     * @param path     the path of the journal file, which
+     *                 will be created if it does not exist
+     *                 and otherwise appended-to.
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MObjectJournal(const char *path, bool debugOn = false);
+
+    /** Destructor: flushes the journal and waits for
+     * everything outstanding to complete.
+     */
+    ~M2MObjectJournal();
+
+    /** Open the journal file.  This must be called
+     * before any of the other functions can be called.
+     *
+     * @return  true if successful, otherwise false.
+     */
+    bool open();
+
+    /** Append a record to the journal.
+     *
+     * @param objectName        the object name, e.g. "3312".
+     * @param objectInstance    the object instance.
+     * @param resourceName      the resource name, e.g. "5850".
+     * @param resourceInstance  the resource instance, -1 if
+     *                          there is only a single instance.
+     * @param value             the value, need not be NULL
+     *                          terminated.
+     * @param length            the length of value.
+     * @return                  true if successful, otherwise
+     *                          false.
+     */
+    bool append(const char *objectName, int objectInstance,
+                const char *resourceName, int resourceInstance,
+                const char *value, unsigned int length);
+
+    /** Write out whatever records have been appended.
+     * With io_uring this only submits the write, call
+     * wait() to be sure that it has been done.
+     *
+     * @param sync  true to also make sure that everything
+     *              written to the journal has reached
+     *              storage.
+     * @return      true if successful, otherwise false.
+     */
+    bool flush(bool sync = true);
+
+    /** Wait for everything outstanding to complete.
+     *
+     * @return  true if everything completed successfully,
+     *          otherwise false.
+     */
+    bool wait();
+
+    /** Get the statistics of the journal.
+     *
+     * @param stats  pointer to a place to put the statistics.
+     */
+    void getStats(Stats *stats);
+
+protected:
+
+    /** Structure to hold a batch of records.
+     */
+    typedef struct {
+        char *data;              ///< the records.
+        unsigned int length;     ///< the number of bytes at data.
+        int numPending;          ///< the number of operations on this
+                                 /// batch submitted but not completed.
+        uint32_t submitTime;     ///< when the batch was submitted.
+        bool failed;             ///< true if an operation on this batch
+                                 /// has failed.
+    } Batch;
+
+    /** Get a batch that is free for appending to,
+     * waiting for one to complete if necessary.
+     *
+     * @return  the batch, NULL on failure.
+     */
+    Batch *getBatch();
+
+    /** Submit a batch to be written.
+     *
+     * @param batch  the batch, NULL to submit just a sync.
+     * @param sync   true to follow it with a sync.
+     * @return       true if successful, otherwise false.
+     */
+    bool submit(Batch *batch, bool sync);
+
+    /** Deal with completed operations.
+     *
+     * @param waitForOne  true to wait for at least one
+     *                    operation to complete if none
+     *                    have.
+     */
+    void reap(bool waitForOne);
+
+    /** Record the time taken by an operation.
+     *
+     * @param start     when the operation started.
+     * @param usMax     the maximum to update.
+     * @param usTotal   the total to update.
+     */
+    void recordTime(uint32_t start, uint32_t *usMax, uint64_t *usTotal);
+
+#if JOURNAL_IO_URING
+    /** Set up io_uring.
+     *
+     * @return  true if successful, otherwise false.
+     */
+    bool openRing();
+
+    /** Tear down io_uring.
+     */
+    void closeRing();
+#endif
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The path of the journal file.
+     */
+    const char *_path;
+
+    /** The journal file when written with stdio.
+     */
+    FILE *_file;
+
+    /** The batches, only the first of which is used
+     * with stdio.
+     */
+    Batch _batches[JOURNAL_MAX_IN_FLIGHT];
+
+    /** The storage for the records of all of the batches.
+     */
+    char *_storage;
+
+    /** The batch being appended-to, NULL if none.
+     */
+    Batch *_current;
+
+    /** True if something has been written since the last sync.
+     */
+    bool _unsynced;
+
+    /** The number of syncs submitted on their own but
+     * not completed.
+     */
+    int _numSyncsPending;
+
+    /** When the last sync submitted on its own was submitted.
+     */
+    uint32_t _syncSubmitTime;
+
+    /** The statistics.
+     */
+    Stats _stats;
+
+    /** The value of _stats.numFailed when wait() last returned.
+     */
+    uint32_t _numFailedReported;
+
+#if JOURNAL_IO_URING
+    /** The journal file when written with io_uring, -1 if not.
+     */
+    int _fd;
+
+    /** The offset in the journal file at which the next
+     * batch will be written.
+     */
+    uint64_t _fileOffset;
+
+    /** The io_uring, -1 if not set up.
+     */
+    int _ringFd;
+
+    /** The mapped submission and completion queue rings
+     * and submission queue entries, and their sizes.
+     */
+    void *_sqRing;
+    size_t _sqRingSize;
+    void *_cqRing;
+    size_t _cqRingSize;
+    struct io_uring_sqe *_sqes;
+    size_t _sqesSize;
+
+    /** Pointers into the rings.
+     */
+    unsigned int *_sqTail;
+    unsigned int _sqMask;
+    unsigned int *_sqArray;
+    unsigned int *_cqHead;
+    unsigned int *_cqTail;
+    unsigned int _cqMask;
+    struct io_uring_cqe *_cqes;
+#endif
+};
+
+#endif // _M2M_OBJECT_HELPER_JOURNAL_
+
+// End of file
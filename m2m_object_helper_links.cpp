@@ -0,0 +1,231 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_links.h"
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MLinkPayload::M2MLinkPayload(bool debugOn)
+{
+    _debugOn = debugOn;
+    _entries = NULL;
+    _numEntries = 0;
+    _numEntriesAllocated = 0;
+    _payload = NULL;
+    _size = 0;
+    _sizeAllocated = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// Destructor.
+M2MLinkPayload::~M2MLinkPayload()
+{
+    free(_entries);
+    free(_payload);
+}
+
+// Add the fragment of an object to the payload.
+bool M2MLinkPayload::add(M2MObjectHelper *object)
+{
+    const char *fragment;
+    int length;
+    int position;
+    int offset;
+    int size;
+    uint32_t objectId;
+
+    fragment = object->getLinkFragment(&length);
+    if (fragment == NULL) {
+        printfLog("M2MLinkPayload: object \"%s\" has not been made.\n", object->_defObject->name);
+        return false;
+    }
+    objectId = strtoul(object->_defObject->name, NULL, 10);
+    position = findPosition(objectId, object->_instance);
+    if ((position < _numEntries) && (_entries[position].objectId == objectId) &&
+        (_entries[position].instance == object->_instance)) {
+        printfLog("M2MLinkPayload: \"%s\" is already in the payload.\n", fragment);
+        return false;
+    }
+
+    // A fragment goes in front of the one it comes before, with
+    // a comma after it, or at the end, with a comma before it
+    size = length + ((_numEntries > 0) ? 1 : 0);
+    if (!reserve(_size + size)) {
+        printfLog("M2MLinkPayload: unable to allocate room for \"%s\".\n", fragment);
+        return false;
+    }
+    if (position < _numEntries) {
+        offset = _entries[position].offset;
+        memmove(_payload + offset + size, _payload + offset, _size - offset + 1);
+        memcpy(_payload + offset, fragment, length);
+        *(_payload + offset + length) = ',';
+        _stats.bytesMoved += _size - offset;
+        memmove(_entries + position + 1, _entries + position,
+                (_numEntries - position) * sizeof(Entry));
+        for (int x = position + 1; x <= _numEntries; x++) {
+            _entries[x].offset += size;
+        }
+    } else {
+        offset = _size;
+        if (_numEntries > 0) {
+            *(_payload + offset) = ',';
+            offset++;
+        }
+        memcpy(_payload + offset, fragment, length + 1);
+    }
+    _entries[position].object = object;
+    _entries[position].objectId = objectId;
+    _entries[position].instance = object->_instance;
+    _entries[position].offset = offset;
+    _numEntries++;
+    _size += size;
+    _stats.numSplices++;
+    if (length > _stats.maxFragmentSize) {
+        _stats.maxFragmentSize = length;
+    }
+
+    return true;
+}
+
+// Remove the fragment of an object from the payload.
+bool M2MLinkPayload::remove(M2MObjectHelper *object)
+{
+    int position;
+    int start;
+    int end;
+
+    position = findPosition(strtoul(object->_defObject->name, NULL, 10), object->_instance);
+    if ((position >= _numEntries) || (_entries[position].object != object)) {
+        printfLog("M2MLinkPayload: object \"%s\", instance %d, is not in the payload.\n",
+                  object->_defObject->name, object->_instance);
+        return false;
+    }
+
+    // Take out the fragment and the comma after it or, for the
+    // last, the comma before it
+    if (position < _numEntries - 1) {
+        start = _entries[position].offset;
+        end = _entries[position + 1].offset;
+    } else {
+        start = (position > 0) ? _entries[position].offset - 1 : 0;
+        end = _size;
+    }
+    memmove(_payload + start, _payload + end, _size - end + 1);
+    _stats.bytesMoved += _size - end;
+    memmove(_entries + position, _entries + position + 1,
+            (_numEntries - position - 1) * sizeof(Entry));
+    _numEntries--;
+    for (int x = position; x < _numEntries; x++) {
+        _entries[x].offset -= end - start;
+    }
+    _size -= end - start;
+    _stats.numSplices++;
+
+    return true;
+}
+
+// Get the payload.
+const char *M2MLinkPayload::getPayload(int *length)
+{
+    if (length != NULL) {
+        *length = _size;
+    }
+
+    return (_payload != NULL) ? _payload : "";
+}
+
+// Get the number of bytes in the payload.
+int M2MLinkPayload::getSize()
+{
+    return _size;
+}
+
+// Get the statistics of the payload.
+void M2MLinkPayload::getStats(Stats *stats)
+{
+    *stats = _stats;
+    stats->numFragments = _numEntries;
+    stats->size = _size;
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Find where an object goes.
+int M2MLinkPayload::findPosition(uint32_t objectId, int instance)
+{
+    int low = 0;
+    int high = _numEntries;
+    int middle;
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if ((_entries[middle].objectId < objectId) ||
+            ((_entries[middle].objectId == objectId) && (_entries[middle].instance < instance))) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+// Make sure there is room for another entry and the payload.
+bool M2MLinkPayload::reserve(int size)
+{
+    Entry *entries;
+    char *payload;
+    int allocated;
+
+    if (_numEntries >= _numEntriesAllocated) {
+        allocated = (_numEntriesAllocated > 0) ? _numEntriesAllocated * 2 : 16;
+        entries = (Entry *) realloc(_entries, allocated * sizeof(Entry));
+        if (entries == NULL) {
+            return false;
+        }
+        _entries = entries;
+        _numEntriesAllocated = allocated;
+    }
+    if (size + 1 > _sizeAllocated) {
+        allocated = (_sizeAllocated > 0) ? _sizeAllocated : 256;
+        while (size + 1 > allocated) {
+            allocated *= 2;
+        }
+        payload = (char *) realloc(_payload, allocated);
+        if (payload == NULL) {
+            return false;
+        }
+        if (_payload == NULL) {
+            *payload = 0;
+        }
+        _payload = payload;
+        _sizeAllocated = allocated;
+    }
+
+    return true;
+}
+
+// End of file
@@ -0,0 +1,171 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_LINKS_
+#define _M2M_OBJECT_HELPER_LINKS_
+
+/** This class keeps the CoRE link-format list of object instances
+ * that goes in a registration or registration update payload, for a
+ * set of objects made with M2MObjectHelper.
+ *
+ * OVERVIEW
+ *
+ * Each object works out its own fragment of the list, e.g. "</3303/0>",
+ * once, when it is made (see M2MObjectHelper::getLinkFragment()).  Give
+ * each object the payload with M2MObjectHelper::setLinkPayload() and it
+ * adds itself when it is made and removes itself when it is deleted:
+ *
+ * M2MLinkPayload links;
+ * sensor->setLinkPayload(&links);
+ * sensor->makeObject();
+ * ...
+ * payload = links.getPayload(&length);
+ *
+ * add() and remove() can also be called directly.
+ * ...giving "</3303/0>,</3303/1>,</3311/0>", in order of object ID and
+ * then instance.  Adding or removing an object splices its fragment
+ * into or out of the payload as it stands, moving only the bytes after
+ * it; nothing is formatted again.  getSize() and the fragment lengths
+ * tell you how big the payload is, or will be, e.g. to decide how many
+ * objects can go in the first registration.
+ *
+ * Mbed Client formats its own registration payload from the objects
+ * it is given and does not take this one: the payload is for code that
+ * builds registration payloads itself, e.g. a gateway registering its
+ * sensors' objects through its own LWM2M stack, or that needs to budget
+ * for them.
+ */
+class M2MLinkPayload {
+public:
+
+    /** Structure to report on the payload.
+     */
+    typedef struct {
+        int numFragments;     ///< the number of objects in the payload.
+        int size;             ///< the bytes in the payload.
+        int maxFragmentSize;  ///< the longest fragment added so far.
+        uint32_t numSplices;  ///< fragments added or removed.
+        uint64_t bytesMoved;  ///< bytes moved to make or close gaps.
+    } Stats;
+
+    /** Constructor.
+     *
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MLinkPayload(bool debugOn = false);
+
+    /** Destructor.
+     */
+    ~M2MLinkPayload();
+
+    /** Add the fragment of an object to the payload.
+     *
+     * @param object  the object, which must have been
+     *                made and must not already be in
+     *                the payload.
+     * @return        true if successful, otherwise false.
+     */
+    bool add(M2MObjectHelper *object);
+
+    /** Remove the fragment of an object from the payload.
+     *
+     * @param object  the object.
+     * @return        true if successful, false if the
+     *                object is not in the payload.
+     */
+    bool remove(M2MObjectHelper *object);
+
+    /** Get the payload.
+     *
+     * @param length  pointer to a place to put the number
+     *                of bytes in the payload, may be NULL.
+     * @return        the NULL terminated payload, valid
+     *                until the next add() or remove().
+     */
+    const char *getPayload(int *length = NULL);
+
+    /** Get the number of bytes in the payload.
+     *
+     * @return  the number of bytes.
+     */
+    int getSize();
+
+    /** Get the statistics of the payload.
+     *
+     * @param stats  pointer to a place to put the statistics.
+     */
+    void getStats(Stats *stats);
+
+protected:
+
+    /** Structure to hold an object in the payload.
+     */
+    typedef struct {
+        M2MObjectHelper *object;  ///< the object.
+        uint32_t objectId;        ///< its object ID.
+        int instance;             ///< its instance.
+        int offset;               ///< where its fragment starts.
+    } Entry;
+
+    /** Find where an object goes in _entries.
+     *
+     * @param objectId  the object ID.
+     * @param instance  the instance.
+     * @return          the position of the first entry
+     *                  not before it.
+     */
+    int findPosition(uint32_t objectId, int instance);
+
+    /** Make sure there is room for more entries and
+     * bytes of payload.
+     *
+     * @param size  the number of bytes of payload needed.
+     * @return      true if successful, otherwise false.
+     */
+    bool reserve(int size);
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The objects in the payload, in order.
+     */
+    Entry *_entries;
+
+    /** The number of entries in use and allocated.
+     */
+    int _numEntries;
+    int _numEntriesAllocated;
+
+    /** The payload.
+     */
+    char *_payload;
+
+    /** The bytes in the payload, excluding the terminator,
+     * and the size of _payload.
+     */
+    int _size;
+    int _sizeAllocated;
+
+    /** The statistics.
+     */
+    Stats _stats;
+};
+
+#endif // _M2M_OBJECT_HELPER_LINKS_
+
+// End of file
@@ -0,0 +1,266 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "m2m_object_helper_pool.h"
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MObjectPool::M2MObjectPool(int lowWatermark,
+                             int highWatermark,
+                             bool debugOn)
+{
+    _debugOn = debugOn;
+    _lowWatermark = lowWatermark;
+    _highWatermark = highWatermark;
+    if (_highWatermark < _lowWatermark) {
+        _highWatermark = _lowWatermark;
+    }
+    for (int x = 0; x < MAX_NUM_BLOCK_TYPES; x++) {
+        _free[x] = NULL;
+    }
+    memset(_stats, 0, sizeof(_stats));
+    _stats[BLOCK_TYPE_SPILL].blockSize = M2M_OBJECT_POOL_SPILL_BLOCK_SIZE;
+}
+
+// Destructor.
+M2MObjectPool::~M2MObjectPool()
+{
+    FreeBlock *freeBlock;
+
+    for (int x = 0; x < MAX_NUM_BLOCK_TYPES; x++) {
+        if (_stats[x].numInUse > 0) {
+            printfLog("M2MObjectPool: deleted with %d block(s) of type %d still in use.\n",
+                      _stats[x].numInUse, x);
+        }
+        while (_free[x] != NULL) {
+            freeBlock = _free[x];
+            _free[x] = freeBlock->next;
+            delete[] (char *) freeBlock;
+        }
+    }
+}
+
+// Take a block from the pool.
+char *M2MObjectPool::take(BlockType type, unsigned int size)
+{
+    char *block = NULL;
+    FreeBlock *freeBlock;
+    Stats *stats;
+
+    if ((unsigned int) type >= MAX_NUM_BLOCK_TYPES) {
+        return NULL;
+    }
+    stats = &(_stats[type]);
+
+    if (stats->blockSize == 0) {
+        // First use: the block size is that of the first
+        // object of the definition
+        stats->blockSize = size;
+        if (stats->blockSize < sizeof(FreeBlock) - sizeof(BlockHeader)) {
+            stats->blockSize = sizeof(FreeBlock) - sizeof(BlockHeader);
+        }
+    }
+
+    if (size <= stats->blockSize) {
+        if (_free[type] != NULL) {
+            freeBlock = _free[type];
+            _free[type] = freeBlock->next;
+            stats->numFree--;
+            if (freeBlock->header.fields.state == M2M_OBJECT_POOL_BLOCK_FREE) {
+                stats->numReused++;
+            }
+            block = ((char *) freeBlock) + sizeof(BlockHeader);
+        } else {
+            block = allocate(type);
+        }
+        if (block != NULL) {
+            header(block)->fields.state = M2M_OBJECT_POOL_BLOCK_IN_USE;
+            stats->numTaken++;
+            stats->numInUse++;
+            if (stats->numInUse > stats->peakInUse) {
+                stats->peakInUse = stats->numInUse;
+            }
+        }
+        // Keep the low watermark's worth ready
+        refill(type);
+    } else {
+        printfLog("M2MObjectPool: asked for %u byte(s) from a pool of %u byte block(s) (type %d).\n",
+                  size, stats->blockSize, type);
+    }
+
+    return block;
+}
+
+// Give a block back to the pool.
+bool M2MObjectPool::give(char *block)
+{
+    BlockHeader *blockHeader;
+    FreeBlock *freeBlock;
+    Stats *stats;
+
+    if (block == NULL) {
+        return false;
+    }
+
+    blockHeader = header(block);
+    if ((blockHeader->fields.pool != this) ||
+        (blockHeader->fields.type >= MAX_NUM_BLOCK_TYPES)) {
+        printfLog("M2MObjectPool: block %p is not from this pool, refused.\n", block);
+        return false;
+    }
+    stats = &(_stats[blockHeader->fields.type]);
+    if (blockHeader->fields.state != M2M_OBJECT_POOL_BLOCK_IN_USE) {
+        printfLog("M2MObjectPool: block %p is not in use, refused.\n", block);
+        stats->numRefused++;
+        return false;
+    }
+
+    stats->numGiven++;
+    stats->numInUse--;
+    if (stats->numFree < _highWatermark) {
+        blockHeader->fields.state = M2M_OBJECT_POOL_BLOCK_FREE;
+        freeBlock = (FreeBlock *) blockHeader;
+        freeBlock->next = _free[blockHeader->fields.type];
+        _free[blockHeader->fields.type] = freeBlock;
+        stats->numFree++;
+    } else {
+        blockHeader->fields.state = 0;
+        delete[] (char *) blockHeader;
+        stats->numReleased++;
+    }
+
+    return true;
+}
+
+// Get the size of the blocks of a type.
+unsigned int M2MObjectPool::getBlockSize(BlockType type)
+{
+    unsigned int blockSize = 0;
+
+    if ((unsigned int) type < MAX_NUM_BLOCK_TYPES) {
+        blockSize = _stats[type].blockSize;
+    }
+
+    return blockSize;
+}
+
+// Get the statistics of the pool for one type of block.
+void M2MObjectPool::getStats(Stats *stats, BlockType type)
+{
+    if ((unsigned int) type < MAX_NUM_BLOCK_TYPES) {
+        *stats = _stats[type];
+    } else {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+// Take a block from a pool or from the heap.
+char *M2MObjectPool::takeFrom(M2MObjectPool *pool, BlockType type,
+                              unsigned int size)
+{
+    char *block = NULL;
+    char *memory;
+    BlockHeader *blockHeader;
+
+    if (pool != NULL) {
+        block = pool->take(type, size);
+    }
+
+    if (block == NULL) {
+        memory = new char[sizeof(BlockHeader) + size];
+        if (memory != NULL) {
+            blockHeader = (BlockHeader *) memory;
+            blockHeader->fields.pool = NULL;
+            blockHeader->fields.type = type;
+            blockHeader->fields.state = M2M_OBJECT_POOL_BLOCK_IN_USE;
+            block = memory + sizeof(BlockHeader);
+        }
+    }
+
+    return block;
+}
+
+// Give back a block from takeFrom().
+void M2MObjectPool::giveBack(char *block)
+{
+    BlockHeader *blockHeader;
+
+    if (block != NULL) {
+        blockHeader = header(block);
+        if (blockHeader->fields.pool != NULL) {
+            blockHeader->fields.pool->give(block);
+        } else if (blockHeader->fields.state == M2M_OBJECT_POOL_BLOCK_IN_USE) {
+            blockHeader->fields.state = 0;
+            delete[] (char *) blockHeader;
+        }
+    }
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Get the header of a block.
+M2MObjectPool::BlockHeader *M2MObjectPool::header(char *block)
+{
+    return (BlockHeader *) (block - sizeof(BlockHeader));
+}
+
+// Allocate a block from the heap.
+char *M2MObjectPool::allocate(BlockType type)
+{
+    char *memory = new char[sizeof(BlockHeader) + _stats[type].blockSize];
+    BlockHeader *blockHeader;
+    char *block = NULL;
+
+    if (memory != NULL) {
+        blockHeader = (BlockHeader *) memory;
+        blockHeader->fields.pool = this;
+        blockHeader->fields.type = type;
+        blockHeader->fields.state = M2M_OBJECT_POOL_BLOCK_IN_USE;
+        block = memory + sizeof(BlockHeader);
+        _stats[type].numAllocated++;
+    }
+
+    return block;
+}
+
+// Top up the free blocks of a type to the low watermark.
+void M2MObjectPool::refill(BlockType type)
+{
+    FreeBlock *freeBlock;
+    char *block;
+
+    while (_stats[type].numFree < _lowWatermark) {
+        block = allocate(type);
+        if (block == NULL) {
+            break;
+        }
+        freeBlock = (FreeBlock *) header(block);
+        freeBlock->header.fields.state = M2M_OBJECT_POOL_BLOCK_NEW;
+        freeBlock->next = _free[type];
+        _free[type] = freeBlock;
+        _stats[type].numFree++;
+    }
+}
+
+// End of file
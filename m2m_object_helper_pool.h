@@ -0,0 +1,305 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_POOL_
+#define _M2M_OBJECT_HELPER_POOL_
+
+#include <new>
+
+/** This class keeps a pool of the storage that M2MObjectHelper
+ * allocates for each object, so that objects which come and go (e.g.
+ * the objects of sensors joining and leaving a gateway) recycle it
+ * rather than return it to the heap.
+ *
+ * OVERVIEW
+ *
+ * Create one pool per object definition and give it, with
+ * M2MObjectHelper::setPool(), to every object made from that definition
+ * before makeObject() is called.  Three types of block are then taken
+ * from the pool and given back to it when the object is deleted:
+ *
+ * - BLOCK_TYPE_HELPER: the object itself, i.e. the M2MObjectHelper
+ *   state including the table of resource handles, if the object is
+ *   created with make() and deleted with destroy() rather than with
+ *   plain new and delete, e.g.:
+ *
+ *   MyObject *object = M2MObjectPool::make<MyObject>(pool);
+ *   object->setPool(pool);
+ *   ...
+ *   M2MObjectPool::destroy(object);
+ *
+ * - BLOCK_TYPE_STRINGS: the storage for the values of the STRING
+ *   resources of the object.
+ * - BLOCK_TYPE_SPILL: the storage for a STRING value too long to be
+ *   held inline, provided it fits in M2M_OBJECT_POOL_SPILL_BLOCK_SIZE.
+ *
+ * The block size of the first two types is set by the first object to
+ * use the pool, since it is the same for every object of a definition.
+ * A request for more than the block size (e.g. from an object of
+ * another definition) is refused, with a debug print, and the helper
+ * uses the heap instead.
+ *
+ * For each type the pool keeps at least lowWatermark free blocks ready,
+ * topping them up when a block is taken, and gives blocks back to the
+ * heap only when more than highWatermark are free, so that a burst of
+ * deletions does not hold on to memory forever.  Each block carries a
+ * small header naming the pool and the type it came from: give()
+ * refuses a block that was not taken from this pool, or that has
+ * already been given back.  getStats() reports how often blocks of
+ * each type have been reused.
+ *
+ * A pool is not thread-safe: objects sharing it must be made and
+ * deleted from one thread.  Delete the pool only after the objects
+ * using it.
+ */
+class M2MObjectPool {
+public:
+
+    /** The size of a block for a STRING value too long
+     * to be held inline.
+     */
+#ifndef M2M_OBJECT_POOL_SPILL_BLOCK_SIZE
+#   define M2M_OBJECT_POOL_SPILL_BLOCK_SIZE 128
+#endif
+
+    /** The types of block in the pool.
+     */
+    typedef enum {
+        BLOCK_TYPE_HELPER,   ///< an M2MObjectHelper.
+        BLOCK_TYPE_STRINGS,  ///< the inline storage for STRING values.
+        BLOCK_TYPE_SPILL,    ///< a STRING value too long to go inline.
+        MAX_NUM_BLOCK_TYPES
+    } BlockType;
+
+    /** Structure to report how the pool is doing for
+     * one type of block.
+     */
+    typedef struct {
+        unsigned int blockSize;     ///< the size of each block, 0 until
+                                    /// the pool is first used.
+        uint32_t numTaken;          ///< blocks taken from the pool.
+        uint32_t numReused;         ///< of those, how many were blocks
+                                    /// that had been given back.
+        uint32_t numGiven;          ///< blocks given back to the pool.
+        uint32_t numRefused;        ///< blocks refused by give() as
+                                    /// already given back.
+        uint32_t numAllocated;      ///< blocks allocated from the heap.
+        uint32_t numReleased;       ///< blocks released to the heap.
+        int numFree;                ///< blocks free in the pool now.
+        int numInUse;               ///< blocks in use now.
+        int peakInUse;              ///< the most blocks in use at once.
+    } Stats;
+
+    /** Constructor.
+     *
+     * @param lowWatermark   the number of free blocks of
+     *                       each type to keep ready.
+     * @param highWatermark  the most free blocks of each type
+     *                       to keep, at least lowWatermark.
+     * @param debugOn        true to switch debug prints on,
+     *                       otherwise false.
+     */
+    M2MObjectPool(int lowWatermark = 0,
+                  int highWatermark = 16,
+                  bool debugOn = false);
+
+    /** Destructor: releases the free blocks to the heap.
+     */
+    ~M2MObjectPool();
+
+    /** Take a block from the pool.
+     *
+     * @param type  the type of block.
+     * @param size  the size of block wanted, which must be
+     *              no more than the block size of the type.
+     * @return      the block, NULL if the size is more than
+     *              that of the pool or there is no memory.
+     */
+    char *take(BlockType type, unsigned int size);
+
+    /** Give a block back to the pool.
+     *
+     * @param block  a block from take().
+     * @return       true if the block was taken back, false if
+     *               it was not from this pool or was already
+     *               given back, in which case it is untouched.
+     */
+    bool give(char *block);
+
+    /** Get the size of the blocks of a type.
+     *
+     * @param type  the type of block.
+     * @return      the size of the blocks, 0 if not yet known.
+     */
+    unsigned int getBlockSize(BlockType type);
+
+    /** Get the statistics of the pool for one type of block.
+     *
+     * @param stats  pointer to a place to put the statistics.
+     * @param type   the type of block.
+     */
+    void getStats(Stats *stats, BlockType type = BLOCK_TYPE_STRINGS);
+
+    /** Take a block from a pool or, if there is no pool or
+     * the pool cannot provide it, from the heap; either way
+     * it must be given back with giveBack().
+     *
+     * @param pool  the pool, may be NULL.
+     * @param type  the type of block.
+     * @param size  the size of block wanted.
+     * @return      the block, NULL if there is no memory.
+     */
+    static char *takeFrom(M2MObjectPool *pool, BlockType type,
+                          unsigned int size);
+
+    /** Give back a block from takeFrom(), to its pool
+     * or to the heap.
+     *
+     * @param block  the block, may be NULL.
+     */
+    static void giveBack(char *block);
+
+    /** Create an object in a block of type BLOCK_TYPE_HELPER
+     * from takeFrom(), passing up to four arguments to its
+     * constructor, e.g. M2MObjectPool::make<MyObject>(pool, 1).
+     * An object created this way must be deleted with
+     * destroy(), not delete.
+     *
+     * @param pool  the pool, may be NULL.
+     * @return      the object, NULL if there is no memory.
+     */
+    template <class T>
+    static T *make(M2MObjectPool *pool)
+    {
+        char *block = takeFrom(pool, BLOCK_TYPE_HELPER, sizeof(T));
+        return (block != NULL) ? new (block) T() : NULL;
+    }
+
+    template <class T, class A1>
+    static T *make(M2MObjectPool *pool, A1 a1)
+    {
+        char *block = takeFrom(pool, BLOCK_TYPE_HELPER, sizeof(T));
+        return (block != NULL) ? new (block) T(a1) : NULL;
+    }
+
+    template <class T, class A1, class A2>
+    static T *make(M2MObjectPool *pool, A1 a1, A2 a2)
+    {
+        char *block = takeFrom(pool, BLOCK_TYPE_HELPER, sizeof(T));
+        return (block != NULL) ? new (block) T(a1, a2) : NULL;
+    }
+
+    template <class T, class A1, class A2, class A3>
+    static T *make(M2MObjectPool *pool, A1 a1, A2 a2, A3 a3)
+    {
+        char *block = takeFrom(pool, BLOCK_TYPE_HELPER, sizeof(T));
+        return (block != NULL) ? new (block) T(a1, a2, a3) : NULL;
+    }
+
+    template <class T, class A1, class A2, class A3, class A4>
+    static T *make(M2MObjectPool *pool, A1 a1, A2 a2, A3 a3, A4 a4)
+    {
+        char *block = takeFrom(pool, BLOCK_TYPE_HELPER, sizeof(T));
+        return (block != NULL) ? new (block) T(a1, a2, a3, a4) : NULL;
+    }
+
+    /** Delete an object created with make(), giving its
+     * block back to its pool or to the heap.
+     *
+     * @param object  the object, as returned by make(),
+     *                may be NULL.
+     */
+    template <class T>
+    static void destroy(T *object)
+    {
+        if (object != NULL) {
+            object->~T();
+            giveBack((char *) object);
+        }
+    }
+
+protected:
+
+    /** The state of a block, kept in its header.
+     */
+#   define M2M_OBJECT_POOL_BLOCK_IN_USE 0xB10C
+#   define M2M_OBJECT_POOL_BLOCK_FREE   0xF4EE
+#   define M2M_OBJECT_POOL_BLOCK_NEW    0x4E77
+
+    /** The header at the start of every block, padded
+     * so that what follows is aligned for any type.
+     */
+    typedef union {
+        struct {
+            M2MObjectPool *pool;    ///< the pool, NULL for the heap.
+            uint16_t type;          ///< the BlockType.
+            uint16_t state;         ///< M2M_OBJECT_POOL_BLOCK_x.
+        } fields;
+        double alignDouble;
+        long long alignLongLong;
+        void *alignPointer;
+    } BlockHeader;
+
+    /** A free block, which holds a pointer to the
+     * next free block after its header.
+     */
+    typedef struct FreeBlock {
+        BlockHeader header;
+        struct FreeBlock *next;
+    } FreeBlock;
+
+    /** Get the header of a block.
+     *
+     * @param block  the block, as returned by take().
+     * @return       the header.
+     */
+    static BlockHeader *header(char *block);
+
+    /** Allocate a block from the heap.
+     *
+     * @param type  the type of block.
+     * @return      the block, NULL if there is no memory.
+     */
+    char *allocate(BlockType type);
+
+    /** Top up the free blocks of a type to the low
+     * watermark.
+     *
+     * @param type  the type of block.
+     */
+    void refill(BlockType type);
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The watermarks.
+     */
+    int _lowWatermark;
+    int _highWatermark;
+
+    /** The free blocks of each type.
+     */
+    FreeBlock *_free[MAX_NUM_BLOCK_TYPES];
+
+    /** The statistics of each type.
+     */
+    Stats _stats[MAX_NUM_BLOCK_TYPES];
+};
+
+#endif // _M2M_OBJECT_HELPER_POOL_
+
+// End of file
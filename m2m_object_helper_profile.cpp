@@ -0,0 +1,263 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "m2m_object_helper_profile.h"
+
+#if defined(MBED_HEAP_STATS_ENABLED) && MBED_HEAP_STATS_ENABLED
+#include "mbed_stats.h"
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <time.h>
+#endif
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/** The most distinct Mbed Client calls totalled by printSummary().
+ */
+#define STARTUP_PROFILE_MAX_CALLS 16
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MStartupProfile::M2MStartupProfile(int maxRecords, bool debugOn)
+{
+    _debugOn = debugOn;
+    _records = new Record[maxRecords];
+    _maxRecords = maxRecords;
+    _numRecords = 0;
+    _numDropped = 0;
+    _depth = 0;
+    _numTooDeep = 0;
+    _overheadNs = 0;
+}
+
+// Destructor.
+M2MStartupProfile::~M2MStartupProfile()
+{
+    delete[] _records;
+}
+
+// Open a frame.
+void M2MStartupProfile::begin(const char *name, int instance)
+{
+    open(name, instance, false);
+}
+
+// Open a frame for a call into Mbed Client.
+void M2MStartupProfile::beginCall(const char *name)
+{
+    open(name, -1, true);
+}
+
+// Close the innermost open frame.
+void M2MStartupProfile::end()
+{
+    uint64_t start = now();
+    int64_t bytes = heapUsed();
+    OpenFrame *openFrame;
+    Record *record;
+    int64_t totalNs;
+    int64_t totalBytes;
+
+    if (_numTooDeep > 0) {
+        // Closing a frame that was never opened
+        _numTooDeep--;
+    } else if (_depth > 0) {
+        _depth--;
+        openFrame = &(_open[_depth]);
+        // Leave out the time the profile spent on itself in between
+        totalNs = (int64_t) (start - openFrame->startNs) - (int64_t) (_overheadNs - openFrame->overheadNsAtStart);
+        if (totalNs < 0) {
+            totalNs = 0;
+        }
+        totalBytes = bytes - openFrame->startBytes;
+        if (_numRecords < _maxRecords) {
+            record = &(_records[_numRecords]);
+            for (int x = 0; x <= _depth; x++) {
+                record->frames[x] = _open[x].frame;
+            }
+            record->depth = _depth + 1;
+            record->call = openFrame->call;
+            // Clock granularity can make a very short frame come out negative
+            record->selfNs = 0;
+            if (totalNs > (int64_t) openFrame->childNs) {
+                record->selfNs = (uint32_t) (totalNs - openFrame->childNs);
+            }
+            record->selfBytes = (int32_t) (totalBytes - openFrame->childBytes);
+            _numRecords++;
+        } else {
+            _numDropped++;
+        }
+        if (_depth > 0) {
+            _open[_depth - 1].childNs += totalNs;
+            _open[_depth - 1].childBytes += totalBytes;
+        }
+    }
+
+    _overheadNs += now() - start;
+}
+
+// Get the number of records kept.
+int M2MStartupProfile::getNumRecords(int *numDropped)
+{
+    if (numDropped != NULL) {
+        *numDropped = _numDropped;
+    }
+
+    return _numRecords;
+}
+
+// Write the records to a file in folded stack format.
+bool M2MStartupProfile::exportFolded(const char *path, bool heap)
+{
+    FILE *file;
+    const Record *record;
+    bool success;
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        printfLog("M2MStartupProfile: unable to open \"%s\".\n", path);
+        return false;
+    }
+
+    for (int x = 0; x < _numRecords; x++) {
+        record = &(_records[x]);
+        if (!heap || (record->selfBytes > 0)) {
+            for (int y = 0; y < record->depth; y++) {
+                fprintf(file, "%s%s", (y > 0) ? ";" : "", record->frames[y].name);
+                if (record->frames[y].instance >= 0) {
+                    fprintf(file, "/%d", record->frames[y].instance);
+                }
+            }
+            fprintf(file, " %ld\n", heap ? (long) record->selfBytes : (long) record->selfNs);
+        }
+    }
+    success = (ferror(file) == 0);
+    if (fclose(file) != 0) {
+        success = false;
+    }
+    printfLog("M2MStartupProfile: %d record(s) written to \"%s\".\n", _numRecords, path);
+
+    return success;
+}
+
+// Print the totals for the helper and for each Mbed Client call.
+void M2MStartupProfile::printSummary()
+{
+    const char *names[STARTUP_PROFILE_MAX_CALLS];
+    uint64_t ns[STARTUP_PROFILE_MAX_CALLS + 1];
+    int64_t bytes[STARTUP_PROFILE_MAX_CALLS + 1];
+    uint32_t counts[STARTUP_PROFILE_MAX_CALLS + 1];
+    int numNames = 0;
+    int x;
+    const Record *record;
+
+    // The last entry is the helper itself, i.e. everything that
+    // isn't a call into Mbed Client
+    memset(ns, 0, sizeof(ns));
+    memset(bytes, 0, sizeof(bytes));
+    memset(counts, 0, sizeof(counts));
+    for (int y = 0; y < _numRecords; y++) {
+        record = &(_records[y]);
+        x = STARTUP_PROFILE_MAX_CALLS;
+        if (record->call) {
+            for (x = 0; (x < numNames) && (names[x] != record->frames[record->depth - 1].name); x++) {
+            }
+            if ((x == numNames) && (numNames < STARTUP_PROFILE_MAX_CALLS)) {
+                names[x] = record->frames[record->depth - 1].name;
+                numNames++;
+            }
+        }
+        if (x < STARTUP_PROFILE_MAX_CALLS) {
+            counts[x]++;
+        }
+        ns[x] += record->selfNs;
+        bytes[x] += record->selfBytes;
+    }
+
+    printf("Start-up profile: %d record(s), %d dropped.\n", _numRecords, _numDropped);
+    printf("  %-34s %8s %12s %12s\n", "", "calls", "us", "heap bytes");
+    for (x = 0; x < numNames; x++) {
+        printf("  %-34s %8lu %12lu %12ld\n", names[x], (unsigned long) counts[x],
+               (unsigned long) (ns[x] / 1000), (long) bytes[x]);
+    }
+    printf("  %-34s %8s %12lu %12ld\n", "(M2MObjectHelper)", "",
+           (unsigned long) (ns[STARTUP_PROFILE_MAX_CALLS] / 1000), (long) bytes[STARTUP_PROFILE_MAX_CALLS]);
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Get the time now in nanoseconds.
+uint64_t M2MStartupProfile::now()
+{
+#ifdef __linux__
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + time.tv_nsec;
+#else
+    return (uint64_t) us_ticker_read() * 1000;
+#endif
+}
+
+// Get the amount of heap in use.
+int64_t M2MStartupProfile::heapUsed()
+{
+#if defined(MBED_HEAP_STATS_ENABLED) && MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t stats;
+
+    mbed_stats_heap_get(&stats);
+    return stats.current_size;
+#elif defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Open a frame.
+void M2MStartupProfile::open(const char *name, int instance, bool call)
+{
+    uint64_t start = now();
+    OpenFrame *openFrame;
+
+    if (_depth < STARTUP_PROFILE_MAX_DEPTH) {
+        openFrame = &(_open[_depth]);
+        openFrame->frame.name = name;
+        openFrame->frame.instance = instance;
+        openFrame->call = call;
+        openFrame->startBytes = heapUsed();
+        openFrame->childNs = 0;
+        openFrame->childBytes = 0;
+        _depth++;
+        // Timed from here so as to leave out the heap measurement
+        _overheadNs += now() - start;
+        openFrame->overheadNsAtStart = _overheadNs;
+        openFrame->startNs = now();
+    } else {
+        _numTooDeep++;
+        printfLog("M2MStartupProfile: frames nested more than %d deep.\n", STARTUP_PROFILE_MAX_DEPTH);
+    }
+}
+
+// End of file
@@ -0,0 +1,205 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_PROFILE_
+#define _M2M_OBJECT_HELPER_PROFILE_
+
+/** This class records where the time and heap go while objects are
+ * made with M2MObjectHelper, e.g. at start-up.
+ *
+ * OVERVIEW
+ *
+ * Build with STARTUP_PROFILE defined to 1 (it is 0, i.e. compiled out,
+ * by default), create a profile and give it to the helper before any
+ * objects are made, then take it away again once start-up is done:
+ *
+ * M2MStartupProfile profile(20000);
+ * M2MObjectHelper::setStartupProfile(&profile);
+ * ...construct objects.
+ * M2MObjectHelper::setStartupProfile(NULL);
+ * profile.printSummary();
+ * profile.exportFolded("/tmp/startup.folded");
+ *
+ * While it is set, makeObject() (or makeObjectSlice()) and
+ * setResourceValue() record, for each object instance and for each
+ * resource, the time and heap taken by the helper itself and by each
+ * call into Mbed Client (create_object, create_object_instance,
+ * create_dynamic_resource, create_dynamic_resource_instance,
+ * set_operation, set_value_updated_function, set_value, etc.); time
+ * taken by the profile itself is left out.
+ *
+ * exportFolded() writes one line per record in the "folded stack"
+ * format read by flame graph tools (e.g. Brendan Gregg's
+ * flamegraph.pl or speedscope), values being nanoseconds of self time,
+ * or bytes of heap if asked for, e.g.:
+ *
+ * 3303/0;makeObject;5700;create_dynamic_resource 2150
+ *
+ * printSummary() prints the totals for each Mbed Client call.  Heap is
+ * measured with mbed_stats_heap_get() where MBED_HEAP_STATS_ENABLED,
+ * with mallinfo2() on glibc and is otherwise reported as zero.
+ *
+ * The profile holds up to maxRecords records, allocated when it is
+ * constructed so that it does not disturb the heap it measures;
+ * records beyond that are counted but dropped.  A profile is not
+ * thread-safe.
+ */
+class M2MStartupProfile {
+public:
+
+    /** The deepest nesting of frames recorded.
+     */
+#   ifndef STARTUP_PROFILE_MAX_DEPTH
+#   define STARTUP_PROFILE_MAX_DEPTH 6
+#   endif
+
+    /** Constructor.
+     *
+     * @param maxRecords  the most records to keep.
+     * @param debugOn     true to switch debug prints on,
+     *                    otherwise false.
+     */
+    M2MStartupProfile(int maxRecords, bool debugOn = false);
+
+    /** Destructor.
+     */
+    ~M2MStartupProfile();
+
+    /** Open a frame, e.g. for an object or a resource.
+     *
+     * @param name      the name, which must remain valid
+     *                  for the life of the profile.
+     * @param instance  the instance, shown after the name,
+     *                  or -1 for none.
+     */
+    void begin(const char *name, int instance = -1);
+
+    /** Open a frame for a call into Mbed Client.
+     *
+     * @param name  the name of the call, a string literal.
+     */
+    void beginCall(const char *name);
+
+    /** Close the innermost open frame, recording its
+     * self time and heap.
+     */
+    void end();
+
+    /** Get the number of records kept.
+     *
+     * @param numDropped  pointer to a place to put the number
+     *                    of records dropped for lack of room,
+     *                    may be NULL.
+     * @return            the number of records.
+     */
+    int getNumRecords(int *numDropped = NULL);
+
+    /** Write the records to a file in folded stack format.
+     *
+     * @param path  the path of the file.
+     * @param heap  true to write bytes of heap, otherwise
+     *              nanoseconds; records with no heap growth
+     *              are left out.
+     * @return      true if successful, otherwise false.
+     */
+    bool exportFolded(const char *path, bool heap = false);
+
+    /** Print the totals for the helper and for each
+     * Mbed Client call.
+     */
+    void printSummary();
+
+protected:
+
+    /** A frame.
+     */
+    typedef struct {
+        const char *name;
+        int instance;
+    } Frame;
+
+    /** A record of the self time and heap of a frame.
+     */
+    typedef struct {
+        Frame frames[STARTUP_PROFILE_MAX_DEPTH];
+        uint8_t depth;
+        bool call;          ///< true if the innermost frame is a call
+                            /// into Mbed Client.
+        uint32_t selfNs;
+        int32_t selfBytes;
+    } Record;
+
+    /** A frame that is open.
+     */
+    typedef struct {
+        Frame frame;
+        bool call;
+        uint64_t startNs;
+        int64_t startBytes;
+        uint64_t overheadNsAtStart;
+        uint64_t childNs;
+        int64_t childBytes;
+    } OpenFrame;
+
+    /** Get the time now.
+     *
+     * @return  the time in nanoseconds.
+     */
+    static uint64_t now();
+
+    /** Get the amount of heap in use.
+     *
+     * @return  the number of bytes.
+     */
+    static int64_t heapUsed();
+
+    /** Open a frame.
+     *
+     * @param name      the name.
+     * @param instance  the instance, -1 for none.
+     * @param call      true if a call into Mbed Client.
+     */
+    void open(const char *name, int instance, bool call);
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The records.
+     */
+    Record *_records;
+    int _maxRecords;
+    int _numRecords;
+    int _numDropped;
+
+    /** The frames that are open.
+     */
+    OpenFrame _open[STARTUP_PROFILE_MAX_DEPTH];
+    int _depth;
+
+    /** The number of frames opened beyond the deepest
+     * and not yet closed.
+     */
+    int _numTooDeep;
+
+    /** The time taken by the profile itself.
+     */
+    uint64_t _overheadNs;
+};
+
+#endif // _M2M_OBJECT_HELPER_PROFILE_
+
+// End of file
@@ -0,0 +1,504 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_snapshot.h"
+#include <stddef.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/**********************************************************************
+ * STATIC FUNCTIONS
+ **********************************************************************/
+
+// A snapshot while it is being put together.
+typedef struct {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t allocated;
+    uint32_t *relocations;
+    uint32_t numRelocations;
+    uint32_t numRelocationsAllocated;
+    bool failed;
+} Image;
+
+// An object to be put in the snapshot, for sorting.
+typedef struct {
+    uint32_t objectId;
+    int instance;
+    int position;
+} SortEntry;
+
+// Order SortEntries by object ID and then instance.
+static int compareSortEntries(const void *a, const void *b)
+{
+    const SortEntry *entryA = (const SortEntry *) a;
+    const SortEntry *entryB = (const SortEntry *) b;
+
+    if (entryA->objectId != entryB->objectId) {
+        return (entryA->objectId < entryB->objectId) ? -1 : 1;
+    }
+    if (entryA->instance != entryB->instance) {
+        return (entryA->instance < entryB->instance) ? -1 : 1;
+    }
+
+    return entryA->position - entryB->position;
+}
+
+// Add zeroed space to an image, returning its offset.
+static uint32_t imageAdd(Image *image, uint32_t size, uint32_t alignment)
+{
+    uint32_t offset = (image->size + alignment - 1) / alignment * alignment;
+    uint32_t allocated = image->allocated;
+    uint8_t *data;
+
+    if (image->failed) {
+        return 0;
+    }
+    while (offset + size > allocated) {
+        allocated = (allocated > 0) ? allocated * 2 : 4096;
+    }
+    if (allocated != image->allocated) {
+        data = (uint8_t *) realloc(image->data, allocated);
+        if (data == NULL) {
+            image->failed = true;
+            return 0;
+        }
+        image->data = data;
+        image->allocated = allocated;
+    }
+    memset(image->data + image->size, 0, offset + size - image->size);
+    image->size = offset + size;
+
+    return offset;
+}
+
+// Add a copy of some bytes to an image, returning its offset.
+static uint32_t imageAddBytes(Image *image, const void *bytes, uint32_t size,
+                              uint32_t alignment)
+{
+    uint32_t offset = imageAdd(image, size, alignment);
+
+    if (!image->failed && (size > 0)) {
+        memcpy(image->data + offset, bytes, size);
+    }
+
+    return offset;
+}
+
+// Set a pointer in an image to an offset in the image and note
+// that it needs relocating when the image is loaded.
+static void imageSetPointer(Image *image, uint32_t pointerOffset, uint32_t offset)
+{
+    uint32_t allocated = image->numRelocationsAllocated;
+    uint32_t *relocations;
+
+    if (image->failed) {
+        return;
+    }
+    if (image->numRelocations >= allocated) {
+        allocated = (allocated > 0) ? allocated * 2 : 64;
+        relocations = (uint32_t *) realloc(image->relocations,
+                                           allocated * sizeof(uint32_t));
+        if (relocations == NULL) {
+            image->failed = true;
+            return;
+        }
+        image->relocations = relocations;
+        image->numRelocationsAllocated = allocated;
+    }
+    *(uintptr_t *) (image->data + pointerOffset) = offset;
+    image->relocations[image->numRelocations] = pointerOffset;
+    image->numRelocations++;
+}
+
+// Add a copy of a string to an image, if there is one, and set
+// a pointer in the image to it.
+static void imageSetString(Image *image, uint32_t pointerOffset, const char *string)
+{
+    uint32_t offset;
+
+    if (string != NULL) {
+        offset = imageAddBytes(image, string, strlen(string) + 1, 1);
+        imageSetPointer(image, pointerOffset, offset);
+    }
+}
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MObjectSnapshot::M2MObjectSnapshot(bool debugOn)
+                  :M2MDefinitionBlob("M2MS", debugOn)
+{
+}
+
+// Save a set of objects to a snapshot file.
+bool M2MObjectSnapshot::save(const char *path, M2MObjectHelper * const *objects,
+                             int numObjects, bool debugOn)
+{
+    bool success = false;
+    Image image;
+    SortEntry *order;
+    M2MObjectHelper *object;
+    const M2MObjectHelper::DefObject *source;
+    M2MObjectHelper::DefObject *defObject;
+    BlobHeader *header;
+    BlobIndexEntry *entry;
+    ValueEntry *valueEntry;
+    M2MResourceBase *handle;
+    uint32_t indexOffset;
+    uint32_t valuesOffsetsOffset;
+    uint32_t offset;
+    uint32_t valuesOffset;
+    const M2MObjectHelper::DefResourceOptions *options;
+    M2MObjectHelper::DefResourceOptions *copy;
+    uint32_t optionsOffset;
+    uint32_t enumOffset;
+    const char *value;
+    uint32_t length;
+    uint32_t numValues = 0;
+    uint32_t numOptions = 0;
+    char *tmpPath;
+    FILE *file;
+
+    memset(&image, 0, sizeof(image));
+    order = (SortEntry *) malloc((numObjects + 1) * sizeof(SortEntry));
+    tmpPath = (char *) malloc(strlen(path) + 5);
+    if ((order == NULL) || (tmpPath == NULL)) {
+        free(order);
+        free(tmpPath);
+        return false;
+    }
+
+    // Everything in the snapshot is in object ID and instance
+    // order, so that findObject() can search it
+    for (int x = 0; x < numObjects; x++) {
+        order[x].objectId = strtoul(objects[x]->_defObject->name, NULL, 10);
+        order[x].instance = objects[x]->_instance;
+        order[x].position = x;
+    }
+    qsort(order, numObjects, sizeof(SortEntry), compareSortEntries);
+
+    imageAdd(&image, sizeof(BlobHeader), sizeof(uint32_t));
+    imageAdd(&image, sizeof(SnapshotHeader), sizeof(uint32_t));
+    indexOffset = imageAdd(&image, numObjects * sizeof(BlobIndexEntry), sizeof(uint32_t));
+    valuesOffsetsOffset = imageAdd(&image, numObjects * sizeof(uint32_t), sizeof(uint32_t));
+
+    for (int x = 0; (x < numObjects) && !image.failed; x++) {
+        object = objects[order[x].position];
+        source = object->_defObject;
+
+        // The definition, as it is, except that it is for this
+        // instance and takes the hash the helper has already
+        // worked out; the pointers in it are filled in below
+        offset = imageAddBytes(&image, source, sizeof(*source), sizeof(void *));
+        if (!image.failed) {
+            entry = (BlobIndexEntry *) (image.data + indexOffset) + x;
+            entry->objectId = order[x].objectId;
+            entry->instance = order[x].instance;
+            entry->defObjectOffset = offset;
+            defObject = (M2MObjectHelper::DefObject *) (image.data + offset);
+            defObject->instance = object->_instance;
+            defObject->resourceOptions = NULL;
+            defObject->hash = NULL;
+            for (int y = 0; y < MAX_NUM_RESOURCES; y++) {
+                defObject->resources[y].format = NULL;
+            }
+        }
+#if RESOURCE_HASH
+        if (object->_hashValid) {
+            valuesOffset = imageAdd(&image, sizeof(M2MObjectHelper::DefObjectHash), sizeof(uint16_t));
+            if (!image.failed) {
+                memcpy(((M2MObjectHelper::DefObjectHash *) (image.data + valuesOffset))->displacement,
+                       object->_hashDisplacement, sizeof(object->_hashDisplacement));
+                memcpy(((M2MObjectHelper::DefObjectHash *) (image.data + valuesOffset))->index,
+                       object->_hashIndex, sizeof(object->_hashIndex));
+            }
+            imageSetPointer(&image, offset + offsetof(M2MObjectHelper::DefObject, hash), valuesOffset);
+        }
+#endif
+        for (int y = 0; y < source->numResources; y++) {
+            imageSetString(&image, offset + offsetof(M2MObjectHelper::DefObject, resources) +
+                           y * sizeof(M2MObjectHelper::DefResource) +
+                           offsetof(M2MObjectHelper::DefResource, format),
+                           source->resources[y].format);
+        }
+        if (source->resourceOptions != NULL) {
+            // The options, with everything they point to
+            optionsOffset = imageAddBytes(&image, source->resourceOptions,
+                                          source->numResources * sizeof(M2MObjectHelper::DefResourceOptions),
+                                          sizeof(void *));
+            imageSetPointer(&image, offset + offsetof(M2MObjectHelper::DefObject, resourceOptions),
+                            optionsOffset);
+            for (int y = 0; (y < source->numResources) && !image.failed; y++) {
+                options = &(source->resourceOptions[y]);
+                valuesOffset = optionsOffset + y * sizeof(M2MObjectHelper::DefResourceOptions);
+                copy = (M2MObjectHelper::DefResourceOptions *) (image.data + valuesOffset);
+                copy->enumValues = NULL;
+                copy->constValue = NULL;
+                copy->filePath = NULL;
+                imageSetString(&image, valuesOffset + offsetof(M2MObjectHelper::DefResourceOptions, constValue),
+                               options->constValue);
+                imageSetString(&image, valuesOffset + offsetof(M2MObjectHelper::DefResourceOptions, filePath),
+                               options->filePath);
+                if (options->enumValues != NULL) {
+                    enumOffset = imageAdd(&image, options->numEnumValues * sizeof(const char *), sizeof(void *));
+                    imageSetPointer(&image, valuesOffset + offsetof(M2MObjectHelper::DefResourceOptions, enumValues),
+                                    enumOffset);
+                    for (int z = 0; z < options->numEnumValues; z++) {
+                        imageSetString(&image, enumOffset + z * sizeof(const char *), options->enumValues[z]);
+                    }
+                }
+            }
+            numOptions++;
+        }
+
+        // The values, as text or, for OPAQUE, as bytes; constant
+        // values are in the options and the value of a file-backed
+        // resource is the file
+        valuesOffset = imageAdd(&image, source->numResources * sizeof(ValueEntry), sizeof(uint32_t));
+        if (!image.failed) {
+            ((uint32_t *) (image.data + valuesOffsetsOffset))[x] = valuesOffset;
+        }
+        for (int y = 0; y < source->numResources; y++) {
+            handle = object->_resourceStates[y].handle;
+            options = object->getResourceOptions(y);
+            value = NULL;
+            length = 0;
+            if ((handle == NULL) || (object->getConstValue(y) != NULL) ||
+                ((options != NULL) && (options->filePath != NULL))) {
+                // Nothing to save
+            } else if ((source->resources[y].type == M2MResourceBase::STRING) &&
+                       (object->getStringValue(y) != NULL)) {
+                value = object->getStringValue(y);
+                length = object->_resourceStates[y].stringLength;
+            } else if (handle->value() != NULL) {
+                value = (const char *) handle->value();
+                length = handle->value_length();
+            }
+            if (value != NULL) {
+                // Offset 0 means no value, which the header makes sure of
+                offset = imageAddBytes(&image, value, length, 1);
+                if (!image.failed) {
+                    valueEntry = (ValueEntry *) (image.data + valuesOffset) + y;
+                    valueEntry->offset = offset;
+                    valueEntry->length = length;
+                }
+                numValues++;
+            }
+        }
+    }
+
+    offset = imageAdd(&image, image.numRelocations * sizeof(uint32_t), sizeof(uint32_t));
+    if (!image.failed) {
+        memcpy(image.data + offset, image.relocations, image.numRelocations * sizeof(uint32_t));
+        header = (BlobHeader *) image.data;
+        memcpy(header->magic, "M2MS", sizeof(header->magic));
+        header->version = DEFINITION_BLOB_VERSION;
+        header->headerSize = sizeof(BlobHeader);
+        header->pointerSize = sizeof(void *);
+        header->defObjectSize = sizeof(M2MObjectHelper::DefObject);
+        header->defResourceSize = sizeof(M2MObjectHelper::DefResource);
+        header->defObjectHashSize = sizeof(M2MObjectHelper::DefObjectHash);
+        header->maxNumResources = MAX_NUM_RESOURCES;
+        header->maxNameLength = MAX_OBJECT_RESOURCE_NAME_LENGTH;
+        header->maxTypeLength = MAX_RESOURCE_TYPE_LENGTH;
+        if (numOptions > 0) {
+            header->defResourceOptionsSize = sizeof(M2MObjectHelper::DefResourceOptions);
+        }
+        header->numObjects = numObjects;
+        header->indexOffset = indexOffset;
+        header->numRelocations = image.numRelocations;
+        header->relocationsOffset = offset;
+        header->totalSize = image.size;
+        ((SnapshotHeader *) (image.data + sizeof(BlobHeader)))->valuesOffset = valuesOffsetsOffset;
+
+        // Write it under another name and rename it into place,
+        // so that there is always a whole snapshot to restart from
+        sprintf(tmpPath, "%s.tmp", path);
+        file = fopen(tmpPath, "wb");
+        if (file != NULL) {
+            success = (fwrite(image.data, 1, image.size, file) == image.size);
+            success = (fflush(file) == 0) && success;
+#ifdef __linux__
+            success = (fsync(fileno(file)) == 0) && success;
+#endif
+            success = (fclose(file) == 0) && success;
+            if (success) {
+                success = (rename(tmpPath, path) == 0);
+            }
+            if (!success) {
+                remove(tmpPath);
+            }
+        }
+    }
+
+    if (success) {
+        debug_if(debugOn, "M2MObjectSnapshot: saved %d object(s) (%d with options), %d value(s), %d byte(s), to \"%s\".\n",
+                 numObjects, (int) numOptions, (int) numValues, (int) image.size, path);
+    } else {
+        debug_if(debugOn, "M2MObjectSnapshot: unable to save snapshot to \"%s\".\n", path);
+    }
+
+    free(image.data);
+    free(image.relocations);
+    free(order);
+    free(tmpPath);
+
+    return success;
+}
+
+// Restore the values of an object from the snapshot.
+bool M2MObjectSnapshot::restore(M2MObjectHelper *object)
+{
+    bool success = false;
+    int position = findEntry(object);
+    const M2MObjectHelper::DefObject *defObject;
+    const M2MObjectHelper::DefResource *defResource;
+    const ValueEntry *values;
+    M2MResourceBase *handle;
+    const char *value;
+    int index;
+    int numRestored = 0;
+
+    if (position < 0) {
+        printfLog("M2MObjectSnapshot: object \"%s\", instance %d, is not in the snapshot.\n",
+                  object->_defObject->name, object->_instance);
+        return false;
+    }
+
+    defObject = getObject(position);
+    values = (const ValueEntry *) (_blob + ((const uint32_t *) (_blob +
+             ((const SnapshotHeader *) (_blob + sizeof(BlobHeader)))->valuesOffset))[position]);
+    success = true;
+    for (int x = 0; x < defObject->numResources; x++) {
+        if (values[x].offset == 0) {
+            continue;
+        }
+        defResource = &(defObject->resources[x]);
+        index = x;
+        if (object->_defObject != defObject) {
+            // Made from another definition, match by name
+            index = object->findResource(defResource->name, defResource->instance);
+        }
+        if ((index < 0) || (object->getConstValue(index) != NULL) ||
+            (object->_defObject->resources[index].type != defResource->type)) {
+            // Gone, constant or changed type: nothing to restore
+            continue;
+        }
+        value = (const char *) (_blob + values[x].offset);
+        handle = object->_resourceStates[index].handle;
+        if (defResource->type == M2MResourceBase::STRING) {
+            success = object->setStringValue(value, values[x].length, index) && success;
+        } else if (handle != NULL) {
+            success = object->setTextValue(value, values[x].length, index) && success;
+        } else {
+            success = false;
+        }
+        numRestored++;
+    }
+
+    printfLog("M2MObjectSnapshot: restored %d value(s) of object \"%s\", instance %d.\n",
+              numRestored, object->_defObject->name, object->_instance);
+
+    return success;
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Check that the snapshot is one we understand.
+bool M2MObjectSnapshot::check()
+{
+    const SnapshotHeader *snapshotHeader;
+    const uint32_t *valuesOffsets;
+    const ValueEntry *values;
+    const M2MObjectHelper::DefObject *defObject;
+    uint32_t numObjects;
+
+    if (!M2MDefinitionBlob::check() ||
+        (_size < sizeof(BlobHeader) + sizeof(SnapshotHeader))) {
+        return false;
+    }
+
+    // The values must stay inside the snapshot too
+    numObjects = ((const BlobHeader *) _blob)->numObjects;
+    snapshotHeader = (const SnapshotHeader *) (_blob + sizeof(BlobHeader));
+    if ((snapshotHeader->valuesOffset % sizeof(uint32_t) != 0) ||
+        (snapshotHeader->valuesOffset > _size) ||
+        (numObjects > (_size - snapshotHeader->valuesOffset) / sizeof(uint32_t))) {
+        return false;
+    }
+    valuesOffsets = (const uint32_t *) (_blob + snapshotHeader->valuesOffset);
+    for (uint32_t x = 0; x < numObjects; x++) {
+        defObject = (const M2MObjectHelper::DefObject *) (_blob + _index[x].defObjectOffset);
+        if ((valuesOffsets[x] % sizeof(uint32_t) != 0) || (valuesOffsets[x] > _size) ||
+            ((uint32_t) defObject->numResources > (_size - valuesOffsets[x]) / sizeof(ValueEntry))) {
+            return false;
+        }
+        values = (const ValueEntry *) (_blob + valuesOffsets[x]);
+        for (int y = 0; y < defObject->numResources; y++) {
+            if ((values[y].offset > _size) || (values[y].length > _size - values[y].offset)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Find the position of an object in the snapshot.
+int M2MObjectSnapshot::findEntry(M2MObjectHelper *object)
+{
+    const M2MObjectHelper::DefObject *defObject = object->_defObject;
+    uint32_t objectId = strtoul(defObject->name, NULL, 10);
+    int position;
+
+    if ((_blob == NULL) || ((const uint8_t *) defObject < _blob) ||
+        ((const uint8_t *) defObject >= _blob + _size)) {
+        // Made from another definition, go by name and instance
+        return findPosition(objectId, object->_instance);
+    }
+
+    // Made from a definition in the snapshot, which is the one,
+    // though there may be others with the same ID and instance
+    position = findPosition(objectId, defObject->instance);
+    while ((position > 0) && (_index[position - 1].objectId == objectId) &&
+           (_index[position - 1].instance == defObject->instance)) {
+        position--;
+    }
+    while ((position >= 0) && (position < getNumObjects()) &&
+           (_index[position].objectId == objectId) &&
+           (_index[position].instance == defObject->instance)) {
+        if (getObject(position) == defObject) {
+            return position;
+        }
+        position++;
+    }
+
+    return -1;
+}
+
+// End of file
@@ -0,0 +1,143 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_SNAPSHOT_
+#define _M2M_OBJECT_HELPER_SNAPSHOT_
+
+#include "m2m_object_helper_blob.h"
+
+/** This class saves a set of objects made with M2MObjectHelper, their
+ * definitions and their current values, to a single file from which
+ * the set can be made again quickly when the process restarts.
+ *
+ * OVERVIEW
+ *
+ * A snapshot is a definition blob (see m2m_object_helper_blob.h) with
+ * a different magic, "M2MS", and with the current value of every
+ * resource added.  It holds one definition per object instance,
+ * complete with the perfect hash of its resources as the helper worked
+ * it out, so on restart nothing about the definitions is processed
+ * again, and each value as the text held by Mbed Client, so the values
+ * are handed straight back to Mbed Client rather than being restored
+ * (and formatted) by the application.  What cannot be saved is Mbed
+ * Client's own object tree: the objects must still be created, but
+ * that is all.
+ *
+ * Save the set, e.g. when shutting down or after a change:
+ *
+ * M2MObjectSnapshot::save("/var/lib/gateway/objects.snap", objects, numObjects);
+ *
+ * ...and on restart open the snapshot, make an object from each of its
+ * definitions and restore its values:
+ *
+ * M2MObjectSnapshot snapshot;
+ * if (snapshot.open("/var/lib/gateway/objects.snap")) {
+ *     for (int x = 0; x < snapshot.getNumObjects(); x++) {
+ *         object = new GenericObject(snapshot.getObject(x), parent);
+ *         snapshot.restore(object);
+ *         ...
+ *
+ * The definitions are in order of object ID and then instance, so the
+ * instances of an object are together; pass the M2MObject of the first
+ * to the others as usual.  restore() also works for an object made
+ * from the application's own definition, in which case the values are
+ * found by object name and instance.
+ *
+ * Definitions are saved with their resourceOptions (constant values,
+ * enumerations, file paths, staleness limits and inline sizes), so an
+ * object made from the snapshot behaves as the original did.  The value
+ * of a constant or file-backed resource is not saved, being in the
+ * options or the file already; OPAQUE values held by Mbed Client are
+ * saved as bytes, so bear in mind their size.  restore() hands each
+ * value back to Mbed Client with set_value(), one resource at a time.
+ * As with a definition blob, the snapshot must stay open while any
+ * object made from it exists, and is refused if it was saved by a
+ * build with different structure sizes.
+ * save() writes the file under a temporary name and renames it into
+ * place, so a crash while saving leaves the previous snapshot intact.
+ */
+class M2MObjectSnapshot : public M2MDefinitionBlob {
+public:
+
+    /** Constructor.
+     *
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MObjectSnapshot(bool debugOn = false);
+
+    /** Save a set of objects to a snapshot file.
+     *
+     * @param path        the path of the file.
+     * @param objects     the objects, each of which must have
+     *                    been made.
+     * @param numObjects  the number of entries in objects.
+     * @param debugOn     true to switch debug prints on,
+     *                    otherwise false.
+     * @return            true if successful, otherwise false.
+     */
+    static bool save(const char *path, M2MObjectHelper * const *objects,
+                     int numObjects, bool debugOn = false);
+
+    /** Restore the values of an object from the snapshot.
+     *
+     * @param object  an object made from one of the
+     *                definitions in the snapshot, or from a
+     *                definition with the same object name
+     *                and instance.
+     * @return        true if all values were restored,
+     *                otherwise false.
+     */
+    bool restore(M2MObjectHelper *object);
+
+protected:
+
+    /** The snapshot header, which follows the BlobHeader.
+     */
+    typedef struct {
+        uint32_t valuesOffset;      ///< the offset of an array of uint32_t,
+                                    /// one per BlobIndexEntry, each the
+                                    /// offset of the ValueEntry array for
+                                    /// that object.
+        uint32_t reserved;          ///< 0.
+    } SnapshotHeader;
+
+    /** The saved value of a resource.
+     */
+    typedef struct {
+        uint32_t offset;            ///< the offset of the value, 0 if
+                                    /// there is none.
+        uint32_t length;            ///< the length of the value.
+    } ValueEntry;
+
+    /** Check that the snapshot is one we understand
+     * and that everything in it stays within it.
+     *
+     * @return  true if the snapshot is good, otherwise false.
+     */
+    virtual bool check();
+
+    /** Find the position of an object in the snapshot.
+     *
+     * @param object  the object.
+     * @return        the position, -1 if it is not there.
+     */
+    int findEntry(M2MObjectHelper *object);
+};
+
+#endif // _M2M_OBJECT_HELPER_SNAPSHOT_
+
+// End of file
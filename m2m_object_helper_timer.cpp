@@ -0,0 +1,213 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "m2m_object_helper_timer.h"
+
+#define printfLog(format, ...) debug_if(_debugOn, format, ## __VA_ARGS__)
+
+/** The mask of a slot index.
+ */
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/**********************************************************************
+ * STATIC FUNCTIONS
+ **********************************************************************/
+
+// Put a link on the end of a list.
+static void link(M2MTimerWheel::TimerLink *list, M2MTimerWheel::TimerLink *item)
+{
+    item->next = list;
+    item->prev = list->prev;
+    list->prev->next = item;
+    list->prev = item;
+}
+
+// Take a link off its list.
+static void unlink(M2MTimerWheel::TimerLink *item)
+{
+    item->prev->next = item->next;
+    item->next->prev = item->prev;
+    item->next = NULL;
+    item->prev = NULL;
+}
+
+/**********************************************************************
+ * PUBLIC METHODS
+ **********************************************************************/
+
+// Constructor.
+M2MTimerWheel::M2MTimerWheel(uint32_t tickMs, bool debugOn)
+{
+    _debugOn = debugOn;
+    _tickMs = (tickMs > 0) ? tickMs : 1;
+    _ticks = 0;
+    _numRunning = 0;
+    for (int x = 0; x < TIMER_WHEEL_LEVELS; x++) {
+        for (int y = 0; y < TIMER_WHEEL_SLOTS; y++) {
+            _slots[x][y].next = &(_slots[x][y]);
+            _slots[x][y].prev = &(_slots[x][y]);
+        }
+    }
+}
+
+// Destructor.
+M2MTimerWheel::~M2MTimerWheel()
+{
+    for (int x = 0; x < TIMER_WHEEL_LEVELS; x++) {
+        for (int y = 0; y < TIMER_WHEEL_SLOTS; y++) {
+            while (_slots[x][y].next != &(_slots[x][y])) {
+                unlink(_slots[x][y].next);
+            }
+        }
+    }
+}
+
+// Initialise a timer.
+void M2MTimerWheel::init(Timer *timer, void (*callback)(void *), void *context)
+{
+    timer->link.next = NULL;
+    timer->link.prev = NULL;
+    timer->expiry = 0;
+    timer->callback = callback;
+    timer->context = context;
+}
+
+// Start a timer.
+void M2MTimerWheel::start(Timer *timer, uint32_t ms)
+{
+    uint32_t ticks = (ms / _tickMs) + ((ms % _tickMs) != 0);
+
+    stop(timer);
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    timer->expiry = _ticks + ticks;
+    insert(timer);
+    _numRunning++;
+}
+
+// Stop a timer.
+void M2MTimerWheel::stop(Timer *timer)
+{
+    if (timer->link.prev != NULL) {
+        unlink(&(timer->link));
+        _numRunning--;
+    }
+}
+
+// Find out whether a timer is running.
+bool M2MTimerWheel::isRunning(const Timer *timer)
+{
+    return timer->link.prev != NULL;
+}
+
+// Advance the wheel.
+int M2MTimerWheel::tick(uint32_t numTicks)
+{
+    TimerLink list;
+    Timer *timer;
+    int numExpired = 0;
+
+    for (uint32_t x = 0; x < numTicks; x++) {
+        _ticks++;
+
+        // Each ring that has come round to its first slot
+        // empties the next slot of the ring above into the
+        // rings below; the timers taken are all due before
+        // that ring comes round again
+        for (int level = 1; (level < TIMER_WHEEL_LEVELS) &&
+                            ((_ticks & ((1UL << (level * TIMER_WHEEL_BITS)) - 1)) == 0); level++) {
+            take(&(_slots[level][(_ticks >> (level * TIMER_WHEEL_BITS)) & SLOT_MASK]), &list);
+            while (list.next != &list) {
+                timer = (Timer *) list.next;
+                unlink(&(timer->link));
+                insert(timer);
+            }
+        }
+
+        // Taken off first so that a callback starting a
+        // timer can't put it on the list being worked through
+        take(&(_slots[0][_ticks & SLOT_MASK]), &list);
+        while (list.next != &list) {
+            timer = (Timer *) list.next;
+            unlink(&(timer->link));
+            if (timer->expiry == _ticks) {
+                _numRunning--;
+                numExpired++;
+                timer->callback(timer->context);
+            } else {
+                // Beyond the reach of the wheel when started
+                insert(timer);
+            }
+        }
+    }
+
+    return numExpired;
+}
+
+// Get the time according to the wheel.
+uint32_t M2MTimerWheel::getTime()
+{
+    return _ticks * _tickMs;
+}
+
+// Get the number of timers running.
+int M2MTimerWheel::getNumRunning()
+{
+    return _numRunning;
+}
+
+/**********************************************************************
+ * PROTECTED METHODS
+ **********************************************************************/
+
+// Put a running timer on the list for its expiry.
+void M2MTimerWheel::insert(Timer *timer)
+{
+    uint64_t delta = timer->expiry - _ticks;
+    uint32_t expiry = timer->expiry;
+    int level = 0;
+
+    // The finest ring whose slots the delay is within a turn of
+    while ((level < TIMER_WHEEL_LEVELS - 1) &&
+           (delta >= ((uint64_t) 1 << ((level + 1) * TIMER_WHEEL_BITS)))) {
+        level++;
+    }
+    if (delta >= ((uint64_t) 1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS))) {
+        // Too far away, wait as long as the outermost ring can
+        expiry = _ticks + (uint32_t) (((uint64_t) 1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1);
+    }
+    link(&(_slots[level][(expiry >> (level * TIMER_WHEEL_BITS)) & SLOT_MASK]), &(timer->link));
+}
+
+// Move all of the timers on a list to a list of their own.
+void M2MTimerWheel::take(TimerLink *list, TimerLink *to)
+{
+    if (list->next == list) {
+        to->next = to;
+        to->prev = to;
+    } else {
+        to->next = list->next;
+        to->prev = list->prev;
+        to->next->prev = to;
+        to->prev->next = to;
+        list->next = list;
+        list->prev = list;
+    }
+}
+
+// End of file
@@ -0,0 +1,199 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _M2M_OBJECT_HELPER_TIMER_
+#define _M2M_OBJECT_HELPER_TIMER_
+
+/** This class runs any number of timers, e.g. one or more per
+ * resource, from a single tick, with no allocation and no per-timer
+ * RTOS timer.
+ *
+ * OVERVIEW
+ *
+ * The wheel is TIMER_WHEEL_LEVELS rings of TIMER_WHEEL_SLOTS lists
+ * each, a slot of the first ring covering one tick, a slot of the
+ * second a whole turn of the first, and so on, like the hands of a
+ * clock.  A timer goes on the list of the ring whose slots are just
+ * finer than the time until it is due, so starting one is working out
+ * a ring and a slot and putting it on the end of a list.  Each tick
+ * expires the timers on one list of the first ring; when a ring comes
+ * round to its first slot the next slot of the ring above is emptied
+ * into the rings below, so a timer is moved at most once per ring
+ * whatever its delay.  A timer due further away than the wheel covers
+ * (2 ^ (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS) ticks) waits in the
+ * outermost ring and is put back there until it is in range.  A Timer
+ * is a structure owned by the user of the wheel, e.g. embedded in
+ * something else, so starting and stopping one never allocates and
+ * stopping one is just taking it off its list.
+ *
+ * Call tick() every tickMs milliseconds from one place, e.g. an
+ * EventQueue or a Ticker deferred to thread context; expiry callbacks
+ * are called from tick().  The wheel is not thread-safe: start and
+ * stop timers from the same context as tick().
+ *
+ * One wheel is meant to carry every per-resource deadline of an
+ * application: M2MObjectHelper, given the wheel with setTimerWheel(),
+ * uses it to spot resources which have not been updated for longer
+ * than their maxUpdateIntervalMs, and the same wheel, from
+ * M2MObjectHelper::getTimerWheel(), can take rate limits, heartbeats,
+ * debounce windows, cache lifetimes etc.
+ */
+class M2MTimerWheel {
+public:
+
+    /** The number of bits of the tick count covered
+     * by each ring of the wheel.
+     */
+#   ifndef TIMER_WHEEL_BITS
+#   define TIMER_WHEEL_BITS 6
+#   endif
+
+    /** The number of rings in the wheel; TIMER_WHEEL_BITS
+     * times this must be no more than 32.
+     */
+#   ifndef TIMER_WHEEL_LEVELS
+#   define TIMER_WHEEL_LEVELS 4
+#   endif
+
+    /** The number of slots in each ring of the wheel.
+     */
+#   define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+
+    /** The links of a list of timers.
+     */
+    typedef struct TimerLink {
+        struct TimerLink *next;      ///< the next in the list.
+        struct TimerLink *prev;      ///< the previous in the list, NULL
+                                     /// if not in a list.
+    } TimerLink;
+
+    /** A timer; initialise it with init() before use.
+     */
+    typedef struct {
+        TimerLink link;              ///< must be first.
+        uint32_t expiry;             ///< the tick at which it expires.
+        void (*callback)(void *);    ///< called, with context, on expiry.
+        void *context;               ///< passed to callback.
+    } Timer;
+
+    /** Constructor.
+     *
+     * @param tickMs   the period at which tick() will be
+     *                 called, in milliseconds.
+     * @param debugOn  true to switch debug prints on,
+     *                 otherwise false.
+     */
+    M2MTimerWheel(uint32_t tickMs, bool debugOn = false);
+
+    /** Destructor; stops any timers still running.
+     */
+    ~M2MTimerWheel();
+
+    /** Initialise a timer.
+     *
+     * @param timer     the timer.
+     * @param callback  the function to call when it
+     *                  expires.
+     * @param context   passed to callback.
+     */
+    static void init(Timer *timer, void (*callback)(void *), void *context);
+
+    /** Start a timer, restarting it if it is running.
+     *
+     * @param timer  the timer.
+     * @param ms     the time until it expires, in
+     *               milliseconds, rounded up to ticks;
+     *               0 expires it on the next tick.
+     */
+    void start(Timer *timer, uint32_t ms);
+
+    /** Stop a timer; does nothing if it is not running.
+     *
+     * @param timer  the timer.
+     */
+    void stop(Timer *timer);
+
+    /** Find out whether a timer is running.
+     *
+     * @param timer  the timer.
+     * @return       true if it is running, otherwise false.
+     */
+    static bool isRunning(const Timer *timer);
+
+    /** Advance the wheel, calling the callbacks of any
+     * timers that expire.
+     *
+     * @param numTicks  the number of ticks to advance by,
+     *                  more than 1 to catch up if the
+     *                  tick source was held up.
+     * @return          the number of timers that expired.
+     */
+    int tick(uint32_t numTicks = 1);
+
+    /** Get the time according to the wheel: the number
+     * of ticks so far times tickMs.  It wraps.
+     *
+     * @return  the time in milliseconds.
+     */
+    uint32_t getTime();
+
+    /** Get the number of timers running.
+     *
+     * @return  the number of timers.
+     */
+    int getNumRunning();
+
+protected:
+
+    /** Put a running timer on the list for its expiry.
+     *
+     * @param timer  the timer.
+     */
+    void insert(Timer *timer);
+
+    /** Move all of the timers on a list to a list of
+     * their own.
+     *
+     * @param list  the list to empty.
+     * @param to    the list to move them to.
+     */
+    static void take(TimerLink *list, TimerLink *to);
+
+    /** True if debug is on, otherwise false.
+     */
+    bool _debugOn;
+
+    /** The period of a tick in milliseconds.
+     */
+    uint32_t _tickMs;
+
+    /** The number of ticks so far.
+     */
+    uint32_t _ticks;
+
+    /** The number of timers running.
+     */
+    int _numRunning;
+
+    /** The head of the list for each slot of each ring,
+     * the lists being circular.
+     */
+    TimerLink _slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+#endif // _M2M_OBJECT_HELPER_TIMER_
+
+// End of file
@@ -0,0 +1,392 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Accelerated churn of the objects of a gateway, with and without an
+ * M2MObjectPool per object definition: 2000 sensors of three kinds join
+ * and leave at random, now and then setting a STRING value too long to
+ * be held inline, while the application allocates and frees blocks of
+ * its own.  Each "day" is 200,000 joins; at the end of each the state
+ * of the heap is printed, and with pools the reuse statistics are
+ * printed at the end, along with the time the joins took.  With pools, the sensors are created with
+ * M2MObjectPool::make() and deleted with M2MObjectPool::destroy().
+ *
+ * The heap is either glibc's, which bins blocks by size, or a simple
+ * address-ordered first-fit heap of the kind found in small embedded C
+ * libraries, which takes everything allocated with new and the
+ * application's blocks (the stand-in's copies of resource values,
+ * which it allocates with malloc(), stay in glibc's heap).  For the
+ * first-fit heap "free" is the space below the top of the heap that is
+ * not in use and "largest" the largest block that could be allocated
+ * from it.  From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/churn.cpp m2m_object_helper*.cpp -lpthread -o churn
+ * ./churn <days> <0 for the heap, 1 for pools> <0 for glibc, 1 for first-fit>
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_pool.h"
+#include <assert.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NUM_SENSORS 2000
+#define NUM_JOINS_PER_DAY 200000
+#define NUM_APPLICATION_BLOCKS 500
+
+#define FIRST_FIT_HEAP_SIZE (64 << 20)
+#define FIRST_FIT_ALIGN 16
+
+static const char *typeNames[] = {"helper", "strings", "spill"};
+
+// The first-fit heap: a block of either sort starts with its size,
+// header included; a free block also holds the next free block, the
+// free list being kept in address order so that neighbours can be
+// merged.
+typedef struct FreeChunk {
+    size_t size;
+    struct FreeChunk *next;
+} FreeChunk;
+
+static bool useFirstFit = false;
+static char *firstFitHeap = NULL;
+static size_t firstFitTop = 0;
+static FreeChunk *firstFitFree = NULL;
+
+static void *firstFitAllocate(size_t size)
+{
+    FreeChunk **link = &firstFitFree;
+    FreeChunk *chunk;
+    FreeChunk *rest;
+
+    size = (size + FIRST_FIT_ALIGN + FIRST_FIT_ALIGN - 1) & ~((size_t) FIRST_FIT_ALIGN - 1);
+    while ((*link != NULL) && ((*link)->size < size)) {
+        link = &((*link)->next);
+    }
+    chunk = *link;
+    if (chunk != NULL) {
+        if (chunk->size >= size + sizeof(FreeChunk) + FIRST_FIT_ALIGN) {
+            rest = (FreeChunk *) ((char *) chunk + size);
+            rest->size = chunk->size - size;
+            rest->next = chunk->next;
+            *link = rest;
+            chunk->size = size;
+        } else {
+            *link = chunk->next;
+        }
+    } else {
+        if (firstFitTop + size > FIRST_FIT_HEAP_SIZE) {
+            return NULL;
+        }
+        chunk = (FreeChunk *) (firstFitHeap + firstFitTop);
+        chunk->size = size;
+        firstFitTop += size;
+    }
+
+    return (char *) chunk + FIRST_FIT_ALIGN;
+}
+
+static void firstFitFreeBlock(void *memory)
+{
+    FreeChunk *chunk = (FreeChunk *) ((char *) memory - FIRST_FIT_ALIGN);
+    FreeChunk **link = &firstFitFree;
+    FreeChunk **previousLink = NULL;
+    FreeChunk *previous;
+
+    while ((*link != NULL) && (*link < chunk)) {
+        previousLink = link;
+        link = &((*link)->next);
+    }
+    // Put it in the list, merging it with the next free block
+    chunk->next = *link;
+    if ((chunk->next != NULL) && ((char *) chunk + chunk->size == (char *) chunk->next)) {
+        chunk->size += chunk->next->size;
+        chunk->next = chunk->next->next;
+    }
+    *link = chunk;
+    // and with the previous one
+    if (previousLink != NULL) {
+        previous = *previousLink;
+        if ((char *) previous + previous->size == (char *) chunk) {
+            previous->size += chunk->size;
+            previous->next = chunk->next;
+            chunk = previous;
+            link = previousLink;
+        }
+    }
+    // A free block at the top, which must be the last, comes off the heap
+    if ((char *) chunk + chunk->size == firstFitHeap + firstFitTop) {
+        firstFitTop -= chunk->size;
+        *link = NULL;
+    }
+}
+
+static bool inFirstFitHeap(void *memory)
+{
+    return (firstFitHeap != NULL) && ((char *) memory >= firstFitHeap) &&
+           ((char *) memory < firstFitHeap + FIRST_FIT_HEAP_SIZE);
+}
+
+static void *allocate(size_t size)
+{
+    void *memory = useFirstFit ? firstFitAllocate(size) : malloc(size);
+
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+static void release(void *memory)
+{
+    if (inFirstFitHeap(memory)) {
+        firstFitFreeBlock(memory);
+    } else {
+        free(memory);
+    }
+}
+
+void *operator new(size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void *memory, size_t size) noexcept
+{
+    (void) size;
+    release(memory);
+}
+
+void operator delete[](void *memory, size_t size) noexcept
+{
+    (void) size;
+    release(memory);
+}
+
+static double now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+static void printHeap(int day)
+{
+    struct mallinfo2 info;
+    size_t free = 0;
+    size_t largest = 0;
+    size_t numChunks = 0;
+
+    if (useFirstFit) {
+        for (FreeChunk *chunk = firstFitFree; chunk != NULL; chunk = chunk->next) {
+            free += chunk->size;
+            if (chunk->size > largest) {
+                largest = chunk->size;
+            }
+            numChunks++;
+        }
+        printf("day %d: heap %zu kB, in use %zu kB, free %zu kB in %zu chunk(s),"
+               " largest %zu kB, fragmentation %.1f%%\n", day, firstFitTop / 1024,
+               (firstFitTop - free) / 1024, free / 1024, numChunks, largest / 1024,
+               (firstFitTop > 0) ? 100.0 * free / firstFitTop : 0);
+    } else {
+        info = mallinfo2();
+        printf("day %d: heap %zu kB, in use %zu kB, free %zu kB in %zu chunk(s),"
+               " fragmentation %.1f%%\n", day, info.arena / 1024,
+               info.uordblks / 1024, info.fordblks / 1024, info.ordblks,
+               100.0 * info.fordblks / info.arena);
+    }
+}
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor(const DefObject *defObject, M2MObjectPool *pool,
+           Sensor *prototype = NULL, int instance = 0) : M2MObjectHelper(defObject) {
+        if (pool != NULL) {
+            assert(setPool(pool));
+        }
+        if (prototype != NULL) {
+            assert(makeObject(prototype, instance));
+        } else {
+            assert(makeObject());
+        }
+    }
+    bool set(const char *value, const char *resourceNumber) {
+        return setResourceValue(value, resourceNumber);
+    }
+    static const DefResourceOptions _options0[];
+    static const DefResourceOptions _options1[];
+    static const DefObject _defObjects[];
+};
+
+const M2MObjectHelper::DefResourceOptions Sensor::_options0[] =
+    {{40, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {100, NULL, 0, NULL, NULL, 0}};
+const M2MObjectHelper::DefResourceOptions Sensor::_options1[] =
+    {{200, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {64, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0}};
+const M2MObjectHelper::DefObject Sensor::_defObjects[] = {
+    {0, "3303", 4,
+        {{-1, "5700", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5701", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5702", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5703", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL}},
+     _options0, NULL},
+    {0, "3304", 4,
+        {{-1, "5700", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5701", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5702", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5703", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL}},
+     _options1, NULL},
+    {0, "3305", 2,
+        {{-1, "5700", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5701", "t", M2MResourceBase::BOOLEAN, true, M2MBase::GET_PUT_ALLOWED, NULL}},
+     NULL, NULL}
+};
+
+#define NUM_DEF_OBJECTS 3
+
+// Create a sensor from its pool with make() or, without pools, with new.
+static Sensor *makeSensor(M2MObjectPool *pool, int d, Sensor *prototype = NULL, int instance = 0)
+{
+    if (pool != NULL) {
+        return M2MObjectPool::make<Sensor>(pool, &Sensor::_defObjects[d], pool, prototype, instance);
+    }
+
+    return new Sensor(&Sensor::_defObjects[d], pool, prototype, instance);
+}
+
+static void deleteSensor(M2MObjectPool *pool, Sensor *sensor)
+{
+    if (pool != NULL) {
+        M2MObjectPool::destroy(sensor);
+    } else {
+        delete sensor;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int numDays = (argc > 1) ? atoi(argv[1]) : 7;
+    bool usePools = (argc > 2) && (atoi(argv[2]) != 0);
+    M2MObjectPool *sensorPools[NUM_SENSORS];
+    M2MObjectPool *pools[NUM_DEF_OBJECTS];
+    Sensor *prototypes[NUM_DEF_OBJECTS];
+    Sensor *sensors[NUM_SENSORS];
+    char *blocks[NUM_APPLICATION_BLOCKS];
+    M2MObjectPool::Stats stats;
+    double seconds = 0;
+    double start;
+    int instance = 1;
+    int x;
+    int d;
+
+    if ((argc > 3) && (atoi(argv[3]) != 0)) {
+        firstFitHeap = (char *) malloc(FIRST_FIT_HEAP_SIZE);
+        assert(firstFitHeap != NULL);
+        useFirstFit = true;
+    }
+    printf("%s, %s\n", usePools ? "pools" : "no pools", useFirstFit ? "first-fit heap" : "glibc heap");
+
+    srand(1);
+    for (d = 0; d < NUM_DEF_OBJECTS; d++) {
+        pools[d] = usePools ? new M2MObjectPool(8, 64) : NULL;
+        // The prototypes keep the M2MObject of each definition alive
+        prototypes[d] = makeSensor(pools[d], d);
+    }
+    for (x = 0; x < NUM_SENSORS; x++) {
+        sensors[x] = NULL;
+        sensorPools[x] = NULL;
+    }
+    for (x = 0; x < NUM_APPLICATION_BLOCKS; x++) {
+        blocks[x] = NULL;
+    }
+
+    for (int day = 0; day < numDays; day++) {
+        start = now();
+        for (int join = 0; join < NUM_JOINS_PER_DAY; join++) {
+            x = rand() % NUM_SENSORS;
+            deleteSensor(sensorPools[x], sensors[x]);
+            d = rand() % NUM_DEF_OBJECTS;
+            sensors[x] = makeSensor(pools[d], d, prototypes[d], instance);
+            sensorPools[x] = pools[d];
+            instance = (instance % 60000) + 1;
+            if (rand() % 8 == 0) {
+                sensors[x]->set("a rather longer string than usual, long enough "
+                                "that it cannot be held inline", "5700");
+            }
+            x = rand() % NUM_APPLICATION_BLOCKS;
+            delete[] blocks[x];
+            blocks[x] = new char[16 + (rand() % 512)];
+        }
+        seconds += now() - start;
+        printHeap(day + 1);
+    }
+    printf("%d joins in %.1f s\n", numDays * NUM_JOINS_PER_DAY, seconds);
+
+    for (x = 0; x < NUM_SENSORS; x++) {
+        deleteSensor(sensorPools[x], sensors[x]);
+    }
+    for (d = 0; d < NUM_DEF_OBJECTS; d++) {
+        deleteSensor(pools[d], prototypes[d]);
+        if (pools[d] != NULL) {
+            for (int t = 0; t < M2MObjectPool::MAX_NUM_BLOCK_TYPES; t++) {
+                pools[d]->getStats(&stats, (M2MObjectPool::BlockType) t);
+                if (stats.numTaken > 0) {
+                    printf("pool %d %-7s: %4u byte block(s), taken %u, reused %.1f%%,"
+                           " allocated %u, released %u, peak in use %d\n", d,
+                           typeNames[t], stats.blockSize, stats.numTaken,
+                           100.0 * stats.numReused / stats.numTaken,
+                           stats.numAllocated, stats.numReleased, stats.peakInUse);
+                }
+                assert(stats.numInUse == 0);
+            }
+            delete pools[d];
+        }
+    }
+    for (x = 0; x < NUM_APPLICATION_BLOCKS; x++) {
+        delete[] blocks[x];
+    }
+
+    return 0;
+}
+
+// End of file
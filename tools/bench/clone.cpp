@@ -0,0 +1,242 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark and check of making objects as clones of a prototype
+ * (the makeObject(prototype, instance, stringStorage) version of
+ * makeObject()): checks that a clone is a new instance of the
+ * prototype's LWM2M object with STRING storage of its own, then
+ * onboards 2000 devices of 12 objects of 8 resources each, once with
+ * a plain makeObject() per object and once by cloning a prototype set
+ * into one STRING allocation per device, and reports devices per
+ * second for each.  From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/clone.cpp m2m_object_helper*.cpp -lpthread -o clone
+ * ./clone
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#define NUM_OBJECTS_PER_DEVICE 12
+#define NUM_DEVICES 2000
+#define NUM_RUNS 5
+
+class Generic : public M2MObjectHelper {
+public:
+    // Object number x of a device, from the definition for the given
+    // instance, or from the prototype's definition if instance is 0.
+    Generic(int x, int instance = 0, M2MObject *object = NULL) :
+            M2MObjectHelper((instance == 0) ? _defObjects[x] :
+                            _instanceDefObjects[(instance - 1) * NUM_OBJECTS_PER_DEVICE + x],
+                            NULL, object) {}
+    bool make() {
+        return makeObject();
+    }
+    bool clone(const Generic *prototype, int instance, char *stringStorage = NULL) {
+        return makeObject(prototype, instance, stringStorage);
+    }
+    bool setString(const char *value, const char *resourceNumber) {
+        return setResourceValue(value, resourceNumber);
+    }
+    bool getString(String *value, const char *resourceNumber) {
+        return getResourceValue(value, resourceNumber);
+    }
+    bool setInteger(int64_t value, const char *resourceNumber) {
+        return setResourceValue(value, resourceNumber);
+    }
+    static const DefObject *makeDefinition(int objectNumber, int instance);
+    static void makeDefinitions();
+    static void freeDefinitions();
+    static const DefResource _resources[];
+    static const DefObject *_defObjects[NUM_OBJECTS_PER_DEVICE];
+    static std::vector<const DefObject *> _instanceDefObjects;
+};
+
+const M2MObjectHelper::DefObject *Generic::_defObjects[NUM_OBJECTS_PER_DEVICE];
+std::vector<const M2MObjectHelper::DefObject *> Generic::_instanceDefObjects;
+
+// Eight resources, a mixture of STRING, INTEGER and FLOAT.
+const M2MObjectHelper::DefResource Generic::_resources[] =
+    {{-1, "5700", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5701", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5702", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5703", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5704", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5705", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5706", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5707", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL}};
+
+// Make a definition of object 3300 + objectNumber with the given
+// instance; without cloning, each instance needs one.
+const M2MObjectHelper::DefObject *Generic::makeDefinition(int objectNumber, int instance)
+{
+    DefObject *defObject = (DefObject *) malloc(sizeof(DefObject));
+
+    memset((void *) defObject, 0, sizeof(DefObject));
+    defObject->instance = instance;
+    snprintf((char *) defObject->name, sizeof(defObject->name), "%d", 3300 + (objectNumber % 100));
+    defObject->numResources = sizeof(_resources) / sizeof(_resources[0]);
+    memcpy((void *) defObject->resources, _resources, sizeof(_resources));
+
+    return defObject;
+}
+
+// Make the definitions of the prototypes and, since without cloning
+// each instance needs one, of every instance of every device.
+void Generic::makeDefinitions()
+{
+    for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+        _defObjects[x] = makeDefinition(x, 0);
+    }
+    for (int device = 0; device < NUM_DEVICES; device++) {
+        for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+            _instanceDefObjects.push_back(makeDefinition(x, device + 1));
+        }
+    }
+}
+
+void Generic::freeDefinitions()
+{
+    for (unsigned int x = 0; x < _instanceDefObjects.size(); x++) {
+        free((void *) _instanceDefObjects[x]);
+    }
+    for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+        free((void *) _defObjects[x]);
+    }
+}
+
+static double now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+int main()
+{
+    Generic *prototypes[NUM_OBJECTS_PER_DEVICE];
+    std::vector<Generic *> objects;
+    std::vector<char *> stringStorage;
+    double plainSeconds = 0;
+    double cloneSeconds = 0;
+    double start;
+    int deviceStringStorageSize = 0;
+    int offset;
+    Generic *object;
+    String value;
+
+    Generic::makeDefinitions();
+    for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+        prototypes[x] = new Generic(x);
+        assert(prototypes[x]->make());
+        deviceStringStorageSize += prototypes[x]->getStringStorageSize();
+    }
+
+    // A clone is a new instance of the same object, with STRING storage of its own
+    {
+        char *storage = new char[prototypes[0]->getStringStorageSize()];
+        Generic clone(0);
+        Generic cloneOwnStorage(0);
+        Generic wrongPrototype(1);
+
+        assert(clone.clone(prototypes[0], 1, storage));
+        assert(clone.getObject() == prototypes[0]->getObject());
+        assert(prototypes[0]->getObject()->instance_count() == 2);
+        assert(clone.setString("hello", "5700"));
+        assert(prototypes[0]->setString("world", "5700"));
+        assert(clone.getString(&value, "5700") && (value == "hello"));
+        assert(prototypes[0]->getString(&value, "5700") && (value == "world"));
+        assert(clone.setInteger(3, "5701"));
+        assert(!wrongPrototype.clone(prototypes[0], 2));
+        assert(cloneOwnStorage.clone(prototypes[0], 3));
+        assert(cloneOwnStorage.setString("again", "5700"));
+        assert(clone.getString(&value, "5700") && (value == "hello"));
+        delete[] storage;
+    }
+    printf("clone check OK\n");
+
+    objects.reserve(NUM_DEVICES * NUM_OBJECTS_PER_DEVICE);
+
+    for (int run = 0; run < NUM_RUNS; run++) {
+        // The plain way: each object made from its own definition
+        start = now();
+        for (int device = 0; device < NUM_DEVICES; device++) {
+            for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+                object = new Generic(x, device + 1, prototypes[x]->getObject());
+                assert(object->make());
+                objects.push_back(object);
+            }
+        }
+        start = now() - start;
+        if ((plainSeconds == 0) || (start < plainSeconds)) {
+            plainSeconds = start;
+        }
+        for (unsigned int x = 0; x < objects.size(); x++) {
+            delete objects[x];
+        }
+        objects.clear();
+
+        // Cloned, with one STRING allocation per device
+        start = now();
+        for (int device = 0; device < NUM_DEVICES; device++) {
+            char *storage = new char[deviceStringStorageSize];
+            stringStorage.push_back(storage);
+            offset = 0;
+            for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+                object = new Generic(x);
+                assert(object->clone(prototypes[x], device + 1, storage + offset));
+                offset += prototypes[x]->getStringStorageSize();
+                objects.push_back(object);
+            }
+        }
+        start = now() - start;
+        if ((cloneSeconds == 0) || (start < cloneSeconds)) {
+            cloneSeconds = start;
+        }
+        for (unsigned int x = 0; x < objects.size(); x++) {
+            delete objects[x];
+        }
+        objects.clear();
+        for (unsigned int x = 0; x < stringStorage.size(); x++) {
+            delete[] stringStorage[x];
+        }
+        stringStorage.clear();
+    }
+
+    printf("%d devices of %d objects of %d resources, best of %d runs:\n",
+           NUM_DEVICES, NUM_OBJECTS_PER_DEVICE,
+           (int) (sizeof(Generic::_resources) / sizeof(Generic::_resources[0])), NUM_RUNS);
+    printf("plain makeObject() %.0f devices/s, cloned %.0f devices/s\n",
+           NUM_DEVICES / plainSeconds, NUM_DEVICES / cloneSeconds);
+
+    for (int x = 0; x < NUM_OBJECTS_PER_DEVICE; x++) {
+        delete prototypes[x];
+    }
+    Generic::freeDefinitions();
+
+    return 0;
+}
+
+// End of file
@@ -0,0 +1,200 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/* Correctness and cost of the shortest round-trip text that FLOAT
+ * resources are written with.  First every float bit pattern (or every
+ * <step>th) is converted and read back with strtof(), which must give
+ * back exactly the same float (NaN as any NaN); for one in 4096 of
+ * them the number of significant digits is also checked against the
+ * shortest "%.*g" that reads back.  Then 100,000 realistic readings are
+ * written both with "%f", as they were before, and with the helper,
+ * comparing bytes and time per value.
+ *
+ * floatToText() is static to m2m_object_helper.cpp, so that file is
+ * included here rather than linked; build it with the other files of
+ * the helper only.  From the top of the repo:
+ *
+ * g++ -O2 -Itools/bench/host -I. tools/bench/float_text.cpp m2m_object_helper_*.cpp -lpthread -o float_text
+ * ./float_text <step, 1 for all 2^32 patterns>
+ *
+ * The full sweep takes around ten minutes on one x86-64 core.
+ */
+
+#include "m2m_object_helper.cpp"
+#include <math.h>
+#include <time.h>
+
+#define NUM_READINGS 100000
+#define NUM_RUNS 10
+#define NUM_REPORTED 10
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (time.tv_nsec / 1e9);
+}
+
+// Count the significant digits of a number written by floatToText().
+static int countDigits(const char *text)
+{
+    const char *end = strchr(text, 'e');
+    const char *first;
+    const char *last;
+    int numDigits = 0;
+
+    if (end == NULL) {
+        end = text + strlen(text);
+    }
+    first = text;
+    while ((first < end) && ((*first < '1') || (*first > '9'))) {
+        first++;
+    }
+    last = end;
+    while ((last > first) && ((*(last - 1) < '1') || (*(last - 1) > '9'))) {
+        last--;
+    }
+    for (const char *x = first; x < last; x++) {
+        if ((*x >= '0') && (*x <= '9')) {
+            numDigits++;
+        }
+    }
+
+    return numDigits;
+}
+
+// Convert every step'th float bit pattern and read it back, returning
+// the number of failures.
+static uint64_t sweep(uint64_t step, uint64_t *numSampled, uint64_t *numLonger)
+{
+    char text[40];
+    char shortest[40];
+    uint64_t numFailed = 0;
+    uint32_t bits;
+    float value;
+    float readBack;
+    int length;
+    int precision;
+
+    for (uint64_t pattern = 0; pattern <= 0xFFFFFFFFULL; pattern += step) {
+        bits = (uint32_t) pattern;
+        memcpy(&value, &bits, sizeof(value));
+        length = floatToText(value, text);
+        readBack = strtof(text, NULL);
+        if ((length != (int) strlen(text)) || (length > 22) ||
+            (isnan(value) ? !isnan(readBack) : (memcmp(&value, &readBack, sizeof(value)) != 0))) {
+            if (numFailed < NUM_REPORTED) {
+                printf("0x%08x written as \"%s\"\n", bits, text);
+            }
+            numFailed++;
+        } else if ((((pattern / step) & 0xFFF) == 0) && isfinite(value) && (value != 0)) {
+            (*numSampled)++;
+            for (precision = 1; precision < 9; precision++) {
+                snprintf(shortest, sizeof(shortest), "%.*g", precision, value);
+                if (strtof(shortest, NULL) == value) {
+                    break;
+                }
+            }
+            if (countDigits(text) > precision) {
+                if (*numLonger < NUM_REPORTED) {
+                    printf("0x%08x written as \"%s\", \"%s\" is shorter\n", bits, text, shortest);
+                }
+                (*numLonger)++;
+            }
+        }
+    }
+
+    return numFailed;
+}
+
+// Temperature, humidity, pressure, battery volts and anything else.
+static void makeReadings(float *readings)
+{
+    srand(1);
+    for (int x = 0; x < NUM_READINGS; x++) {
+        switch (x % 5) {
+            case 0:
+                readings[x] = (150 + (rand() % 200)) / 10.0f;
+                break;
+            case 1:
+                readings[x] = (rand() % 1000) / 10.0f;
+                break;
+            case 2:
+                readings[x] = (95000 + (rand() % 10000)) / 100.0f;
+                break;
+            case 3:
+                readings[x] = (3000 + (rand() % 600)) / 1000.0f;
+                break;
+            default:
+                readings[x] = (rand() % 100000) / 7.0f;
+                break;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t step = (argc > 1) ? strtoull(argv[1], NULL, 0) : 1;
+    static float readings[NUM_READINGS];
+    volatile int sink = 0;
+    uint64_t numFailed;
+    uint64_t numSampled = 0;
+    uint64_t numLonger = 0;
+    uint64_t bytes[2] = {0, 0};
+    double elapsed[2];
+    double start;
+    char text[64];
+    int length;
+
+    if (step < 1) {
+        step = 1;
+    }
+    start = now();
+    numFailed = sweep(step, &numSampled, &numLonger);
+    printf("every %llu pattern(s): %llu not read back exactly, %llu of %llu sampled not shortest (%.0f s)\n",
+           (unsigned long long) step, (unsigned long long) numFailed,
+           (unsigned long long) numLonger, (unsigned long long) numSampled, now() - start);
+
+    makeReadings(readings);
+    for (int way = 0; way < 2; way++) {
+        start = now();
+        for (int run = 0; run < NUM_RUNS; run++) {
+            for (int x = 0; x < NUM_READINGS; x++) {
+                if (way == 0) {
+                    length = snprintf(text, sizeof(text), "%f", readings[x]);
+                } else {
+                    length = floatToText(readings[x], text);
+                }
+                sink += length;
+                if (run == 0) {
+                    bytes[way] += length;
+                }
+            }
+        }
+        elapsed[way] = (now() - start) * 1e9 / NUM_RUNS / NUM_READINGS;
+    }
+    printf("           ns/value   bytes/value\n");
+    printf("\"%%f\"     %8.1f      %8.2f\n", elapsed[0], (double) bytes[0] / NUM_READINGS);
+    printf("shortest %8.1f      %8.2f\n", elapsed[1], (double) bytes[1] / NUM_READINGS);
+
+    return (numFailed == 0) && (numLonger == 0) ? 0 : 1;
+}
+
+// End of file
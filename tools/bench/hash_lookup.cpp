@@ -0,0 +1,157 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Cost of finding resources by name through the perfect hash and by
+ * searching the definition, for objects of 4 to 255 resources: for
+ * each size, 200 random definitions are made into objects, timing
+ * makeObject() (which works out the hash, if there is one), and then
+ * every resource of each is looked up through getResourceVersion()
+ * from buffers that the lookup cache never holds, so that each lookup
+ * goes to the hash or the search.  Build it twice, once with the hash
+ * for every object and once without it, from the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -DMAX_NUM_RESOURCES=256 -DRESOURCE_HASH_MIN_RESOURCES=1 -Itools/bench/host -I. tools/bench/hash_lookup.cpp m2m_object_helper*.cpp -lpthread -o hash_lookup
+ * g++ -O2 -Wall -Wextra -DMAX_NUM_RESOURCES=256 -DRESOURCE_HASH_MIN_RESOURCES=1000 -Itools/bench/host -I. tools/bench/hash_lookup.cpp m2m_object_helper*.cpp -lpthread -o linear_lookup
+ * ./hash_lookup
+ * ./linear_lookup
+ *
+ * Built without -DMAX_NUM_RESOURCES only the sizes the default allows
+ * are run, which shows the size of an object in the default build.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_DEFINITIONS 200
+#define NUM_LOOKUPS_PER_RESOURCE 100
+#define NUM_COPIES 2
+
+class Generic : public M2MObjectHelper {
+public:
+    Generic(const DefObject *defObject) : M2MObjectHelper(defObject) {}
+    bool make() {
+        return makeObject();
+    }
+    static void makeDefinition(int numResources, uint32_t *seed);
+    static DefObject *_defObject;
+};
+
+M2MObjectHelper::DefObject *Generic::_defObject = NULL;
+
+// The names of the resources of the current definition, NUM_COPIES
+// times over so that the lookup cache, which holds fewer than that,
+// never finds them by their pointers.
+static char names[NUM_COPIES][MAX_NUM_RESOURCES][MAX_OBJECT_RESOURCE_NAME_LENGTH];
+
+static volatile uint32_t sink = 0;
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// xorshift32.
+static uint32_t randomNumber(uint32_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    return *seed;
+}
+
+// Make a definition of distinct resource numbers and a mixture of
+// single and multiple instances; the resources are all INTEGERs, the
+// type making no difference to the lookup.
+void Generic::makeDefinition(int numResources, uint32_t *seed)
+{
+    DefResource *defResource;
+    int first = 1000 + randomNumber(seed) % 30000;
+
+    if (_defObject == NULL) {
+        _defObject = (DefObject *) malloc(sizeof(DefObject));
+    }
+    memset((void *) _defObject, 0, sizeof(DefObject));
+    strcpy(_defObject->name, "3300");
+    _defObject->numResources = numResources;
+    for (int x = 0; x < numResources; x++) {
+        defResource = &(_defObject->resources[x]);
+        defResource->instance = ((randomNumber(seed) & 3) == 0) ? -1 : (int) (randomNumber(seed) % 4);
+        snprintf((char *) defResource->name, sizeof(defResource->name), "%d", first + x * 7);
+        strcpy((char *) defResource->typeString, "t");
+        defResource->type = M2MResourceBase::INTEGER;
+        defResource->operation = M2MBase::GET_ALLOWED;
+        for (int y = 0; y < NUM_COPIES; y++) {
+            strcpy(names[y][x], defResource->name);
+        }
+    }
+}
+
+int main()
+{
+    static const int sizes[] = {4, 8, 16, 32, 64, 128, 255};
+    uint32_t seed = 1;
+    Generic *object;
+    double start;
+    double making;
+    double lookingUp;
+    int numLookups;
+    int x;
+
+    printf("MAX_NUM_RESOURCES %d, RESOURCE_HASH_MIN_RESOURCES %d, sizeof(M2MObjectHelper) %d bytes\n",
+           MAX_NUM_RESOURCES, RESOURCE_HASH_MIN_RESOURCES, (int) sizeof(M2MObjectHelper));
+    printf("resources   makeObject()   lookup\n");
+    for (unsigned int size = 0; size < sizeof(sizes) / sizeof(sizes[0]); size++) {
+        if (sizes[size] <= MAX_NUM_RESOURCES) {
+            making = 0;
+            lookingUp = 0;
+            numLookups = 0;
+            for (int definition = 0; definition < NUM_DEFINITIONS; definition++) {
+                Generic::makeDefinition(sizes[size], &seed);
+                start = now();
+                object = new Generic(Generic::_defObject);
+                assert(object->make());
+                making += now() - start;
+                // Every resource in turn, in an order that
+                // doesn't favour the start of the definition
+                start = now();
+                for (int y = 0; y < sizes[size] * NUM_LOOKUPS_PER_RESOURCE; y++) {
+                    x = (y * 7) % sizes[size];
+                    sink += object->getResourceVersion(names[(y / sizes[size]) % NUM_COPIES][x],
+                                                       Generic::_defObject->resources[x].instance);
+                }
+                lookingUp += now() - start;
+                numLookups += sizes[size] * NUM_LOOKUPS_PER_RESOURCE;
+                delete object;
+            }
+            printf("%-11d %7.1f us     %5.1f ns\n", sizes[size],
+                   making * 1e6 / NUM_DEFINITIONS, lookingUp * 1e9 / numLookups);
+        }
+    }
+
+    return 0;
+}
+
+// End of file
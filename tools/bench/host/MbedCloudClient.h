@@ -0,0 +1,130 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Host stand-in for the parts of Mbed Client that M2MObjectHelper uses,
+// with hooks (server_put(), server_get(), deliver()) through which the
+// harnesses in tools/bench play the part of the server.  Like Mbed
+// Client, set_value() frees the old copy of a value and allocates a new
+// one, so that harnesses counting heap operations see them.
+#ifndef STUB_MCC_H
+#define STUB_MCC_H
+#include "mbed.h"
+typedef FP1<void, const char *> value_updated_callback;
+typedef FP1<void, void *> execute_callback;
+class M2MResourceBase;
+typedef int (*read_resource_value_callback)(const M2MResourceBase &resource, void *buffer, size_t *buffer_size, void *client_args);
+typedef int (*read_resource_value_size_callback)(const M2MResourceBase &resource, size_t *buffer_size, void *client_args);
+typedef bool (*write_resource_value_callback)(const M2MResourceBase &resource, const uint8_t *buffer, const size_t buffer_size, void *client_args);
+
+class M2MBlockMessage {
+public:
+    uint8_t *block_data() const { return data; }
+    uint32_t block_data_len() const { return len; }
+    uint16_t block_number() const { return num; }
+    uint32_t total_message_size() const { return total; }
+    bool is_last_block() const { return last; }
+    uint8_t *data; uint32_t len; uint16_t num; uint32_t total; bool last;
+};
+typedef FP1<void, M2MBlockMessage *> incoming_block_message_callback;
+
+class M2MBase {
+public:
+    typedef enum { NOTIFICATION_STATUS_INIT = 0, NOTIFICATION_STATUS_BUILD_ERROR, NOTIFICATION_STATUS_RESEND_QUEUE_FULL, NOTIFICATION_STATUS_SENT, NOTIFICATION_STATUS_DELIVERED, NOTIFICATION_STATUS_SEND_FAILED, NOTIFICATION_STATUS_SUBSCRIBED, NOTIFICATION_STATUS_UNSUBSCRIBED } NotificationDeliveryStatus;
+    typedef void (*notification_delivery_status_cb)(const M2MBase &base, const NotificationDeliveryStatus status, void *client_args);
+    bool set_notification_delivery_status_cb(notification_delivery_status_cb cb, void *a) { _nd = cb; _ndArgs = a; return true; }
+    void deliver(NotificationDeliveryStatus st) { if (_nd) _nd(*this, st, _ndArgs); }
+    notification_delivery_status_cb _nd; void *_ndArgs; int changed; bool observed;
+    typedef enum { NOT_ALLOWED = 0, GET_ALLOWED = 1, PUT_ALLOWED = 2, GET_PUT_ALLOWED = 3, POST_ALLOWED = 4, GET_POST_ALLOWED = 5, PUT_POST_ALLOWED = 6, GET_PUT_POST_ALLOWED = 7, DELETE_ALLOWED = 8 } Operation;
+    M2MBase(const char *n) : _nd(0), _ndArgs(0), changed(0), observed(true), _name(n), _op(NOT_ALLOWED) {}
+    virtual ~M2MBase() {}
+    const char *name() const { return _name.c_str(); }
+    void set_operation(Operation o) { _op = o; }
+    Operation operation() const { return _op; }
+    bool set_value_updated_function(value_updated_callback cb) { _vu = cb; return true; }
+    void execute_value_updated(const char *n) { if (_vu) _vu(n); }
+    bool is_observable() const { return true; }
+    bool is_under_observation() const { return observed; }
+    void set_changed() { changed++; }
+    std::string _name; Operation _op; value_updated_callback _vu;
+};
+class M2MResourceBase : public M2MBase {
+public:
+    typedef enum { STRING, INTEGER, FLOAT, BOOLEAN, OPAQUE, TIME, OBJLINK } ResourceType;
+    M2MResourceBase(const char *n, ResourceType t) : M2MBase(n), _type(t), _read(0), _readSize(0), _readArgs(0), _write(0), _writeArgs(0), sets(0), _copy(0) {}
+    ~M2MResourceBase() { free(_copy); }
+    bool set_value(const uint8_t *v, uint32_t l) { _value.assign((const char *) v, l); sets++; copy(); return true; }
+    bool set_value(int64_t v) { char b[32]; snprintf(b, sizeof(b), "%" PRId64, v); _value = b; sets++; copy(); return true; }
+    void copy() { free(_copy); _copy = (uint8_t *) malloc(_value.size() + 1); }
+    String get_value_string() const { return String(_value); }
+    int64_t get_value_int() const { return strtoll(_value.c_str(), 0, 10); }
+    uint8_t *value() const { return (uint8_t *) _value.data(); }
+    uint32_t value_length() const { return _value.size(); }
+    ResourceType resource_instance_type() const { return _type; }
+    bool set_read_resource_function(read_resource_value_callback cb, void *a) { _read = cb; _readArgs = a; return true; }
+    bool set_resource_read_size_function(read_resource_value_size_callback cb, void *a) { _readSize = cb; _readArgs = a; return true; }
+    bool set_write_resource_function(write_resource_value_callback cb, void *a) { _write = cb; _writeArgs = a; return true; }
+    void set_incoming_block_message_callback(incoming_block_message_callback cb) { _inBlock = cb; }
+    // Test hooks
+    void server_put(const char *v) { if (_write) _write(*this, (const uint8_t *) v, strlen(v), _writeArgs); else _value = v; execute_value_updated(name()); }
+    std::string server_get() { if (_read) { size_t n = 0; if (_readSize) _readSize(*this, &n, _readArgs); else n = 4096; std::string b(n, 0); _read(*this, &b[0], &n, _readArgs); b.resize(n); return b; } return _value; }
+    ResourceType _type; std::string _value;
+    read_resource_value_callback _read; read_resource_value_size_callback _readSize; void *_readArgs;
+    write_resource_value_callback _write; void *_writeArgs; incoming_block_message_callback _inBlock; int sets; uint8_t *_copy;
+};
+class M2MResourceInstance : public M2MResourceBase {
+public:
+    M2MResourceInstance(const char *n, ResourceType t, uint16_t id) : M2MResourceBase(n, t), _id(id) {}
+    uint16_t instance_id() const { return _id; }
+    uint16_t _id;
+};
+class M2MResource : public M2MResourceBase {
+public:
+    M2MResource(const char *n, ResourceType t, bool multi) : M2MResourceBase(n, t), _multi(multi) {}
+    ~M2MResource() { for (size_t i = 0; i < _inst.size(); i++) delete _inst[i]; }
+    bool supports_multiple_instances() const { return _multi; }
+    M2MResourceInstance *resource_instance(uint16_t id) const { for (size_t i = 0; i < _inst.size(); i++) if (_inst[i]->_id == id) return _inst[i]; return 0; }
+    bool set_execute_function(execute_callback cb) { _exec = cb; return true; }
+    bool _multi; std::vector<M2MResourceInstance *> _inst; execute_callback _exec;
+};
+class M2MObjectInstance : public M2MBase {
+public:
+    M2MObjectInstance(const char *n, uint16_t id) : M2MBase(n), _id(id) {}
+    ~M2MObjectInstance() { for (size_t i = 0; i < _res.size(); i++) delete _res[i]; }
+    M2MResource *create_dynamic_resource(const char *n, const char *, M2MResourceBase::ResourceType t, bool, bool multi = false) { M2MResource *r = new M2MResource(n, t, multi); _res.push_back(r); return r; }
+    M2MResourceInstance *create_dynamic_resource_instance(const char *n, const char *, M2MResourceBase::ResourceType t, bool, uint16_t id) { M2MResource *r = resource(n); if (!r) return 0; M2MResourceInstance *i = new M2MResourceInstance(n, t, id); r->_inst.push_back(i); return i; }
+    M2MResource *resource(const char *n) const { for (size_t i = 0; i < _res.size(); i++) if (_res[i]->_name == n) return _res[i]; return 0; }
+    uint16_t instance_id() const { return _id; }
+    uint16_t _id; std::vector<M2MResource *> _res;
+};
+class M2MObject : public M2MBase {
+public:
+    M2MObject(const char *n) : M2MBase(n) {}
+    ~M2MObject() { for (size_t i = 0; i < _inst.size(); i++) delete _inst[i]; }
+    M2MObjectInstance *create_object_instance(uint16_t id = 0) { M2MObjectInstance *i = new M2MObjectInstance(name(), id); _inst.push_back(i); return i; }
+    M2MObjectInstance *object_instance(uint16_t id = 0) const { for (size_t i = 0; i < _inst.size(); i++) if (_inst[i]->_id == id) return _inst[i]; return 0; }
+    bool remove_object_instance(uint16_t id) { for (size_t i = 0; i < _inst.size(); i++) if (_inst[i]->_id == id) { delete _inst[i]; _inst.erase(_inst.begin() + i); return true; } return false; }
+    uint16_t instance_count() const { return _inst.size(); }
+    std::vector<M2MObjectInstance *> _inst;
+};
+typedef std::vector<M2MObject *> M2MObjectList;
+class M2MInterfaceFactory {
+public:
+    static M2MObject *create_object(const char *n) { return new M2MObject(n); }
+};
+#endif
+
+// End of file
@@ -0,0 +1,72 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Host stand-in for the parts of Mbed OS that M2MObjectHelper uses, so
+// that the harnesses in tools/bench can be built and run on a PC.  It
+// is only as complete as those harnesses need.
+#ifndef STUB_MBED_H
+#define STUB_MBED_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+static inline void debug_if(bool c, const char *f, ...) { if (c) { va_list a; va_start(a, f); vprintf(f, a); va_end(a);} }
+#include <time.h>
+static inline uint32_t us_ticker_read() { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return (uint32_t) (t.tv_sec * 1000000ull + t.tv_nsec / 1000); }
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char *s) : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    String(const char *s, size_t n) : std::string(s, n) {}
+};
+
+// Minimal FP1-like callback.
+template <typename R, typename A> class FP1 {
+public:
+    FP1() : _o(0), _m(0), _f(0) {}
+    FP1(R (*f)(A)) : _o(0), _m(0), _f(f) {}
+    template <typename T> FP1(T *o, R (T::*m)(A)) : _o(o), _m(0), _f(0) { _thunk = &thunk<T>; memcpy(_mb, &m, sizeof(m)); _m = 1; }
+    R operator()(A a) const { return call(a); }
+    R call(A a) const { if (_m) return _thunk(_o, _mb, a); return _f(a); }
+    operator bool() const { return _m || _f; }
+private:
+    template <typename T> static R thunk(void *o, const char *mb, A a) { R (T::*m)(A); memcpy(&m, mb, sizeof(m)); return (((T *) o)->*m)(a); }
+    void *_o; int _m; R (*_f)(A); R (*_thunk)(void *, const char *, A); char _mb[32];
+};
+template <typename F> class Callback;
+template <typename R, typename... A> class Callback<R(A...)> {
+public:
+    Callback() : _o(0), _f(0), _t(0) {}
+    Callback(R (*f)(A...)) : _o(0), _f(f), _t(0) {}
+    template <typename T> Callback(T *o, R (T::*m)(A...)) : _o(o), _f(0) { memcpy(_mb, &m, sizeof(m)); _t = &thunk<T>; }
+    R operator()(A... a) const { return call(a...); }
+    R call(A... a) const { if (_t) return _t(_o, _mb, a...); return _f(a...); }
+    operator bool() const { return _t || _f; }
+private:
+    template <typename T> static R thunk(void *o, const char *mb, A... a) { R (T::*m)(A...); memcpy(&m, mb, sizeof(m)); return (((T *) o)->*m)(a...); }
+    void *_o; R (*_f)(A...); R (*_t)(void *, const char *, A...); char _mb[32];
+};
+#endif
+
+// End of file
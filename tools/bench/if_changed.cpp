@@ -0,0 +1,192 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* An exporter reading the values of 2,000 objects of eight INTEGER
+ * resources over and over, while between reads one value in each of
+ * 1% of the objects changes.  Each cycle is timed three ways: reading
+ * every value, skipping each object whose getVersion() hasn't moved
+ * and reading every value of the rest, and skipping the same way but
+ * reading the rest through getIfChanged().  Before that it checks what
+ * getIfChanged() gets, and it prints the size of an object first.
+ * From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/if_changed.cpp m2m_object_helper*.cpp -lpthread -o if_changed
+ * ./if_changed
+ *
+ * Add -DRESOURCE_VERSIONS=1 for a version per resource.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <time.h>
+#include <vector>
+
+#define NUM_OBJECTS 2000
+#define NUM_RESOURCES 8
+#define NUM_CYCLES 200
+#define NUM_RUNS 5
+#define CHANGES_PER_CYCLE (NUM_OBJECTS / 100)
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor() : M2MObjectHelper(&_definition) {
+        assert(makeObject());
+        for (int x = 0; x < NUM_RESOURCES; x++) {
+            _seen[x] = 0;
+        }
+        _seenObject = 0;
+    }
+    bool set(int64_t value, int resource) {
+        return setResourceValue(value, _names[resource]);
+    }
+    bool get(int64_t *value, int resource) {
+        return getResourceValue(value, _names[resource]);
+    }
+    bool getIfChanged(int64_t *value, uint32_t *version, int resource) {
+        return M2MObjectHelper::getIfChanged(value, version, _names[resource]);
+    }
+    static const char * const _names[NUM_RESOURCES];
+    static const DefObject _definition;
+    uint32_t _seen[NUM_RESOURCES];
+    uint32_t _seenObject;
+};
+
+const char * const Sensor::_names[NUM_RESOURCES] = {"5700", "5601", "5602", "5603",
+                                                    "5604", "5605", "5701", "5750"};
+
+const M2MObjectHelper::DefObject Sensor::_definition = {0, "3303", NUM_RESOURCES,
+    {{-1, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5601", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5602", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5603", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5604", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5605", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5701", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5750", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL}},
+    NULL, NULL};
+
+static volatile int64_t sink = 0;
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Check what getIfChanged() gets.
+static void check()
+{
+    Sensor sensor;
+    uint32_t version = 0;
+    uint32_t other = 0;
+    int64_t value;
+
+    // Making the object counts as a change, so version 0 gets the value once
+    assert(sensor.getIfChanged(&value, &version, 0) && (value == 0));
+    assert(!sensor.getIfChanged(&value, &version, 0));
+    assert(sensor.getIfChanged(&value, &other, 1));
+    assert(sensor.set(42, 0));
+    assert(sensor.getIfChanged(&value, &version, 0) && (value == 42));
+    assert(version == sensor.getVersion());
+    assert(!sensor.getIfChanged(&value, &version, 0));
+    // Setting the value it already has is not a change
+    assert(sensor.set(42, 0));
+    assert(!sensor.getIfChanged(&value, &version, 0));
+    // A change to another resource changes this one only if the
+    // version is the object's
+    assert(sensor.set(7, 1));
+    assert(sensor.getIfChanged(&value, &version, 0) == !RESOURCE_VERSIONS);
+    assert(sensor.getIfChanged(&value, &other, 1) && (value == 7));
+    assert(sensor.getResourceVersion("9999") == 0);
+}
+
+int main()
+{
+    std::vector<Sensor *> sensors;
+    double best[3] = {1e9, 1e9, 1e9};
+    long got[3] = {0, 0, 0};
+    double start;
+    int64_t value;
+    int changes = 0;
+
+    printf("RESOURCE_VERSIONS %d, sizeof(M2MObjectHelper) %d bytes, MAX_NUM_RESOURCES %d\n",
+           RESOURCE_VERSIONS, (int) sizeof(M2MObjectHelper), MAX_NUM_RESOURCES);
+
+    check();
+
+    for (int x = 0; x < NUM_OBJECTS; x++) {
+        sensors.push_back(new Sensor());
+    }
+
+    // Best of NUM_RUNS, the machine being shared; each way sees
+    // as many changes
+    for (int run = 0; run < NUM_RUNS; run++) {
+        for (int way = 0; way < 3; way++) {
+            got[way] = 0;
+            start = now();
+            for (int cycle = 0; cycle < NUM_CYCLES; cycle++) {
+                for (int x = 0; x < CHANGES_PER_CYCLE; x++) {
+                    changes++;
+                    assert(sensors[(changes * 37) % NUM_OBJECTS]->set(changes, changes % NUM_RESOURCES));
+                }
+                for (int x = 0; x < NUM_OBJECTS; x++) {
+                    Sensor *sensor = sensors[x];
+                    if ((way > 0) && (sensor->getVersion() == sensor->_seenObject)) {
+                        continue;
+                    }
+                    sensor->_seenObject = sensor->getVersion();
+                    for (int y = 0; y < NUM_RESOURCES; y++) {
+                        if (way < 2) {
+                            assert(sensor->get(&value, y));
+                        } else if (!sensor->getIfChanged(&value, &(sensor->_seen[y]), y)) {
+                            continue;
+                        }
+                        sink += value;
+                        got[way]++;
+                    }
+                }
+            }
+            start = now() - start;
+            if (start < best[way]) {
+                best[way] = start;
+            }
+        }
+    }
+
+    printf("%d objects of %d resources, %d changes a cycle, best of %d runs:\n",
+           NUM_OBJECTS, NUM_RESOURCES, CHANGES_PER_CYCLE, NUM_RUNS);
+    printf("read everything                  %7.1f us a cycle, %6.1f values got\n",
+           best[0] * 1e6 / NUM_CYCLES, (double) got[0] / NUM_CYCLES);
+    printf("skip by getVersion(), read rest  %7.1f us a cycle, %6.1f values got\n",
+           best[1] * 1e6 / NUM_CYCLES, (double) got[1] / NUM_CYCLES);
+    printf("skip by getVersion(), then\n");
+    printf("  getIfChanged() each resource   %7.1f us a cycle, %6.1f values got\n",
+           best[2] * 1e6 / NUM_CYCLES, (double) got[2] / NUM_CYCLES);
+
+    for (unsigned int x = 0; x < sensors.size(); x++) {
+        delete sensors[x];
+    }
+
+    return 0;
+}
+
+// End of file
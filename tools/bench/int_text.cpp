@@ -0,0 +1,177 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/* Correctness and cost of the text conversions used for INTEGER, TIME
+ * and BOOLEAN values.  int64ToText() and textToInt64() are checked
+ * against snprintf() and strtoll() on the edge values, on the given
+ * number of random values of every magnitude and on text that
+ * overflows or isn't a number.  Then a million typical counter and
+ * sensor values are written and read back both ways, giving the time
+ * per value.
+ *
+ * The two functions are static to m2m_object_helper.cpp, so that file
+ * is included here rather than linked; build it with the other files
+ * of the helper only.  From the top of the repo, on a PC:
+ *
+ * g++ -O2 -Itools/bench/host -I. tools/bench/int_text.cpp m2m_object_helper_*.cpp -lpthread -o int_text
+ * ./int_text <random values, e.g. 20000000>
+ *
+ * and for a Cortex-M3 under QEMU's user-mode emulation, using newlib's
+ * semihosting for the output and the clock (not newlib-nano, whose
+ * printf() has no 64-bit formats):
+ *
+ * arm-none-eabi-g++ -O2 -mcpu=cortex-m3 -mthumb --specs=rdimon.specs -Itools/bench/host -I. tools/bench/int_text.cpp m2m_object_helper_*.cpp -o int_text.elf
+ * qemu-arm -cpu cortex-m3 int_text.elf 200000
+ *
+ * QEMU doesn't model the timing of a Cortex-M, so there only the ratio
+ * between the library and the helper means anything; it does show the
+ * cost of the 64-bit divides, which are library calls on a Cortex-M.
+ */
+
+#include "m2m_object_helper.cpp"
+#include <time.h>
+
+#define NUM_TYPICAL 1000000
+#define NUM_REPORTED 5
+
+static const int64_t edgeValues[] = {0, 1, -1, 9, 10, 99, 100, -100,
+                                     999999999LL, 1000000000LL,
+                                     4294967295LL, 4294967296LL, -4294967296LL,
+                                     INT64_MAX, INT64_MAX - 1, INT64_MIN, INT64_MIN + 1};
+
+static const char *badText[] = {"9223372036854775808", "-9223372036854775809",
+                                "99999999999999999999999", " 42abc", "+7",
+                                "", "-", "x"};
+
+static int64_t typicalValues[NUM_TYPICAL];
+static char typicalText[NUM_TYPICAL][24];
+static uint64_t randomState = 88172645463325252ULL;
+
+static double now()
+{
+#if defined(__arm__) && !defined(__linux__)
+    return (double) clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (time.tv_nsec / 1e9);
+#endif
+}
+
+// xorshift64, the same on every target.
+static uint64_t random64()
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+
+    return randomState;
+}
+
+// Write a value both ways and read it back, returning
+// true if the two agree.
+static bool check(int64_t value, bool report)
+{
+    char text[24];
+    char reference[24];
+    int64_t readBack;
+    int length;
+    bool success;
+
+    length = int64ToText(value, text);
+    snprintf(reference, sizeof(reference), "%" PRId64, value);
+    success = (strcmp(text, reference) == 0) && (length == (int) strlen(reference)) &&
+              textToInt64(text, length, &readBack) && (readBack == value);
+    if (!success && report) {
+        printf("%s written as \"%s\"\n", reference, text);
+    }
+
+    return success;
+}
+
+int main(int argc, char **argv)
+{
+    long numRandom = (argc > 1) ? atol(argv[1]) : 20000000;
+    volatile long long sink = 0;
+    unsigned long numFailed = 0;
+    double elapsed[4];
+    double start;
+    int64_t value;
+    long long reference;
+    char *end;
+    bool success;
+
+    for (unsigned int x = 0; x < sizeof(edgeValues) / sizeof(edgeValues[0]); x++) {
+        if (!check(edgeValues[x], true)) {
+            numFailed++;
+        }
+    }
+    for (long x = 0; x < numRandom; x++) {
+        value = (int64_t) random64();
+        value >>= random64() % 64;
+        if (!check(value, numFailed < NUM_REPORTED)) {
+            numFailed++;
+        }
+    }
+    for (unsigned int x = 0; x < sizeof(badText) / sizeof(badText[0]); x++) {
+        value = 12345;
+        success = textToInt64(badText[x], strlen(badText[x]), &value);
+        reference = strtoll(badText[x], &end, 10);
+        if ((success != (end != badText[x])) || (success && (value != reference))) {
+            printf("\"%s\" read as %s %" PRId64 ", strtoll() gives %lld\n", badText[x],
+                   success ? "" : "nothing,", value, reference);
+            numFailed++;
+        }
+    }
+    printf("%ld random value(s): %lu failure(s)\n", numRandom, numFailed);
+
+    for (int x = 0; x < NUM_TYPICAL; x++) {
+        typicalValues[x] = (int64_t) (random64() % 200000) - 1000;
+    }
+    start = now();
+    for (int x = 0; x < NUM_TYPICAL; x++) {
+        sink += snprintf(typicalText[x], sizeof(typicalText[x]), "%" PRId64, typicalValues[x]);
+    }
+    elapsed[0] = now() - start;
+    start = now();
+    for (int x = 0; x < NUM_TYPICAL; x++) {
+        sink += int64ToText(typicalValues[x], typicalText[x]);
+    }
+    elapsed[1] = now() - start;
+    start = now();
+    for (int x = 0; x < NUM_TYPICAL; x++) {
+        sink += strtoll(typicalText[x], NULL, 10);
+    }
+    elapsed[2] = now() - start;
+    start = now();
+    for (int x = 0; x < NUM_TYPICAL; x++) {
+        textToInt64(typicalText[x], strlen(typicalText[x]), &value);
+        sink += value;
+    }
+    elapsed[3] = now() - start;
+    printf("format: snprintf %.1f ns, int64ToText %.1f ns\n",
+           elapsed[0] * 1e9 / NUM_TYPICAL, elapsed[1] * 1e9 / NUM_TYPICAL);
+    printf("parse:  strtoll  %.1f ns, textToInt64 %.1f ns\n",
+           elapsed[2] * 1e9 / NUM_TYPICAL, elapsed[3] * 1e9 / NUM_TYPICAL);
+
+    return (numFailed == 0) ? 0 : 1;
+}
+
+// End of file
@@ -0,0 +1,160 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark and check of M2MObjectJournal: checks the records written
+ * for a value put by the server and for one appended directly, then
+ * appends 200,000 records (or the number given on the command line),
+ * with a flush and sync every 100, and reports how long the caller
+ * spent in append() and flush(), the longest single call, how long it
+ * then took for everything to complete, and the submission and
+ * completion times from getStats().  From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/journal.cpp m2m_object_helper*.cpp -lpthread -o journal
+ * ./journal
+ *
+ * Add -DJOURNAL_IO_URING=0 for the stdio version.  The journal is
+ * written to the current directory, so run it on the storage you
+ * are interested in.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_journal.h"
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+
+#define JOURNAL_PATH "journal.log"
+#define FLUSH_EVERY  100
+
+class SwitchObject : public M2MObjectHelper {
+public:
+    SwitchObject(M2MObjectJournal *journal) : M2MObjectHelper(&_defObject) {
+        setJournal(journal);
+        makeObject();
+    }
+    M2MResourceBase *getResource() {
+        return getObject()->object_instance(0)->resource("5850");
+    }
+    static const DefObject _defObject;
+};
+
+const M2MObjectHelper::DefObject SwitchObject::_defObject =
+    {0, "3312", 1,
+        {{-1, "5850", "on/off", M2MResourceBase::INTEGER, false, M2MBase::GET_PUT_ALLOWED, NULL}},
+     NULL, NULL};
+
+static std::string readFile(const char *path)
+{
+    std::string contents;
+    FILE *file = fopen(path, "rb");
+    int c;
+
+    if (file != NULL) {
+        while ((c = fgetc(file)) != EOF) {
+            contents += (char) c;
+        }
+        fclose(file);
+    }
+
+    return contents;
+}
+
+static double now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    M2MObjectJournal::Stats stats;
+    int numRecords = (argc > 1) ? atoi(argv[1]) : 200000;
+    double start, callerMs, worstUs, drainMs, t;
+    std::string contents;
+    int numLines = 0;
+    char value[16];
+    int length;
+
+    unlink(JOURNAL_PATH);
+    {
+        M2MObjectJournal journal(JOURNAL_PATH);
+
+        assert(journal.open());
+        SwitchObject switchObject(&journal);
+        switchObject.getResource()->server_put("42");
+        assert(journal.append("32769", 0, "1", 2, "hello\nthere", 11));
+        assert(journal.flush());
+        assert(journal.wait());
+        assert(readFile(JOURNAL_PATH) == "3312/0/5850/-1 2\n42\n32769/0/1/2 11\nhello\nthere\n");
+    }
+    unlink(JOURNAL_PATH);
+    printf("record check OK\n");
+
+    M2MObjectJournal journal(JOURNAL_PATH);
+    assert(journal.open());
+    worstUs = 0;
+    start = now();
+    for (int x = 0; x < numRecords; x++) {
+        length = snprintf(value, sizeof(value), "%d", x);
+        t = now();
+        assert(journal.append("3303", x % 1000, "5700", -1, value, length));
+        if ((x % FLUSH_EVERY) == FLUSH_EVERY - 1) {
+            assert(journal.flush());
+        }
+        t = (now() - t) * 1000000;
+        if (t > worstUs) {
+            worstUs = t;
+        }
+    }
+    callerMs = (now() - start) * 1000;
+    start = now();
+    assert(journal.wait());
+    drainMs = (now() - start) * 1000;
+
+    journal.getStats(&stats);
+    printf("%s: %d records, flush and sync every %d\n",
+           stats.async ? "io_uring" : "stdio", numRecords, FLUSH_EVERY);
+    printf("caller %.1f ms in total, longest call %.1f us, then %.1f ms to complete\n",
+           callerMs, worstUs, drainMs);
+    printf("submitted %u, completed %u, failed %u\n",
+           (unsigned int) stats.numSubmitted, (unsigned int) stats.numCompleted,
+           (unsigned int) stats.numFailed);
+    if ((stats.numSubmitted > 0) && (stats.numCompleted > 0)) {
+        printf("submission average %.1f us, longest %u us; completion average %.1f us, longest %u us\n",
+               (double) stats.submitUsTotal / stats.numSubmitted, (unsigned int) stats.submitUsMax,
+               (double) stats.completeUsTotal / stats.numCompleted, (unsigned int) stats.completeUsMax);
+    }
+
+    contents = readFile(JOURNAL_PATH);
+    for (size_t x = 0; x < contents.size(); x++) {
+        if (contents[x] == '\n') {
+            numLines++;
+        }
+    }
+    assert(numLines == numRecords * 2);
+    unlink(JOURNAL_PATH);
+
+    return 0;
+}
+
+// End of file
@@ -0,0 +1,239 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark and check of M2MLinkPayload: 3000 instances (or the number
+ * given on the command line) of each of three objects join and leave
+ * at random, the payload being checked against one formatted from
+ * scratch as they do, and objects given the payload with
+ * setLinkPayload() are checked to add themselves when made and remove
+ * themselves when deleted.  Then, with every instance in the payload,
+ * times taking one instance out and putting it back again against
+ * formatting the whole list again, best of five.  From the top of the
+ * repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/link_payload.cpp m2m_object_helper*.cpp -lpthread -o link_payload
+ * ./link_payload
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_links.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define NUM_DEF_OBJECTS 3
+#define NUM_RUNS 5
+#define NUM_SPLICES 2000
+
+// The object IDs, in the order of the definitions.
+static const unsigned int objectIds[NUM_DEF_OBJECTS] = {3303, 3311, 1};
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor(int d, M2MLinkPayload *links = NULL) : M2MObjectHelper(&_defObjects[d]) {
+        if (links != NULL) {
+            assert(setLinkPayload(links));
+        }
+    }
+    bool make() {
+        return makeObject();
+    }
+    bool clone(Sensor *prototype, int instance) {
+        return makeObject(prototype, instance);
+    }
+    bool moveTo(M2MLinkPayload *links) {
+        return setLinkPayload(links);
+    }
+    static const DefObject _defObjects[];
+};
+
+const M2MObjectHelper::DefObject Sensor::_defObjects[] = {
+    {0, "3303", 1,
+        {{-1, "5700", "temperature", M2MResourceBase::FLOAT, true, M2MBase::GET_ALLOWED, NULL}},
+     NULL, NULL},
+    {0, "3311", 1,
+        {{-1, "5850", "on/off", M2MResourceBase::BOOLEAN, true, M2MBase::GET_ALLOWED, NULL}},
+     NULL, NULL},
+    {0, "1", 1,
+        {{-1, "1", "lifetime", M2MResourceBase::INTEGER, true, M2MBase::GET_ALLOWED, NULL}},
+     NULL, NULL}
+};
+
+// An instance, in the order of the payload.
+typedef std::pair<unsigned int, int> Key;
+
+// Format the payload from scratch, as would be done without
+// M2MLinkPayload.
+static std::string format(const std::set<Key> &keys)
+{
+    std::string payload;
+    char fragment[32];
+
+    for (std::set<Key>::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+        if (!payload.empty()) {
+            payload += ",";
+        }
+        snprintf(fragment, sizeof(fragment), "</%u/%d>", i->first, i->second);
+        payload += fragment;
+    }
+
+    return payload;
+}
+
+static double now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    int numInstances = (argc > 1) ? atoi(argv[1]) : 3000;
+    Sensor *prototypes[NUM_DEF_OBJECTS];
+    std::vector<Sensor *> objects;
+    std::vector<Key> objectKeys;
+    std::set<Key> keys;
+    M2MLinkPayload::Stats stats;
+    double spliceUs = 0;
+    double formatUs = 0;
+    double start;
+    size_t total = 0;
+    Sensor *object;
+    int length;
+    int x;
+
+    // The prototypes, instance 0, which are never in the payload
+    // here, and the instances that come and go
+    for (int d = 0; d < NUM_DEF_OBJECTS; d++) {
+        prototypes[d] = new Sensor(d);
+        assert(prototypes[d]->make());
+    }
+    for (int instance = 1; instance <= numInstances; instance++) {
+        for (int d = 0; d < NUM_DEF_OBJECTS; d++) {
+            object = new Sensor(d);
+            assert(object->clone(prototypes[d], instance));
+            objects.push_back(object);
+            objectKeys.push_back(Key(objectIds[d], instance));
+        }
+    }
+    assert((strcmp(prototypes[2]->getLinkFragment(&length), "</1/0>") == 0) && (length == 6));
+
+    {
+        M2MLinkPayload links;
+
+        assert((strcmp(links.getPayload(&length), "") == 0) && (length == 0));
+        // Random churn, checked against formatting from scratch
+        srand(1);
+        for (int step = 0; step < 10 * (int) objects.size(); step++) {
+            x = rand() % objects.size();
+            if (keys.count(objectKeys[x]) > 0) {
+                assert(links.remove(objects[x]));
+                assert(!links.remove(objects[x]));
+                keys.erase(objectKeys[x]);
+            } else {
+                assert(links.add(objects[x]));
+                assert(!links.add(objects[x]));
+                keys.insert(objectKeys[x]);
+            }
+            if ((step < 1000) || (step % 97 == 0)) {
+                assert(format(keys) == links.getPayload(&length));
+                assert((length == links.getSize()) && (length == (int) format(keys).size()));
+            }
+        }
+    }
+    printf("splice check OK\n");
+
+    // Objects given the payload keep themselves in it
+    {
+        M2MLinkPayload links;
+        M2MLinkPayload otherLinks;
+        Sensor *onOff = new Sensor(1, &links);
+        Sensor *temperature = new Sensor(0, &links);
+
+        assert(links.getSize() == 0);
+        assert(onOff->make());
+        assert(strcmp(links.getPayload(), "</3311/0>") == 0);
+        assert(temperature->make());
+        assert(strcmp(links.getPayload(), "</3303/0>,</3311/0>") == 0);
+        assert(onOff->moveTo(&otherLinks));
+        assert(strcmp(links.getPayload(), "</3303/0>") == 0);
+        assert(strcmp(otherLinks.getPayload(), "</3311/0>") == 0);
+        delete onOff;
+        assert(otherLinks.getSize() == 0);
+        delete temperature;
+        assert(links.getSize() == 0);
+    }
+    printf("setLinkPayload() check OK\n");
+
+    // Every instance in the payload: take one out and put it
+    // back, against formatting the whole list again
+    {
+        M2MLinkPayload links;
+
+        keys.clear();
+        for (x = 0; x < (int) objects.size(); x++) {
+            assert(links.add(objects[x]));
+            keys.insert(objectKeys[x]);
+        }
+        for (int run = 0; run < NUM_RUNS; run++) {
+            start = now();
+            for (int splice = 0; splice < NUM_SPLICES; splice++) {
+                object = objects[(splice * 7919) % objects.size()];
+                links.remove(object);
+                links.add(object);
+            }
+            start = (now() - start) * 1000000 / (NUM_SPLICES * 2);
+            if ((run == 0) || (start < spliceUs)) {
+                spliceUs = start;
+            }
+            start = now();
+            for (int y = 0; y < NUM_SPLICES / 10; y++) {
+                total += format(keys).size();
+            }
+            start = (now() - start) * 1000000 / (NUM_SPLICES / 10);
+            if ((run == 0) || (start < formatUs)) {
+                formatUs = start;
+            }
+        }
+        assert(format(keys) == links.getPayload());
+        links.getStats(&stats);
+        printf("%d instances, %d byte payload, best of %d runs:\n", stats.numFragments, stats.size, NUM_RUNS);
+        printf("adding or removing one instance %.2f us, formatting the list again %.1f us\n",
+               spliceUs, formatUs);
+    }
+
+    for (x = 0; x < (int) objects.size(); x++) {
+        delete objects[x];
+    }
+    for (int d = 0; d < NUM_DEF_OBJECTS; d++) {
+        delete prototypes[d];
+    }
+
+    return (total > 0) ? 0 : 1;
+}
+
+// End of file
@@ -0,0 +1,196 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Time per lookup of a resource by name through getResourceVersion(), for
+ * an object of eight resources: with the resource number a string
+ * literal, which the lookup cache finds by its pointer, and with it in
+ * one of sixteen buffers used in turn, which the cache never holds, so
+ * that each lookup goes to the definition.  For comparison, the same
+ * lookups made by a linear search with strcmp(), as they were before
+ * the cache and the hash.  Then four threads read the instances of a
+ * multi-instance resource through the same literal, while between them
+ * they overwrite the cache entries, and check that each read gets the
+ * value of the instance asked for.  From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/lookup.cpp m2m_object_helper*.cpp -lpthread -o lookup
+ * ./lookup
+ *
+ * Add -DRESOURCE_LOOKUP_CACHE_TRUST_POINTER=0 for the cost of confirming
+ * each cache hit by name.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_LOOKUPS 10000000
+#define NUM_RUNS 5
+#define NUM_BUFFERS 16
+#define NUM_THREADS 4
+#define NUM_INSTANCES 6
+#define NUM_READS 2000000
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor(const DefObject *defObject) : M2MObjectHelper(defObject) {
+        assert(makeObject());
+    }
+    bool set(int64_t value, const char *resourceNumber, int wantedInstance = -1) {
+        return setResourceValue(value, resourceNumber, wantedInstance);
+    }
+    bool get(int64_t *value, const char *resourceNumber, int wantedInstance = -1) {
+        return getResourceValue(value, resourceNumber, wantedInstance);
+    }
+    static int linearSearch(const char *resourceNumber, int wantedInstance);
+    static const DefObject _temperature;
+    static const DefObject _multiple;
+};
+
+const M2MObjectHelper::DefObject Sensor::_temperature = {0, "3303", 8,
+    {{-1, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5601", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5602", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5603", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5604", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5605", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5701", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5750", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL}},
+    NULL, NULL};
+
+const M2MObjectHelper::DefObject Sensor::_multiple = {0, "3303", NUM_INSTANCES,
+    {{0, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {1, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {2, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {3, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {4, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL},
+     {5, "5700", "t", M2MResourceBase::INTEGER, false, M2MBase::GET_ALLOWED, NULL}},
+    NULL, NULL};
+
+static Sensor *shared = NULL;
+static volatile int sink = 0;
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static double min(double a, double b)
+{
+    return (a < b) ? a : b;
+}
+
+// The lookup as it was: a linear search of the definition by name.
+int Sensor::linearSearch(const char *resourceNumber, int wantedInstance)
+{
+    for (int x = 0; x < _temperature.numResources; x++) {
+        if ((strcmp(resourceNumber, _temperature.resources[x].name) == 0) &&
+            (wantedInstance == _temperature.resources[x].instance)) {
+            return x;
+        }
+    }
+
+    return -1;
+}
+
+// Read the instances of the shared object in an order of this
+// thread's own, checking that each gets its own value.
+static void *reader(void *parameter)
+{
+    long thread = (long) parameter;
+    int64_t value;
+    int instance;
+
+    for (int x = 0; x < NUM_READS; x++) {
+        instance = (x + (int) thread) % NUM_INSTANCES;
+        assert(shared->get(&value, "5700", instance));
+        if (value != instance * 10) {
+            printf("wrong value %d for instance %d.\n", (int) value, instance);
+            abort();
+        }
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    Sensor object(&Sensor::_temperature);
+    char buffers[NUM_BUFFERS][8];
+    pthread_t threads[NUM_THREADS];
+    double start;
+    double elapsed[3];
+
+    assert(object.set(21, "5750"));
+    for (int x = 0; x < NUM_BUFFERS; x++) {
+        strcpy(buffers[x], "5750");
+    }
+
+    // Best of NUM_RUNS, the machine being shared
+    for (int x = 0; x < 3; x++) {
+        elapsed[x] = 1e9;
+    }
+    for (int run = 0; run < NUM_RUNS; run++) {
+        start = now();
+        for (int x = 0; x < NUM_LOOKUPS; x++) {
+            sink += object.getResourceVersion("5750");
+        }
+        elapsed[0] = min(elapsed[0], now() - start);
+        start = now();
+        for (int x = 0; x < NUM_LOOKUPS; x++) {
+            sink += object.getResourceVersion(buffers[x % NUM_BUFFERS]);
+        }
+        elapsed[1] = min(elapsed[1], now() - start);
+        start = now();
+        for (int x = 0; x < NUM_LOOKUPS; x++) {
+            sink += Sensor::linearSearch(buffers[x % NUM_BUFFERS], -1);
+        }
+        elapsed[2] = min(elapsed[2], now() - start);
+    }
+
+    printf("8 resources, last in the definition, RESOURCE_LOOKUP_CACHE_TRUST_POINTER %d\n",
+           RESOURCE_LOOKUP_CACHE_TRUST_POINTER);
+    printf("getResourceVersion(), literal       %5.1f ns\n", elapsed[0] * 1e9 / NUM_LOOKUPS);
+    printf("getResourceVersion(), buffers       %5.1f ns\n", elapsed[1] * 1e9 / NUM_LOOKUPS);
+    printf("linear strcmp() search alone        %5.1f ns\n", elapsed[2] * 1e9 / NUM_LOOKUPS);
+
+    // Now the race
+    shared = new Sensor(&Sensor::_multiple);
+    for (int x = 0; x < NUM_INSTANCES; x++) {
+        assert(shared->set(x * 10, "5700", x));
+    }
+    for (long x = 0; x < NUM_THREADS; x++) {
+        assert(pthread_create(&threads[x], NULL, reader, (void *) x) == 0);
+    }
+    for (int x = 0; x < NUM_THREADS; x++) {
+        pthread_join(threads[x], NULL);
+    }
+    delete shared;
+    printf("%d threads, %d reads each of %d instances through one literal: all right.\n",
+           NUM_THREADS, NUM_READS, NUM_INSTANCES);
+
+    return 0;
+}
+
+// End of file
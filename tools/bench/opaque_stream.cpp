@@ -0,0 +1,209 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* A 1 MB value written by the "server" to an OPAQUE resource in 1 kB
+ * blocks, passed block by block to a sink that hashes it, as a flash
+ * writer would store it.  Checks that the sink gets every byte once and
+ * in order, that the progress reported by getOpaqueWriteProgress()
+ * follows it, that a block the sink refuses and everything after it are
+ * offered again when the server resends the value, and that a write
+ * resumed with setOpaqueWriteProgress() after a "restart" (in 512 byte
+ * blocks this time) passes on only what is missing.  Then times the
+ * whole value against hashing it alone, best of 20.  From the top of
+ * the repo:
+ *
+ * g++ -O2 -Wall -Wextra -DOPAQUE_WRITE_STREAMING=1 -Itools/bench/host -I. tools/bench/opaque_stream.cpp m2m_object_helper*.cpp -lpthread -o opaque_stream
+ * ./opaque_stream
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <time.h>
+
+#define PAYLOAD_SIZE (1024 * 1024)
+#define BLOCK_SIZE 1024
+#define NUM_RUNS 20
+#define HASH_START 2166136261UL
+
+class Firmware : public M2MObjectHelper {
+public:
+    Firmware() : M2MObjectHelper(&_defObject) {
+        assert(makeObject());
+        setOpaqueWriteCallback(&Firmware::sink);
+    }
+    M2MResourceBase *package() {
+        return getObject()->object_instance(0)->resource("0");
+    }
+    bool getProgress(uint32_t *offset, uint32_t *totalLength) {
+        return getOpaqueWriteProgress(offset, totalLength, "0");
+    }
+    bool setProgress(uint32_t offset, uint32_t totalLength) {
+        return setOpaqueWriteProgress(offset, totalLength, "0");
+    }
+    static bool sink(const char *resourceNumber, int instance, const OpaqueBlock *block);
+    static const DefObject _defObject;
+};
+
+const M2MObjectHelper::DefObject Firmware::_defObject =
+    {0, "5", 1,
+        {{-1, "0", "package", M2MResourceBase::OPAQUE, false, M2MBase::PUT_ALLOWED, NULL}},
+     NULL, NULL};
+
+static uint8_t payload[PAYLOAD_SIZE];
+static uint32_t hash = HASH_START;
+static uint32_t received = 0;
+static int numBlocks = 0;
+static bool gotLast = false;
+static uint32_t refuseAt = 0xFFFFFFFF;
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// FNV-1a.
+static uint32_t hashBytes(uint32_t value, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t x = 0; x < length; x++) {
+        value = (value ^ data[x]) * 16777619UL;
+    }
+
+    return value;
+}
+
+// The sink: hash each block, which must follow the last.
+bool Firmware::sink(const char *resourceNumber, int instance, const OpaqueBlock *block)
+{
+    (void) resourceNumber;
+    (void) instance;
+    if (block->offset == refuseAt) {
+        refuseAt = 0xFFFFFFFF;
+        return false;
+    }
+    assert(block->offset == received);
+    hash = hashBytes(hash, block->data, block->length);
+    received += block->length;
+    numBlocks++;
+    gotLast = block->last;
+
+    return true;
+}
+
+static void startSink(uint32_t offset)
+{
+    hash = hashBytes(HASH_START, payload, offset);
+    received = offset;
+    numBlocks = 0;
+    gotLast = false;
+}
+
+// Send the payload from the given block on, as Mbed Client would.
+static void send(M2MResourceBase *handle, uint32_t blockSize, uint32_t firstBlock)
+{
+    M2MBlockMessage message;
+
+    message.total = PAYLOAD_SIZE;
+    for (uint32_t block = firstBlock; block * blockSize < PAYLOAD_SIZE; block++) {
+        message.data = payload + block * blockSize;
+        message.len = ((block + 1) * blockSize <= PAYLOAD_SIZE) ? blockSize : PAYLOAD_SIZE - block * blockSize;
+        message.num = block;
+        message.last = ((block + 1) * blockSize >= PAYLOAD_SIZE);
+        handle->_inBlock(&message);
+    }
+}
+
+int main()
+{
+    Firmware firmware;
+    uint32_t wanted;
+    uint32_t offset;
+    uint32_t totalLength;
+    double start;
+    double elapsed[2] = {1e9, 1e9};
+
+    for (uint32_t x = 0; x < PAYLOAD_SIZE; x++) {
+        payload[x] = (uint8_t) ((x * 7) + (x >> 9));
+    }
+    wanted = hashBytes(HASH_START, payload, PAYLOAD_SIZE);
+
+    // The whole value
+    startSink(0);
+    send(firmware.package(), BLOCK_SIZE, 0);
+    assert((received == PAYLOAD_SIZE) && (hash == wanted) && gotLast);
+    assert(firmware.getProgress(&offset, &totalLength) &&
+           (offset == PAYLOAD_SIZE) && (totalLength == PAYLOAD_SIZE));
+    printf("whole value: %d blocks, progress %u of %u.\n", numBlocks,
+           (unsigned int) offset, (unsigned int) totalLength);
+
+    // The sink refuses the block at 300 kB, so the rest is
+    // dropped; when the server sends the value again, only
+    // what is missing is passed on
+    startSink(0);
+    refuseAt = 300 * BLOCK_SIZE;
+    send(firmware.package(), BLOCK_SIZE, 0);
+    assert((received == 300 * BLOCK_SIZE) && !gotLast);
+    assert(firmware.getProgress(&offset, NULL) && (offset == 300 * BLOCK_SIZE));
+    printf("refused at 300 kB: progress %u.\n", (unsigned int) offset);
+    numBlocks = 0;
+    send(firmware.package(), BLOCK_SIZE, 0);
+    assert((received == PAYLOAD_SIZE) && (hash == wanted) && gotLast &&
+           (numBlocks == (PAYLOAD_SIZE / BLOCK_SIZE) - 300));
+    printf("sent again: %d blocks passed on, hash right.\n", numBlocks);
+
+    // After a restart, with 5000 bytes already stored, the
+    // server starts again with smaller blocks
+    {
+        Firmware restarted;
+
+        assert(restarted.setProgress(5000, PAYLOAD_SIZE));
+        startSink(5000);
+        send(restarted.package(), BLOCK_SIZE / 2, 0);
+        assert((received == PAYLOAD_SIZE) && (hash == wanted) && gotLast);
+        assert(restarted.getProgress(&offset, NULL) && (offset == PAYLOAD_SIZE));
+        printf("resumed at 5000 in %d byte blocks: %d blocks passed on, hash right.\n",
+               BLOCK_SIZE / 2, numBlocks);
+    }
+
+    // Throughput
+    for (int run = 0; run < NUM_RUNS; run++) {
+        assert(firmware.setProgress(0, 0));
+        startSink(0);
+        start = now();
+        send(firmware.package(), BLOCK_SIZE, 0);
+        if (now() - start < elapsed[0]) {
+            elapsed[0] = now() - start;
+        }
+        assert(hash == wanted);
+        start = now();
+        hash = hashBytes(HASH_START, payload, PAYLOAD_SIZE);
+        if (now() - start < elapsed[1]) {
+            elapsed[1] = now() - start;
+        }
+    }
+    printf("1 MB in %d byte blocks: %.3f ms, %.0f MB/s; hashing alone %.3f ms.\n", BLOCK_SIZE,
+           elapsed[0] * 1e3, 1 / elapsed[0], elapsed[1] * 1e3);
+
+    return 0;
+}
+
+// End of file
@@ -0,0 +1,218 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Start-up time of M2MObjectBuilder::buildInParallel() against the
+ * number of threads: objects of twelve different object IDs, eight
+ * resources each, begun with beginMakeObject() and then finished in one
+ * go, either each with an M2MObject of its own (as objects of different
+ * devices would be) or sharing one per object ID (instances of the same
+ * object, which are built one after another).  It prints the number of
+ * cores first: on a single core this shows the cost of the threads and
+ * the lock, not a speed-up.  It also checks that getReadyObjects(),
+ * with the objects built a step at a time, hands out each shared
+ * M2MObject once and in build order.  From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/parallel_build.cpp m2m_object_helper*.cpp -lpthread -o parallel_build
+ * ./parallel_build <objects per object ID> <most threads>
+ *
+ * The calls that create resources in Mbed Client are made under one
+ * lock, so the speed-up is bounded by the share of the rest of the
+ * work; with the host stand-in's trivial Mbed Client that share is
+ * larger than on a target.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_builder.h"
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define NUM_OBJECT_IDS 12
+#define NUM_RUNS 5
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor(const DefObject *defObject, Sensor *prototype)
+        : M2MObjectHelper(defObject, NULL, (prototype != NULL) ? prototype->getObject() : NULL) {
+        assert(beginMakeObject());
+    }
+    void objectMade() {
+        setResourceValue((int64_t) 7, "5701");
+    }
+    bool get(int64_t *value, const char *resourceNumber) {
+        return getResourceValue(value, resourceNumber);
+    }
+    static void makeDefObjects(int numPerObjectId);
+    static DefObject *_defObjects;
+};
+
+M2MObjectHelper::DefObject *Sensor::_defObjects = NULL;
+
+// Make the definitions, one per instance, alike but
+// for their object IDs and instances.
+void Sensor::makeDefObjects(int numPerObjectId)
+{
+    DefObject *copy;
+
+    static const DefObject defObject = {0, "3300", 8,
+        {{-1, "5700", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5701", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5702", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5703", "t", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {0, "5704", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {1, "5704", "t", M2MResourceBase::INTEGER, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5705", "t", M2MResourceBase::BOOLEAN, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5706", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_PUT_ALLOWED, NULL}},
+        NULL, NULL};
+
+    _defObjects = (DefObject *) malloc(sizeof(defObject) * numPerObjectId * NUM_OBJECT_IDS);
+    for (int x = 0; x < numPerObjectId; x++) {
+        for (int y = 0; y < NUM_OBJECT_IDS; y++) {
+            copy = &(_defObjects[(x * NUM_OBJECT_IDS) + y]);
+            memcpy((void *) copy, &defObject, sizeof(defObject));
+            copy->instance = x;
+            snprintf(copy->name, sizeof(copy->name), "%d", 3300 + y);
+        }
+    }
+}
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (time.tv_nsec / 1e9);
+}
+
+// Begin the objects, the first of each object ID being
+// the one that owns its M2MObject if they are shared.
+static void begin(std::vector<Sensor *> *objects, Sensor **prototypes,
+                  int numPerObjectId, bool shared)
+{
+    Sensor *object;
+
+    for (int y = 0; y < NUM_OBJECT_IDS; y++) {
+        prototypes[y] = NULL;
+    }
+    for (int x = 0; x < numPerObjectId; x++) {
+        for (int y = 0; y < NUM_OBJECT_IDS; y++) {
+            object = new Sensor(&(Sensor::_defObjects[(x * NUM_OBJECT_IDS) + y]),
+                                shared ? prototypes[y] : NULL);
+            if (prototypes[y] == NULL) {
+                prototypes[y] = object;
+            }
+            objects->push_back(object);
+        }
+    }
+}
+
+static void end(std::vector<Sensor *> *objects)
+{
+    // Instances before the objects that own their M2MObject
+    for (size_t x = objects->size(); x > 0; x--) {
+        delete (*objects)[x - 1];
+    }
+    objects->clear();
+}
+
+// Build shared objects a step at a time and check that
+// getReadyObjects() hands out each M2MObject once, in
+// build order.
+static void checkReadyObjects(int numPerObjectId)
+{
+    std::vector<Sensor *> objects;
+    Sensor *prototypes[NUM_OBJECT_IDS];
+    M2MObjectList list;
+    size_t numReady = 0;
+
+    begin(&objects, prototypes, numPerObjectId, true);
+    M2MObjectBuilder builder((M2MObjectHelper **) &(objects[0]), objects.size());
+    while (builder.step(7, 0) > 0) {
+        numReady += builder.getReadyObjects(&list);
+    }
+    numReady += builder.getReadyObjects(&list);
+    assert(numReady == objects.size());
+    assert(list.size() == NUM_OBJECT_IDS);
+    for (int y = 0; y < NUM_OBJECT_IDS; y++) {
+        assert(list[y] == prototypes[y]->getObject());
+    }
+    end(&objects);
+}
+
+// Build the objects on the given number of threads and
+// return how long it took in milliseconds.
+static double build(int numPerObjectId, int numThreads, bool shared)
+{
+    std::vector<Sensor *> objects;
+    Sensor *prototypes[NUM_OBJECT_IDS];
+    double start;
+    double elapsed;
+    int64_t value;
+
+    begin(&objects, prototypes, numPerObjectId, shared);
+
+    M2MObjectBuilder builder((M2MObjectHelper **) &(objects[0]), objects.size());
+    start = now();
+    assert(builder.buildInParallel(numThreads));
+    elapsed = (now() - start) * 1000;
+    assert(builder.isReady());
+
+    for (size_t x = 0; x < objects.size(); x++) {
+        assert(objects[x]->getNumResourcesMade() == 8);
+        assert(objects[x]->get(&value, "5701") && (value == 7));
+    }
+    end(&objects);
+
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    int numPerObjectId = (argc > 1) ? atoi(argv[1]) : 200;
+    int maxThreads = (argc > 2) ? atoi(argv[2]) : 8;
+    double best;
+    double elapsed;
+
+    Sensor::makeDefObjects(numPerObjectId);
+    printf("%d core(s), %d object(s)\n", (int) sysconf(_SC_NPROCESSORS_ONLN),
+           numPerObjectId * NUM_OBJECT_IDS);
+    checkReadyObjects(numPerObjectId);
+    printf("getReadyObjects() check OK\n");
+    for (int shared = 0; shared < 2; shared++) {
+        for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+            best = 0;
+            for (int run = 0; run < NUM_RUNS; run++) {
+                elapsed = build(numPerObjectId, numThreads, shared != 0);
+                if ((run == 0) || (elapsed < best)) {
+                    best = elapsed;
+                }
+            }
+            printf("%-16s %d thread(s): %.1f ms\n", shared ? "shared parents" : "separate parents",
+                   numThreads, best);
+        }
+    }
+
+    free(Sensor::_defObjects);
+
+    return 0;
+}
+
+// End of file
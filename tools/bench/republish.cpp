@@ -0,0 +1,232 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* A gateway of 1,000 temperature objects reconnecting after 5% of the
+ * temperatures changed while it was offline: every value has been
+ * sent and confirmed through the host stand-in's deliver() before it
+ * went offline.  Each object is then asked to republish() and the
+ * totals of what was republished and what was saved are printed, with
+ * the time the calls took.  Before that it checks which resources
+ * republish() picks: with ACKNOWLEDGED_VALUES set to 1 only those the
+ * server has not confirmed, a value that changed while a notification
+ * was on its way, a value written by the server, one not under
+ * observation and non-confirmable notifications; otherwise every
+ * resource under observation.  It prints the size of an object first.
+ * From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/republish.cpp m2m_object_helper*.cpp -lpthread -o republish
+ * ./republish
+ *
+ * Add -DACKNOWLEDGED_VALUES=1 to track what the server has, which
+ * brings RESOURCE_VERSIONS with it unless -DRESOURCE_VERSIONS=0 is
+ * added too.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#define NUM_OBJECTS 1000
+#define NUM_RUNS 5
+#define CHANGED_EVERY 20
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor() : M2MObjectHelper(&_definition) {
+        assert(makeObject());
+    }
+    bool set(float value) {
+        return setResourceValue(value, "5700");
+    }
+    bool set(const char *units) {
+        return setResourceValue(String(units), "5701");
+    }
+    // The Mbed Client resource, for its delivery hooks
+    M2MResource *resource(const char *resourceNumber) {
+        return getObject()->object_instance(0)->resource(resourceNumber);
+    }
+    // Have the server confirm the value of a resource
+    void confirm(const char *resourceNumber) {
+        resource(resourceNumber)->deliver(M2MBase::NOTIFICATION_STATUS_SENT);
+        resource(resourceNumber)->deliver(M2MBase::NOTIFICATION_STATUS_DELIVERED);
+    }
+    static const DefResourceOptions _options[];
+    static const DefObject _definition;
+};
+
+// The version is constant, so is never notified and never republished
+const M2MObjectHelper::DefResourceOptions Sensor::_options[] = {
+    {0, NULL, 0, NULL, NULL, 0},
+    {0, NULL, 0, NULL, NULL, 0},
+    {0, NULL, 0, NULL, NULL, 0},
+    {0, NULL, 0, "1.0", NULL, 0}};
+
+const M2MObjectHelper::DefObject Sensor::_definition = {0, "3303", 4,
+    {{-1, "5700", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5701", "u", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5750", "n", M2MResourceBase::STRING, false, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5751", "v", M2MResourceBase::STRING, true, M2MBase::GET_ALLOWED, NULL}},
+    Sensor::_options, NULL};
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Republish an object, returning what it did.
+static M2MObjectHelper::RepublishStats republish(Sensor *sensor)
+{
+    M2MObjectHelper::RepublishStats stats;
+
+    memset(&stats, 0, sizeof(stats));
+    assert(sensor->republish(&stats) == stats.numRepublished);
+
+    return stats;
+}
+
+// Check which resources republish() picks.
+static void check()
+{
+    Sensor sensor;
+    M2MResource *temperature = sensor.resource("5700");
+    M2MResource *units = sensor.resource("5701");
+    M2MObjectHelper::RepublishStats stats;
+
+    // Nothing confirmed yet: both observable values that aren't constant
+    stats = republish(&sensor);
+    assert((stats.numRepublished == 2) && (stats.numSkipped == 0));
+    assert((temperature->changed == 1) && (units->changed == 1));
+    assert(sensor.resource("5751")->changed == 0);
+
+    assert(sensor.set(21.5f) && sensor.set("Cel"));
+    sensor.confirm("5700");
+    units->deliver(M2MBase::NOTIFICATION_STATUS_SENT);
+    stats = republish(&sensor);
+#if ACKNOWLEDGED_VALUES && RESOURCE_VERSIONS
+    // Sent is not confirmed
+    assert((stats.numRepublished == 1) && (stats.numSkipped == 1));
+    assert((stats.bytesRepublished == 3) && (stats.bytesSaved == 4));
+    assert((temperature->changed == 1) && (units->changed == 2));
+    units->deliver(M2MBase::NOTIFICATION_STATUS_DELIVERED);
+    assert(republish(&sensor).numRepublished == 0);
+
+    // A value set while the last was on its way is not the one confirmed
+    assert(sensor.set(22.0f));
+    temperature->deliver(M2MBase::NOTIFICATION_STATUS_SENT);
+    assert(sensor.set(23.0f));
+    temperature->deliver(M2MBase::NOTIFICATION_STATUS_DELIVERED);
+    assert(republish(&sensor).numRepublished == 1);
+    sensor.confirm("5700");
+    assert(republish(&sensor).numRepublished == 0);
+
+    // The server has what it wrote, and a failed send changes nothing
+    units->server_put("K");
+    temperature->deliver(M2MBase::NOTIFICATION_STATUS_SEND_FAILED);
+    assert(republish(&sensor).numRepublished == 0);
+
+    // A value not under observation counts for nothing
+    assert(sensor.set(30.0f));
+    temperature->observed = false;
+    stats = republish(&sensor);
+    assert((stats.numRepublished == 0) && (stats.numSkipped == 1) && (stats.bytesSaved == 1));
+    temperature->observed = true;
+    assert(republish(&sensor).numRepublished == 1);
+
+    // Non-confirmable, nothing to go on
+    sensor.setNotificationsConfirmable(false);
+    stats = republish(&sensor);
+    assert((stats.numRepublished == 0) && (stats.numSkipped == 0));
+#elif ACKNOWLEDGED_VALUES
+    // With the version of the object, the temperature confirmed
+    // is not the latest once the units have been set after it
+    assert((stats.numRepublished == 2) && (stats.numSkipped == 0));
+    sensor.confirm("5700");
+    sensor.confirm("5701");
+    assert(republish(&sensor).numRepublished == 0);
+#else
+    // Nothing is known, so everything under observation
+    assert((stats.numRepublished == 2) && (stats.numSkipped == 0));
+    assert((stats.bytesRepublished == 7) && (stats.bytesSaved == 0));
+    temperature->observed = false;
+    assert(republish(&sensor).numRepublished == 1);
+#endif
+}
+
+int main()
+{
+    std::vector<Sensor *> sensors;
+    M2MObjectHelper::RepublishStats stats;
+    double best = 1e9;
+    double start;
+
+    printf("ACKNOWLEDGED_VALUES %d, RESOURCE_VERSIONS %d, sizeof(M2MObjectHelper) %d bytes, MAX_NUM_RESOURCES %d\n",
+           ACKNOWLEDGED_VALUES, RESOURCE_VERSIONS, (int) sizeof(M2MObjectHelper), MAX_NUM_RESOURCES);
+
+    check();
+
+    for (int x = 0; x < NUM_OBJECTS; x++) {
+        Sensor *sensor = new Sensor();
+        assert(sensor->set(20.0f + (x % 100) / 10.0f) && sensor->set("Celsius"));
+        sensor->confirm("5700");
+        sensor->confirm("5701");
+        sensors.push_back(sensor);
+    }
+
+    // Best of NUM_RUNS, the machine being shared; the changes
+    // made offline are made again before each run and the
+    // values confirmed after it
+    for (int run = 0; run < NUM_RUNS; run++) {
+        for (int x = 0; x < NUM_OBJECTS; x += CHANGED_EVERY) {
+            assert(sensors[x]->set(30.0f + run));
+        }
+        memset(&stats, 0, sizeof(stats));
+        start = now();
+        for (int x = 0; x < NUM_OBJECTS; x++) {
+            sensors[x]->republish(&stats);
+        }
+        start = now() - start;
+        if (start < best) {
+            best = start;
+        }
+        for (int x = 0; x < NUM_OBJECTS; x++) {
+            sensors[x]->confirm("5700");
+            sensors[x]->confirm("5701");
+        }
+    }
+
+    printf("%d objects, %d changed offline, best of %d runs: %.1f us\n",
+           NUM_OBJECTS, NUM_OBJECTS / CHANGED_EVERY, NUM_RUNS, best * 1e6);
+    printf("republished %d resources, %u bytes of value; skipped %d, %u bytes saved\n",
+           stats.numRepublished, (unsigned int) stats.bytesRepublished,
+           stats.numSkipped, (unsigned int) stats.bytesSaved);
+
+    for (unsigned int x = 0; x < sensors.size(); x++) {
+        delete sensors[x];
+    }
+
+    return 0;
+}
+
+// End of file
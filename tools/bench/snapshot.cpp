@@ -0,0 +1,295 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark and check of M2MObjectSnapshot: makes 20,000 instances (or
+ * the number given on the command line) of an object of seven resources
+ * from the application's definition and sets their values (a cold
+ * start), saves them to a snapshot, then opens the snapshot, makes an
+ * object from each of its definitions and restores its values (a warm
+ * start).  Checks that every value, including an OPAQUE one, comes back,
+ * that the resource options come with the definitions and that a
+ * truncated snapshot is refused, and reports the time of each step,
+ * best of five.  The OPAQUE values are set through Mbed Client after
+ * the cold start is timed, since the stand-in, like Mbed Client, finds
+ * an object instance by searching its list, which with thousands of
+ * instances of one object would swamp the rest.  From the top of the
+ * repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/snapshot.cpp m2m_object_helper*.cpp -lpthread -o snapshot
+ * ./snapshot
+ *
+ * The snapshot is written to the current directory.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include "m2m_object_helper_snapshot.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define SNAPSHOT_PATH "snapshot.snap"
+#define TRUNCATED_PATH "snapshot_truncated.snap"
+#define NUM_RUNS 5
+
+static const char opaqueValue[] = {'a', '\0', 'b', (char) 0xff};
+
+class Sensor : public M2MObjectHelper {
+public:
+    // From a definition in a snapshot
+    Sensor(const DefObject *defObject, M2MObject *object) :
+            M2MObjectHelper(defObject, NULL, object), _made(defObject) {}
+    // From the application's definition for an instance
+    Sensor(int instance, M2MObject *object) :
+            M2MObjectHelper(_defObjects[instance], NULL, object), _made(_defObjects[instance]) {}
+    bool make() {
+        return makeObject();
+    }
+    void fill(int instance);
+    void fillOpaque(int instance);
+    void check(int instance);
+    const DefObject *_made;
+    static void makeDefinitions(int numInstances);
+    static void freeDefinitions();
+    static std::vector<const DefObject *> _defObjects;
+    static const char * const _modes[];
+    static const DefResourceOptions _options[];
+    static const DefObject _defObject;
+};
+
+std::vector<const M2MObjectHelper::DefObject *> Sensor::_defObjects;
+const char * const Sensor::_modes[] = {"off", "on", "auto"};
+
+const M2MObjectHelper::DefResourceOptions Sensor::_options[] =
+    {{0, NULL, 0, NULL, NULL, 0},
+     {0, _modes, 3, NULL, NULL, 0},
+     {0, NULL, 0, "1.0", NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 5000}};
+const M2MObjectHelper::DefObject Sensor::_defObject =
+    {0, "3303", 7,
+        {{-1, "5700", "temperature", M2MResourceBase::FLOAT, true, M2MBase::GET_PUT_ALLOWED, "%.1f"},
+         {-1, "5850", "mode", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5750", "version", M2MResourceBase::STRING, false, M2MBase::GET_ALLOWED, NULL},
+         {-1, "5701", "units", M2MResourceBase::STRING, false, M2MBase::GET_PUT_ALLOWED, NULL},
+         {0, "5702", "count", M2MResourceBase::INTEGER, false, M2MBase::GET_PUT_ALLOWED, NULL},
+         {1, "5702", "count", M2MResourceBase::INTEGER, false, M2MBase::GET_PUT_ALLOWED, NULL},
+         {-1, "5910", "blob", M2MResourceBase::OPAQUE, false, M2MBase::GET_PUT_ALLOWED, NULL}},
+     _options, NULL};
+
+// A copy of the definition for each instance.
+void Sensor::makeDefinitions(int numInstances)
+{
+    DefObject *defObject;
+
+    for (int x = 0; x < numInstances; x++) {
+        defObject = (DefObject *) malloc(sizeof(DefObject));
+        memcpy((void *) defObject, &_defObject, sizeof(DefObject));
+        defObject->instance = x;
+        _defObjects.push_back(defObject);
+    }
+}
+
+void Sensor::freeDefinitions()
+{
+    for (size_t x = 0; x < _defObjects.size(); x++) {
+        free((void *) _defObjects[x]);
+    }
+    _defObjects.clear();
+}
+
+// Set values which depend on the instance.
+void Sensor::fill(int instance)
+{
+    char units[64];
+
+    assert(setResourceValue((float) (20 + (instance % 10)), "5700"));
+    assert(setResourceEnumIndex(instance % 3, "5850"));
+    snprintf(units, sizeof(units), "a unit string for device %d, too long to go inline", instance);
+    assert(setResourceValue(String(units), "5701"));
+    assert(setResourceValue((int64_t) instance, "5702", 0));
+    assert(setResourceValue((int64_t) -instance, "5702", 1));
+}
+
+// Set the OPAQUE value, which is done through Mbed Client.
+void Sensor::fillOpaque(int instance)
+{
+    getObject()->object_instance(instance)->resource("5910")->set_value((const uint8_t *) opaqueValue,
+                                                                        sizeof(opaqueValue));
+}
+
+// Check the values set by fill(), and that the options came
+// with the definition from the snapshot.
+void Sensor::check(int instance)
+{
+    M2MResourceBase *resource;
+    char units[64];
+    String string;
+    float value;
+    int64_t integer;
+    uint8_t index;
+
+    assert(getResourceValue(&value, "5700") && (value == (float) (20 + (instance % 10))));
+    assert(getResourceEnumIndex(&index, "5850") && (index == instance % 3));
+    assert(getResourceValue(&string, "5750") && (string == "1.0"));
+    snprintf(units, sizeof(units), "a unit string for device %d, too long to go inline", instance);
+    assert(getResourceValue(&string, "5701") && (string == units));
+    assert(getResourceValue(&integer, "5702", 0) && (integer == instance));
+    assert(getResourceValue(&integer, "5702", 1) && (integer == -instance));
+    resource = getObject()->object_instance(instance)->resource("5910");
+    assert((resource->value_length() == sizeof(opaqueValue)) &&
+           (memcmp(resource->value(), opaqueValue, sizeof(opaqueValue)) == 0));
+    assert((_made->resourceOptions != NULL) && (_made->resourceOptions != _options) &&
+           (_made->resourceOptions[6].maxUpdateIntervalMs == 5000));
+    assert(!setResourceValue(String("bogus"), "5850"));
+}
+
+static double now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + (t.tv_nsec / 1e9);
+}
+
+static void deleteAll(std::vector<Sensor *> *objects)
+{
+    // Instances before the object that owns their M2MObject
+    for (size_t x = objects->size(); x > 0; x--) {
+        delete (*objects)[x - 1];
+    }
+    objects->clear();
+}
+
+int main(int argc, char **argv)
+{
+    int numObjects = (argc > 1) ? atoi(argv[1]) : 20000;
+    std::vector<Sensor *> objects;
+    double coldMs = 0;
+    double saveMs = 0;
+    double warmMs = 0;
+    double openMs = 0;
+    double opened;
+    double start;
+    M2MObject *parent;
+    Sensor *object;
+    bool checked = false;
+    std::vector<char> contents;
+    FILE *file;
+
+    Sensor::makeDefinitions(numObjects);
+    for (int run = 0; run < NUM_RUNS; run++) {
+        // Cold start: make each object from the application's
+        // definition and set its values
+        start = now();
+        parent = NULL;
+        for (int x = 0; x < numObjects; x++) {
+            object = new Sensor(x, parent);
+            assert(object->make());
+            object->fill(x);
+            parent = object->getObject();
+            objects.push_back(object);
+        }
+        start = now() - start;
+        if ((run == 0) || (start < coldMs)) {
+            coldMs = start;
+        }
+        for (int x = 0; x < numObjects; x++) {
+            objects[x]->fillOpaque(x);
+        }
+
+        start = now();
+        assert(M2MObjectSnapshot::save(SNAPSHOT_PATH, (M2MObjectHelper * const *) &(objects[0]),
+                                       objects.size()));
+        start = now() - start;
+        if ((run == 0) || (start < saveMs)) {
+            saveMs = start;
+        }
+        deleteAll(&objects);
+
+        // Warm start: make each object from the snapshot's
+        // definitions and restore its values
+        {
+            M2MObjectSnapshot snapshot;
+
+            start = now();
+            assert(snapshot.open(SNAPSHOT_PATH));
+            opened = now() - start;
+            assert(snapshot.getNumObjects() == numObjects);
+            parent = NULL;
+            for (int x = 0; x < snapshot.getNumObjects(); x++) {
+                object = new Sensor(snapshot.getObject(x), parent);
+                assert(object->make());
+                assert(snapshot.restore(object));
+                parent = object->getObject();
+                objects.push_back(object);
+            }
+            start = now() - start;
+            if ((run == 0) || (start < warmMs)) {
+                warmMs = start;
+                openMs = opened;
+            }
+            if (!checked) {
+                for (int x = 0; x < numObjects; x++) {
+                    objects[x]->check(x);
+                }
+                checked = true;
+            }
+            // The objects go before the snapshot they were made from
+            deleteAll(&objects);
+        }
+    }
+    printf("snapshot check OK\n");
+
+    // A truncated snapshot is refused
+    file = fopen(SNAPSHOT_PATH, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    contents.resize(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    assert(fread(&contents[0], 1, contents.size(), file) == contents.size());
+    fclose(file);
+    file = fopen(TRUNCATED_PATH, "wb");
+    assert(file != NULL);
+    fwrite(&contents[0], 1, contents.size() - 4, file);
+    fclose(file);
+    {
+        M2MObjectSnapshot snapshot;
+        assert(!snapshot.open(TRUNCATED_PATH));
+    }
+    printf("truncation check OK\n");
+
+    printf("%d instances of %d resources, %u byte snapshot, best of %d runs:\n",
+           numObjects, 7, (unsigned int) contents.size(), NUM_RUNS);
+    printf("cold start %.1f ms, save %.1f ms, warm start %.1f ms (%.1f ms of it opening the snapshot)\n",
+           coldMs * 1000, saveMs * 1000, warmMs * 1000, openMs * 1000);
+
+    unlink(SNAPSHOT_PATH);
+    unlink(TRUNCATED_PATH);
+    Sensor::freeDefinitions();
+
+    return 0;
+}
+
+// End of file
@@ -0,0 +1,248 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* 20,000 objects with two watched resources each, a maxUpdateIntervalMs
+ * of 2.5 seconds, set once a second for a simulated minute on a timer
+ * wheel ticked every 100 ms.  The time per set and the time spent in
+ * tick() per simulated second are printed, along with, for comparison,
+ * what a scan of a plain array of the times each value was set, once
+ * per tick, would cost.  Before that it checks that a resource kept up
+ * to date does not go stale, that one left alone does within its
+ * interval and a tick, that setting it makes it fresh again, that
+ * values written by the server don't count and that deleting an
+ * object stops its timers.  It prints the size of an object first.
+ * From the top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -DSTALE_VALUES=1 -Itools/bench/host -I. tools/bench/stale.cpp m2m_object_helper*.cpp -lpthread -o stale
+ * ./stale
+ *
+ * Leave out -DSTALE_VALUES=1 for the cost of a set without it, when
+ * nothing is watched and nothing goes stale.
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#define NUM_OBJECTS 20000
+#define NUM_WATCHED 2
+#define NUM_SECONDS 60
+#define TICK_MS 100
+#define TICKS_PER_SECOND (1000 / TICK_MS)
+
+class Sensor : public M2MObjectHelper {
+public:
+    Sensor(const DefObject *defObject) : M2MObjectHelper(defObject) {
+        _numStale = 0;
+        _numFresh = 0;
+        setStaleCallback(StaleCallback(this, &Sensor::staleCallback));
+        assert(makeObject());
+    }
+    bool set(float value) {
+        return setResourceValue(value, "5700");
+    }
+    bool set(const char *units) {
+        return setResourceValue(String(units), "5701");
+    }
+    void staleCallback(const char *resourceNumber, int instance, bool stale) {
+        (void) resourceNumber;
+        (void) instance;
+        if (stale) {
+            _numStale++;
+        } else {
+            _numFresh++;
+        }
+    }
+    static const DefResourceOptions _checkOptions[];
+    static const DefResourceOptions _benchOptions[];
+    static const DefObject _check;
+    static const DefObject _bench;
+    int _numStale;
+    int _numFresh;
+};
+
+const M2MObjectHelper::DefResourceOptions Sensor::_checkOptions[] = {
+    {0, NULL, 0, NULL, NULL, 1000},
+    {0, NULL, 0, NULL, NULL, 300},
+    {0, NULL, 0, NULL, NULL, 0}};
+
+const M2MObjectHelper::DefResourceOptions Sensor::_benchOptions[] = {
+    {0, NULL, 0, NULL, NULL, 2500},
+    {0, NULL, 0, NULL, NULL, 2500},
+    {0, NULL, 0, NULL, NULL, 0}};
+
+const M2MObjectHelper::DefObject Sensor::_check = {0, "3303", 3,
+    {{-1, "5700", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5701", "u", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5750", "n", M2MResourceBase::STRING, false, M2MBase::GET_PUT_ALLOWED, NULL}},
+    Sensor::_checkOptions, NULL};
+
+const M2MObjectHelper::DefObject Sensor::_bench = {0, "3303", 3,
+    {{-1, "5700", "t", M2MResourceBase::FLOAT, true, M2MBase::GET_ALLOWED, NULL},
+     {-1, "5701", "u", M2MResourceBase::STRING, true, M2MBase::GET_PUT_ALLOWED, NULL},
+     {-1, "5750", "n", M2MResourceBase::STRING, false, M2MBase::GET_PUT_ALLOWED, NULL}},
+    Sensor::_benchOptions, NULL};
+
+static volatile int sink = 0;
+
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Check when resources go stale and fresh again.
+static void check(M2MTimerWheel *wheel)
+{
+    Sensor sensor(&Sensor::_check);
+    int ticks;
+
+#if STALE_VALUES
+    // The two resources with a maxUpdateIntervalMs are watched
+    assert(wheel->getNumRunning() == NUM_WATCHED);
+
+    // Keep the temperature up to date, with the same value,
+    // and leave the units alone
+    for (int x = 1; x <= 50; x++) {
+        wheel->tick();
+        if (x % 5 == 0) {
+            assert(sensor.set(21.5f));
+        }
+    }
+    assert(!sensor.isStale("5700") && sensor.isStale("5701") && !sensor.isStale("5750"));
+    assert((sensor._numStale == 1) && (sensor._numFresh == 0));
+    assert(wheel->getNumRunning() == 1);
+
+    // Setting the units makes them fresh again
+    assert(sensor.set("Cel"));
+    assert(!sensor.isStale("5701") && (sensor._numFresh == 1));
+    assert(wheel->getNumRunning() == NUM_WATCHED);
+
+    // A value written by the server doesn't count
+    wheel->tick(3);
+    sensor.getObject()->object_instance(0)->resource("5701")->server_put("K");
+    wheel->tick(2);
+    assert(sensor.isStale("5701") && (sensor._numStale == 2));
+
+    // The temperature, left alone, goes stale within its
+    // interval and a tick
+    for (ticks = 0; !sensor.isStale("5700"); ticks++) {
+        wheel->tick();
+    }
+    assert(ticks <= (1000 / TICK_MS) + 1);
+    assert((sensor._numStale == 3) && (wheel->getNumRunning() == 0));
+
+    // Deleting an object stops its timers
+    {
+        Sensor other(&Sensor::_check);
+        assert(wheel->getNumRunning() == NUM_WATCHED);
+    }
+    assert(wheel->getNumRunning() == 0);
+#else
+    // Nothing is watched and nothing goes stale
+    assert(wheel->getNumRunning() == 0);
+    for (ticks = 0; ticks < 50; ticks++) {
+        wheel->tick();
+    }
+    assert(!sensor.isStale("5700") && !sensor.isStale("5701"));
+    assert((sensor._numStale == 0) && (sensor._numFresh == 0));
+#endif
+}
+
+int main()
+{
+    M2MTimerWheel wheel(TICK_MS);
+    std::vector<Sensor *> sensors;
+    uint32_t *lastSet;
+    double setSeconds = 0;
+    double tickSeconds = 0;
+    double scanSeconds = 0;
+    double start;
+    int numExpiries = 0;
+    int numStale = 0;
+
+    printf("STALE_VALUES %d, sizeof(M2MObjectHelper) %d bytes, MAX_NUM_RESOURCES %d\n",
+           STALE_VALUES, (int) sizeof(M2MObjectHelper), MAX_NUM_RESOURCES);
+
+    M2MObjectHelper::setTimerWheel(&wheel);
+    check(&wheel);
+
+    for (int x = 0; x < NUM_OBJECTS; x++) {
+        sensors.push_back(new Sensor(&Sensor::_bench));
+    }
+    // The times an application would keep to scan instead
+    lastSet = (uint32_t *) malloc(NUM_OBJECTS * NUM_WATCHED * sizeof(uint32_t));
+    memset(lastSet, 0, NUM_OBJECTS * NUM_WATCHED * sizeof(uint32_t));
+
+    // Each second: set every watched value, alternating the
+    // temperature so that half of the sets are changes, then
+    // tick for the second
+    for (int second = 0; second < NUM_SECONDS; second++) {
+        start = now();
+        for (int x = 0; x < NUM_OBJECTS; x++) {
+            assert(sensors[x]->set(20.0f + (second % 2)));
+            assert(sensors[x]->set("Cel"));
+        }
+        setSeconds += now() - start;
+        start = now();
+        for (int x = 0; x < NUM_OBJECTS * NUM_WATCHED; x++) {
+            lastSet[x] = wheel.getTime();
+        }
+        for (int x = 0; x < TICKS_PER_SECOND; x++) {
+            for (int y = 0; y < NUM_OBJECTS * NUM_WATCHED; y++) {
+                if (wheel.getTime() + x * TICK_MS - lastSet[y] > 2500) {
+                    sink++;
+                }
+            }
+        }
+        scanSeconds += now() - start;
+        start = now();
+        numExpiries += wheel.tick(TICKS_PER_SECOND);
+        tickSeconds += now() - start;
+    }
+    for (int x = 0; x < NUM_OBJECTS; x++) {
+        numStale += sensors[x]->isStale("5700") + sensors[x]->isStale("5701");
+    }
+    assert((numStale == 0) && (sink == 0));
+
+    printf("%d watched resources, set every second for %d simulated seconds, %d ms ticks:\n",
+           NUM_OBJECTS * NUM_WATCHED, NUM_SECONDS, TICK_MS);
+    printf("a set                               %6.1f ns\n",
+           setSeconds * 1e9 / (NUM_SECONDS * NUM_OBJECTS * NUM_WATCHED));
+    printf("tick() per simulated second          %6.3f ms, %d expiries in all\n",
+           tickSeconds * 1e3 / NUM_SECONDS, numExpiries);
+    printf("scan of an array of set times\n");
+    printf("  each tick, per simulated second    %6.3f ms\n", scanSeconds * 1e3 / NUM_SECONDS);
+
+    for (unsigned int x = 0; x < sensors.size(); x++) {
+        delete sensors[x];
+    }
+    free(lastSet);
+    M2MObjectHelper::setTimerWheel(NULL);
+
+    return 0;
+}
+
+// End of file
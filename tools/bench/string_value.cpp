@@ -0,0 +1,142 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/* Count of the heap operations per update of a STRING resource: the
+ * status strings of an observable and of an unobserved resource, an
+ * enumerated one and one too long to be held inline, each changed on
+ * every update, and an update that doesn't change the value.  malloc()
+ * and friends are wrapped so that every call made during the updates is
+ * counted, the helper's and the stand-in Mbed Client's alike.  From the
+ * top of the repo:
+ *
+ * g++ -O2 -Wall -Wextra -Itools/bench/host -I. tools/bench/string_value.cpp m2m_object_helper*.cpp -lpthread -o string_value
+ * ./string_value
+ */
+
+#include "mbed.h"
+#include "MbedCloudClient.h"
+#include "m2m_object_helper.h"
+#include <assert.h>
+
+#define NUM_UPDATES 100000
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t number, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+extern "C" void __libc_free(void *pointer);
+
+static bool counting = false;
+static unsigned long numHeapOperations = 0;
+
+extern "C" void *malloc(size_t size)
+{
+    numHeapOperations += counting;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t number, size_t size)
+{
+    numHeapOperations += counting;
+    return __libc_calloc(number, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    numHeapOperations += counting;
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer)
+{
+    numHeapOperations += counting && (pointer != NULL);
+    __libc_free(pointer);
+}
+
+static const char * const modes[] = {"IDLE", "RUNNING", "CHARGING"};
+
+class StatusObject : public M2MObjectHelper {
+public:
+    StatusObject() : M2MObjectHelper(&_defObject) {
+        makeObject();
+    }
+    bool set(const char *value, const char *resourceNumber) {
+        return setResourceValue(value, resourceNumber);
+    }
+    bool get(String *value, const char *resourceNumber) {
+        return getResourceValue(value, resourceNumber);
+    }
+    static const DefResourceOptions _options[];
+    static const DefObject _defObject;
+};
+
+const M2MObjectHelper::DefResourceOptions StatusObject::_options[] =
+    {{0, NULL, 0, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0},
+     {0, modes, 3, NULL, NULL, 0},
+     {0, NULL, 0, NULL, NULL, 0}};
+const M2MObjectHelper::DefObject StatusObject::_defObject =
+    {0, "32771", 4,
+        {{-1, "0", "observed", M2MResourceBase::STRING, true, M2MBase::GET_ALLOWED, NULL},
+         {-1, "1", "status", M2MResourceBase::STRING, false, M2MBase::GET_ALLOWED, NULL},
+         {-1, "2", "mode", M2MResourceBase::STRING, false, M2MBase::GET_ALLOWED, NULL},
+         {-1, "3", "detail", M2MResourceBase::STRING, false, M2MBase::GET_ALLOWED, NULL}},
+     _options, NULL};
+
+// Update a resource NUM_UPDATES times, alternating between two
+// values, and print the heap operations per update.
+static void measure(StatusObject *object, const char *what, const char *resourceNumber,
+                    const char *valueA, const char *valueB)
+{
+    // The first two updates may allocate storage that is then kept
+    assert(object->set(valueA, resourceNumber));
+    assert(object->set(valueB, resourceNumber));
+    numHeapOperations = 0;
+    counting = true;
+    for (int x = 0; x < NUM_UPDATES; x++) {
+        object->set(((x & 1) == 0) ? valueA : valueB, resourceNumber);
+    }
+    counting = false;
+    printf("%-36s %.2f heap operation(s) per update\n", what,
+           (double) numHeapOperations / NUM_UPDATES);
+}
+
+int main()
+{
+    StatusObject object;
+    String value;
+
+    measure(&object, "observable, \"OK\" <-> \"IDLE\"", "0", "OK", "IDLE");
+    measure(&object, "unobserved, \"OK\" <-> \"IDLE\"", "1", "OK", "IDLE");
+    measure(&object, "enumerated, \"IDLE\" <-> \"CHARGING\"", "2", "IDLE", "CHARGING");
+    measure(&object, "unobserved, 40 <-> 50 characters", "3",
+            "a status message that is forty character",
+            "a status message that is fifty characters, longer");
+    measure(&object, "observable, unchanged", "0", "OK", "OK");
+
+    // What the server reads is what was set last
+    assert(object.get(&value, "3") &&
+           (value == "a status message that is fifty characters, longer"));
+    assert(object.getObject()->object_instance(0)->resource("1")->server_get() == "IDLE");
+    assert(object.getObject()->object_instance(0)->resource("2")->server_get() == "CHARGING");
+    assert(object.getObject()->object_instance(0)->resource("3")->server_get() ==
+           "a status message that is fifty characters, longer");
+
+    return 0;
+}
+
+// End of file
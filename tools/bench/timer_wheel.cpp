@@ -0,0 +1,177 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark and check of M2MTimerWheel (m2m_object_helper_timer.h) with
+ * 100,000 concurrent deadlines spread over ten minutes of 10 ms ticks:
+ * the cost of starting, restarting and stopping a timer and of a tick,
+ * and that every timer fires exactly once, on the tick it is due.  Also
+ * checks delays beyond the reach of the wheel and the wrapping of the
+ * tick count.  From the top of the repo:
+ *
+ * g++ -O2 -Itools/bench/host -I. tools/bench/timer_wheel.cpp m2m_object_helper_timer.cpp -o timer_wheel
+ * ./timer_wheel [deadlines] [ticks]
+ *
+ * Add e.g. -DTIMER_WHEEL_LEVELS=1 -DTIMER_WHEEL_BITS=8 to compare with a
+ * single-level wheel of the same size.
+ */
+
+#include "mbed.h"
+#include "m2m_object_helper_timer.h"
+#include <assert.h>
+#include <time.h>
+
+#define TICK_MS 10
+
+// Lets the checks start the tick count just short of wrapping.
+class Wheel : public M2MTimerWheel {
+public:
+    Wheel(uint32_t tickMs) : M2MTimerWheel(tickMs) {}
+    uint32_t ticks() { return _ticks; }
+    void setTicks(uint32_t ticks) { _ticks = ticks; }
+};
+
+typedef struct {
+    M2MTimerWheel::Timer timer;
+    uint32_t due;
+    int fired;
+} Deadline;
+
+static Wheel *wheel;
+static long numWrong = 0;
+static long numFired = 0;
+
+static uint64_t nowNs()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (t.tv_sec * 1000000000ULL) + t.tv_nsec;
+}
+
+static void expired(void *context)
+{
+    Deadline *deadline = (Deadline *) context;
+
+    deadline->fired++;
+    numFired++;
+    if (wheel->ticks() != deadline->due) {
+        numWrong++;
+    }
+}
+
+static void startRandom(Deadline *deadline, uint32_t maxTicks)
+{
+    uint32_t ticks = 1 + (rand() % maxTicks);
+
+    deadline->due = wheel->ticks() + ticks;
+    wheel->start(&(deadline->timer), ticks * TICK_MS);
+}
+
+int main(int argc, char **argv)
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 100000;
+    uint32_t maxTicks = (argc > 2) ? atoi(argv[2]) : 60000;
+    Deadline *deadlines = new Deadline[n];
+    Wheel w(TICK_MS);
+    uint64_t start;
+    uint64_t tickNs;
+    uint64_t tickNsMax = 0;
+    uint32_t numTicks = 0;
+    double startNs, restartNs, stopNs, runMs;
+
+    wheel = &w;
+    srand(1);
+    // Don't start aligned with the wheel
+    w.tick(37);
+
+    start = nowNs();
+    for (int x = 0; x < n; x++) {
+        M2MTimerWheel::init(&(deadlines[x].timer), expired, &(deadlines[x]));
+        deadlines[x].fired = 0;
+        startRandom(&(deadlines[x]), maxTicks);
+    }
+    startNs = (nowNs() - start) / (double) n;
+
+    // As a debounce window would: restart every timer
+    start = nowNs();
+    for (int x = 0; x < n; x++) {
+        startRandom(&(deadlines[x]), maxTicks);
+    }
+    restartNs = (nowNs() - start) / (double) n;
+
+    // Stop a quarter, then start them again
+    start = nowNs();
+    for (int x = 0; x < n; x += 4) {
+        w.stop(&(deadlines[x].timer));
+    }
+    stopNs = (nowNs() - start) / (double) ((n + 3) / 4);
+    for (int x = 0; x < n; x += 4) {
+        startRandom(&(deadlines[x]), maxTicks);
+    }
+    assert(w.getNumRunning() == n);
+
+    start = nowNs();
+    while (w.getNumRunning() > 0) {
+        tickNs = nowNs();
+        w.tick();
+        tickNs = nowNs() - tickNs;
+        if (tickNs > tickNsMax) {
+            tickNsMax = tickNs;
+        }
+        numTicks++;
+        assert(numTicks <= maxTicks + 1);
+    }
+    runMs = (nowNs() - start) / 1e6;
+    for (int x = 0; x < n; x++) {
+        assert(deadlines[x].fired == 1);
+    }
+    assert((numWrong == 0) && (numFired == n));
+    printf("%d x %d slot wheel (%u bytes), %d deadlines over %u ticks:\n",
+           TIMER_WHEEL_LEVELS, TIMER_WHEEL_SLOTS, (unsigned int) sizeof(w), n, numTicks);
+    printf("  start %.1f ns, restart %.1f ns, stop %.1f ns\n", startNs, restartNs, stopNs);
+    printf("  tick %.2f us average, %.1f us worst, %.1f ms in all\n",
+           runMs * 1000 / numTicks, tickNsMax / 1000.0, runMs);
+
+    // Across the wrap of the tick count and beyond the reach of
+    // the wheel (2 ^ 24 ticks by default)
+    {
+        Wheel far(1);
+        Deadline near, beyond;
+
+        wheel = &far;
+        far.setTicks(0xFFFFFF00);
+        M2MTimerWheel::init(&(near.timer), expired, &near);
+        M2MTimerWheel::init(&(beyond.timer), expired, &beyond);
+        near.fired = 0;
+        beyond.fired = 0;
+        near.due = far.ticks() + 0x200;
+        beyond.due = far.ticks() + 0x3000000;
+        far.start(&(near.timer), 0x200);
+        far.start(&(beyond.timer), 0x3000000);
+        while (far.getNumRunning() > 0) {
+            far.tick();
+        }
+        assert((near.fired == 1) && (beyond.fired == 1) && (numWrong == 0));
+        printf("  wrap and beyond-range checks OK\n");
+    }
+    delete[] deadlines;
+
+    return 0;
+}
+
+// End of file
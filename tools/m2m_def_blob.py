@@ -0,0 +1,374 @@
+#!/usr/bin/env python3
+#
+# mbed Microcontroller Library
+# Copyright (c) 2017 u-blox
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Make a definition blob for M2MDefinitionBlob (m2m_object_helper_blob.h).
+
+Each input file is either C/C++ source containing DefObject initialisers
+in the form described in m2m_object_helper.h, e.g.
+
+    const M2MObjectHelper::DefObject MyObject::_defObject =
+        {0, "3312", 1,
+            -1, "5850", "on/off", M2MResourceBase::BOOLEAN, false, M2MBase::GET_PUT_ALLOWED, NULL
+        };
+
+...or an OMA LWM2M object definition in XML (a file ending .xml).  The
+blob is laid out for the target described by the options, which must
+match the build (MAX_NUM_RESOURCES etc. and the size of a pointer);
+the blob is refused at run time if they don't.
+"""
+
+import argparse
+import re
+import struct
+import sys
+import xml.etree.ElementTree as ElementTree
+
+BLOB_VERSION = 1
+
+# As M2MResourceBase::ResourceType and M2MBase::Operation
+RESOURCE_TYPES = {"STRING": 0, "INTEGER": 1, "FLOAT": 2, "BOOLEAN": 3,
+                  "OPAQUE": 4, "TIME": 5, "OBJLINK": 6}
+OPERATIONS = {"NOT_ALLOWED": 0, "GET_ALLOWED": 1, "PUT_ALLOWED": 2,
+              "GET_PUT_ALLOWED": 3, "POST_ALLOWED": 4, "GET_POST_ALLOWED": 5,
+              "PUT_POST_ALLOWED": 6, "GET_PUT_POST_ALLOWED": 7,
+              "DELETE_ALLOWED": 8}
+
+# OMA XML resource types and operations
+OMA_TYPES = {"string": "STRING", "integer": "INTEGER", "unsigned integer": "INTEGER",
+             "float": "FLOAT", "boolean": "BOOLEAN", "opaque": "OPAQUE",
+             "time": "TIME", "objlnk": "OBJLINK", "corelnk": "STRING", "": "STRING"}
+OMA_OPERATIONS = {"": 0, "R": 1, "W": 2, "RW": 3, "E": 4}
+
+
+class Resource(object):
+    """A resource, as DefResource."""
+    def __init__(self, instance, name, type_string, resource_type, observable,
+                 operation, value_format):
+        self.instance = instance
+        self.name = name
+        self.type_string = type_string
+        self.type = resource_type
+        self.observable = observable
+        self.operation = operation
+        self.format = value_format
+
+
+class Object(object):
+    """An object, as DefObject."""
+    def __init__(self, instance, name, resources):
+        self.instance = instance
+        self.name = name
+        self.resources = resources
+
+
+def align(offset, alignment):
+    """Round offset up to a multiple of alignment."""
+    return (offset + alignment - 1) // alignment * alignment
+
+
+class Layout(object):
+    """Where the compiler puts the fields of DefResource, DefObjectHash
+    and DefObject, assuming natural alignment, 4-byte int and enum and
+    1-byte bool."""
+    def __init__(self, pointer_size, max_num_resources, max_name_length,
+                 max_type_length):
+        self.pointer_size = pointer_size
+        self.max_num_resources = max_num_resources
+        self.max_name_length = max_name_length
+        self.max_type_length = max_type_length
+        pointer_align = max(4, pointer_size)
+
+        # DefResource
+        self.res_instance = 0
+        self.res_name = 4
+        self.res_type_string = self.res_name + max_name_length
+        self.res_type = align(self.res_type_string + max_type_length, 4)
+        self.res_observable = self.res_type + 4
+        self.res_operation = align(self.res_observable + 1, 4)
+        self.res_format = align(self.res_operation + 4, pointer_size)
+        self.res_size = align(self.res_format + pointer_size, pointer_align)
+
+        # DefObjectHash
+        self.hash_displacement = 0
+        self.hash_index = 2 * max_num_resources
+        self.hash_size = 4 * max_num_resources
+
+        # DefObject
+        self.obj_instance = 0
+        self.obj_name = 4
+        self.obj_num_resources = align(self.obj_name + max_name_length, 4)
+        self.obj_resources = align(self.obj_num_resources + 4, pointer_align)
+        self.obj_resource_options = align(self.obj_resources +
+                                          max_num_resources * self.res_size,
+                                          pointer_size)
+        self.obj_hash = self.obj_resource_options + pointer_size
+        self.obj_size = align(self.obj_hash + pointer_size, pointer_align)
+
+
+# The perfect hash, exactly as M2MObjectHelper::makeHash()
+
+def hash_resource(name, instance):
+    """FNV-1a of the name, then the instance, as hashResource()."""
+    value = 2166136261
+    for byte in name.encode("ascii"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return ((value ^ (instance & 0xFFFFFFFF)) * 16777619) & 0xFFFFFFFF
+
+
+def hash_slot(value, displacement, num_slots):
+    """The murmur3 finaliser, as hashSlot()."""
+    value = (value + displacement * 0x9E3779B9) & 0xFFFFFFFF
+    value ^= value >> 16
+    value = (value * 0x85EBCA6B) & 0xFFFFFFFF
+    value ^= value >> 13
+    value = (value * 0xC2B2AE35) & 0xFFFFFFFF
+    value ^= value >> 16
+    return value % num_slots
+
+
+def make_hash(resources, max_num_resources):
+    """Return (displacement, index) lists for the resources, or None."""
+    count = len(resources)
+    displacement = [0] * max_num_resources
+    index = [0] * max_num_resources
+    if count == 0:
+        return None
+    hashes = [hash_resource(r.name, r.instance) for r in resources]
+    buckets = [[] for _ in range(count)]
+    for x, value in enumerate(hashes):
+        buckets[value % count].append(x)
+    slot_used = [False] * count
+    for size in range(max(len(b) for b in buckets), 0, -1):
+        for bucket, members in enumerate(buckets):
+            if len(members) != size:
+                continue
+            for trial in range(0x10000):
+                slots = [hash_slot(hashes[x], trial, count) for x in members]
+                if len(set(slots)) == len(slots) and \
+                   not any(slot_used[slot] for slot in slots):
+                    break
+            else:
+                return None
+            displacement[bucket] = trial
+            for x, slot in zip(members, slots):
+                slot_used[slot] = True
+                index[slot] = x
+    return displacement, index
+
+
+# Readers
+
+def c_tokens(text):
+    """Split a C initialiser into its values, ignoring braces."""
+    tokens = []
+    for match in re.finditer(r'"((?:[^"\\]|\\.)*)"|([^\s,{}"]+)', text):
+        if match.group(1) is not None:
+            tokens.append(('"', bytes(match.group(1), "ascii").decode("unicode_escape")))
+        else:
+            tokens.append(("", match.group(2)))
+    return tokens
+
+
+def c_value(token, what):
+    """Interpret a single C value."""
+    kind, text = token
+    if kind == '"':
+        return text
+    if text == "NULL" or text == "0" and what == "format":
+        return None
+    if text in ("true", "false"):
+        return text == "true"
+    text = text.split("::")[-1]
+    if what == "type":
+        return RESOURCE_TYPES[text]
+    if what == "operation":
+        value = 0
+        for part in text.split("|"):
+            part = part.strip("() ").split("::")[-1]
+            value |= OPERATIONS[part] if part in OPERATIONS else int(part, 0)
+        return value
+    return int(text, 0)
+
+
+def read_c(path):
+    """Read the DefObject initialisers in a C/C++ file."""
+    with open(path) as file:
+        text = file.read()
+    text = re.sub(r"//.*?$|/\*.*?\*/", "", text, flags=re.S | re.M)
+    objects = []
+    for match in re.finditer(r"DefObject\s+[\w:]+\s*=\s*\{(.*?)\}\s*;", text, re.S):
+        tokens = c_tokens(match.group(1))
+        instance, name, count = (c_value(tokens[0], "int"), c_value(tokens[1], "string"),
+                                 c_value(tokens[2], "int"))
+        resources = []
+        for x in range(count):
+            fields = tokens[3 + x * 7: 10 + x * 7]
+            if len(fields) != 7:
+                raise ValueError("%s: object \"%s\" is short of resources" % (path, name))
+            resources.append(Resource(c_value(fields[0], "int"), c_value(fields[1], "string"),
+                                      c_value(fields[2], "string"), c_value(fields[3], "type"),
+                                      c_value(fields[4], "bool"), c_value(fields[5], "operation"),
+                                      c_value(fields[6], "format")))
+        rest = tokens[3 + count * 7:]
+        if any(token != ("", "NULL") for token in rest):
+            sys.stderr.write("%s: object \"%s\": resourceOptions/hash ignored\n" % (path, name))
+        objects.append(Object(instance, name, resources))
+    return objects
+
+
+def read_oma_xml(path, instance, max_type_length):
+    """Read an OMA LWM2M object definition."""
+    objects = []
+    for element in ElementTree.parse(path).getroot().iter("Object"):
+        resources = []
+        for item in element.find("Resources").iter("Item"):
+            operations = OMA_OPERATIONS[(item.findtext("Operations") or "").strip()]
+            multiple = (item.findtext("MultipleInstances") or "").strip() == "Multiple"
+            oma_type = (item.findtext("Type") or "").strip().lower()
+            resources.append(Resource(0 if multiple else -1, item.get("ID"),
+                                      (item.findtext("Name") or "")[:max_type_length - 1],
+                                      RESOURCE_TYPES[OMA_TYPES[oma_type]],
+                                      bool(operations & 1), operations, None))
+        objects.append(Object(instance, element.findtext("ObjectID").strip(), resources))
+    return objects
+
+
+# Writer
+
+def fixed_string(text, length, what):
+    """A NULL-terminated string in a char array of the given length."""
+    data = text.encode("ascii")
+    if len(data) >= length:
+        raise ValueError("%s \"%s\" is too long (the limit is %d characters)" %
+                         (what, text, length - 1))
+    return data + b"\0" * (length - len(data))
+
+
+def make_blob(objects, layout, endian):
+    """Return the blob for the objects."""
+    header_format = endian + "4s10H5I"
+    pointer_format = endian + {4: "I", 8: "Q"}[layout.pointer_size]
+    objects = sorted(objects, key=lambda o: (int(o.name), o.instance))
+    for previous, current in zip(objects, objects[1:]):
+        if (previous.name, previous.instance) == (current.name, current.instance):
+            raise ValueError("object \"%s\", instance %d, is defined twice" %
+                             (current.name, current.instance))
+
+    index_offset = align(struct.calcsize(header_format), 4)
+    objects_offset = align(index_offset + 12 * len(objects), max(4, layout.pointer_size))
+    hashes_offset = objects_offset + layout.obj_size * len(objects)
+    strings_offset = hashes_offset + layout.hash_size * len(objects)
+
+    blob = bytearray(strings_offset)
+    strings = bytearray()
+    string_offsets = {}
+    relocations = []
+    for number, obj in enumerate(objects):
+        if len(obj.resources) > layout.max_num_resources:
+            raise ValueError("object \"%s\" has %d resources, MAX_NUM_RESOURCES is %d" %
+                             (obj.name, len(obj.resources), layout.max_num_resources))
+        base = objects_offset + number * layout.obj_size
+        struct.pack_into(endian + "IiI", blob, index_offset + number * 12,
+                         int(obj.name), obj.instance, base)
+        struct.pack_into(endian + "i", blob, base + layout.obj_instance, obj.instance)
+        blob[base + layout.obj_name: base + layout.obj_name + layout.max_name_length] = \
+            fixed_string(obj.name, layout.max_name_length, "object name")
+        struct.pack_into(endian + "i", blob, base + layout.obj_num_resources, len(obj.resources))
+        for x, res in enumerate(obj.resources):
+            at = base + layout.obj_resources + x * layout.res_size
+            struct.pack_into(endian + "i", blob, at + layout.res_instance, res.instance)
+            blob[at + layout.res_name: at + layout.res_name + layout.max_name_length] = \
+                fixed_string(res.name, layout.max_name_length, "resource name")
+            blob[at + layout.res_type_string: at + layout.res_type_string + layout.max_type_length] = \
+                fixed_string(res.type_string, layout.max_type_length, "resource type")
+            struct.pack_into(endian + "i", blob, at + layout.res_type, res.type)
+            blob[at + layout.res_observable] = 1 if res.observable else 0
+            struct.pack_into(endian + "i", blob, at + layout.res_operation, res.operation)
+            if res.format is not None:
+                if res.format not in string_offsets:
+                    string_offsets[res.format] = strings_offset + len(strings)
+                    strings += res.format.encode("ascii") + b"\0"
+                struct.pack_into(pointer_format, blob, at + layout.res_format,
+                                 string_offsets[res.format])
+                relocations.append(at + layout.res_format)
+        hashed = make_hash(obj.resources, layout.max_num_resources)
+        if hashed is not None:
+            at = hashes_offset + number * layout.hash_size
+            struct.pack_into(endian + "%dH" % layout.max_num_resources, blob,
+                             at + layout.hash_displacement, *hashed[0])
+            struct.pack_into(endian + "%dh" % layout.max_num_resources, blob,
+                             at + layout.hash_index, *hashed[1])
+            struct.pack_into(pointer_format, blob, base + layout.obj_hash, at)
+            relocations.append(base + layout.obj_hash)
+        else:
+            sys.stderr.write("object \"%s\": no perfect hash, it will be searched\n" % obj.name)
+
+    blob += strings
+    blob += b"\0" * (align(len(blob), 4) - len(blob))
+    relocations_offset = len(blob)
+    for relocation in relocations:
+        blob += struct.pack(endian + "I", relocation)
+    struct.pack_into(header_format, blob, 0, b"M2MD", BLOB_VERSION,
+                     struct.calcsize(header_format), layout.pointer_size,
+                     layout.obj_size, layout.res_size, layout.hash_size,
+                     layout.max_num_resources, layout.max_name_length,
+                     layout.max_type_length, 0, len(objects), index_offset,
+                     len(relocations), relocations_offset, len(blob))
+    return bytes(blob)
+
+
+def main():
+    """Entry point."""
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("inputs", nargs="+", metavar="INPUT",
+                        help="C/C++ source with DefObject initialisers, or OMA XML (.xml)")
+    parser.add_argument("-o", "--output", required=True, help="the blob file to write")
+    parser.add_argument("--instance", type=int, default=0,
+                        help="object instance for objects read from OMA XML (default 0)")
+    parser.add_argument("--pointer-size", type=int, choices=(4, 8), default=8,
+                        help="sizeof(void *) on the target (default 8)")
+    parser.add_argument("--big-endian", action="store_true", help="the target is big-endian")
+    parser.add_argument("--max-num-resources", type=int, default=8,
+                        help="MAX_NUM_RESOURCES of the build (default 8)")
+    parser.add_argument("--max-name-length", type=int, default=8,
+                        help="MAX_OBJECT_RESOURCE_NAME_LENGTH of the build (default 8)")
+    parser.add_argument("--max-type-length", type=int, default=20,
+                        help="MAX_RESOURCE_TYPE_LENGTH of the build (default 20)")
+    args = parser.parse_args()
+
+    layout = Layout(args.pointer_size, args.max_num_resources, args.max_name_length,
+                    args.max_type_length)
+    objects = []
+    for path in args.inputs:
+        if path.lower().endswith(".xml"):
+            objects += read_oma_xml(path, args.instance, args.max_type_length)
+        else:
+            objects += read_c(path)
+    try:
+        blob = make_blob(objects, layout, ">" if args.big_endian else "<")
+    except ValueError as error:
+        sys.stderr.write("%s\n" % error)
+        return 1
+    with open(args.output, "wb") as file:
+        file.write(blob)
+    print("%s: %d object(s), %d byte(s)" % (args.output, len(objects), len(blob)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())